@@ -125,6 +125,29 @@ extern "C" {
 		       ErrorMsg errmsg
 		       );
 
+  int array_spline_table_line_forward(
+				      double * x,
+				      int x_size,
+				      double * y_array,
+				      int y_size,
+				      double * ddy_array,
+				      double * u,
+				      int index_x,
+				      short spline_mode,
+				      ErrorMsg errmsg
+				      );
+
+  int array_spline_table_lines_backward(
+					double * x,
+					int x_size,
+					double * y_array,
+					int y_size,
+					double * ddy_array,
+					double * u,
+					short spline_mode,
+					ErrorMsg errmsg
+					);
+
   int array_logspline_table_lines(
 				  double * x,
 				  int x_size,
@@ -4,6 +4,7 @@
 // #include "perturbations.h"
 #include "sparse.h"
 #define TINY 1e-50
+#define NDF15_OUTPUT_BLOCK 16 /* maximum number of output points interpolated together */
 /**************************************************************/
 
 struct jacobian{
@@ -52,6 +53,28 @@ struct numjac_workspace{
 	int * Rowmax;
 };
 
+/**
+ * State passed from one call of evolver_ndf15_warm() to the next, when
+ * the same solution is continued on an adjacent interval with a
+ * possibly different vector of unknowns (e.g. after an approximation
+ * switch in the perturbation module). It carries the step size, the
+ * order, the backward differences and the last Jacobian, so that the
+ * next call does not restart from order one with a conservative first
+ * step and a fresh Jacobian.
+ */
+
+struct ndf15_warm_start{
+	int has_state;     /* _TRUE_ once a call has stored its final state */
+	int neq;           /* size of the vector at the end of the last call */
+	int neq_max;       /* size for which the arrays below are allocated */
+	int k;             /* order of the method at the end of the last call */
+	double absh;       /* size of the last step taken */
+	double absh_next;  /* size proposed for the next step */
+	double *dif;       /* backward differences, dif[(i-1)*7+(j-1)] = dif[i][j] */
+	double *dfdy;      /* last Jacobian, dfdy[(i-1)*neq+(j-1)] = dfdy[i][j] */
+	double *jacvec;    /* numjac increments, jacvec[i-1] */
+};
+
 /**
  * Boilerplate for C++
  */
@@ -66,6 +89,8 @@ extern "C" {
   int calc_C(struct jacobian *jac);
   int interp_from_dif(double tinterp,double tnew,double *ynew,double h,double **dif,int k, double *yinterp,
 		      double *ypinterp, double *yppinterp, int* index, int neq, int output);
+  int interp_from_dif_block(double *tinterp, int tinterp_size, double tnew, double *ynew, double h,
+			    double **dif, int k, double *yinterp, double *ypinterp, int *mask, int neq);
   int new_linearisation(struct jacobian *jac,double hinvGak,int neq, ErrorMsg error_message);
   int adjust_stepsize(double **dif, double abshdivabshlast, int neq,int k);
   void eqvec(double *datavec,double *emptyvec, int n);
@@ -85,6 +110,9 @@ extern "C" {
                    int *fevals,
                    ErrorMsg error_message);
 
+  int ndf15_warm_start_init(struct ndf15_warm_start *warm_start);
+  int ndf15_warm_start_free(struct ndf15_warm_start *warm_start);
+
   int numjac(int (*derivs)(double x,double * y,double * dy,void * parameters_and_workspace,ErrorMsg error_message),
 	     double t, double *y, double *fval, struct jacobian *jac, struct numjac_workspace *nj_ws,
 	     double thresh, int neq, int *nfe,
@@ -115,6 +143,34 @@ int evolver_ndf15(
 		ErrorMsg error_message),
 	ErrorMsg error_message);
 
+int evolver_ndf15_warm(
+	int (*derivs)(double x,double * y,double * dy,
+		void * parameters_and_workspace, ErrorMsg error_message),
+	double x_ini,
+	double x_final,
+	double * y_inout,
+ 	int * used_in_output,
+	int neq,
+	void * parameters_and_workspace_for_derivs,
+	double rtol,
+	double minimum_variation,
+	int (*timescale_and_approximation)(double x,
+					   void * parameters_and_workspace,
+					   double * timescales,
+					   ErrorMsg error_message),
+	double timestep_over_timescale,
+	double * t_vec,
+	int t_res,
+	int (*output)(double x,double y[],double dy[],int index_x,void * parameters_and_workspace,
+		ErrorMsg error_message),
+	int (*output_block)(double x[],double y[],double dy[],int index_x,int x_size,int y_stride,
+		void * parameters_and_workspace,ErrorMsg error_message),
+	int (*print_variables)(double x, double y[], double dy[], void *parameters_and_workspace,
+		ErrorMsg error_message),
+	struct ndf15_warm_start * warm_start,
+	int * index_map,
+	ErrorMsg error_message);
+
 
 #ifdef __cplusplus
 }
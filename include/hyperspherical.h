@@ -6,6 +6,7 @@
 #define __HYPERSPHERICAL__
 
 #include "common.h"
+#include "vector_math.h"
 #define _HYPER_OVERFLOW_ 1e200
 #define _ONE_OVER_HYPER_OVERFLOW_ 1e-200
 #define _HYPER_SAFETY_ 1e-5
@@ -106,7 +107,8 @@ int hyperspherical_forwards_recurrence_chunk(int K,
                              double beta,
                              double *sinK_vec,
                              int size_sinK_vec,
-                             double *Phi);
+                             double *Phi,
+                             ErrorMsg error_message);
   int ClosedModY(int l, int beta, double *y, int * phisign, int * dphisign);
   int get_CF1(int K,int l,double beta, double cotK, double *CF, int *isign);
   int CF1_from_Gegenbauer(int l, int beta, double sinK, double cotK, double *CF);
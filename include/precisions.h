@@ -57,6 +57,13 @@ class_precision_parameter(tol_ncdm_bg,double,1.e-5)
  * Using w = pressure/density, this quantifies the maximum deviation from 1/3. (for relativistic species)
  */
 class_precision_parameter(tol_ncdm_initial_w,double,1.e-3)
+/**
+ * If _TRUE_, non-cold dark matter species with the same mass, temperature,
+ * chemical potential and momentum sampling (e.g. degenerate neutrinos) are
+ * evolved as a single species with summed degeneracy. The background and
+ * transfer function outputs are still given for each input species.
+ */
+class_precision_parameter(ncdm_merge_identical_species,int,_TRUE_)
 /**
  * Tolerance on the deviation of the conformal time of equality from the true value in 1/Mpc.
  */
@@ -88,6 +95,26 @@ class_precision_parameter(recfast_z_initial,double,1.0e4)
  * Number of recfast integration steps, e.g. if this is 1.10^4 and the previous one is 10^4, the step will be Delta z = 0.5
  */
 class_precision_parameter(recfast_Nz0,int,20000)
+/**
+ * Adaptive sampling of the recombination table (recfast or HyRec). The
+ * lines are still taken on the grid of step recfast_z_initial/recfast_Nz0,
+ * but each line may skip several steps of this grid: the number of
+ * skipped steps grows (at most doubling) as long as the relative
+ * variation per line of x_e and of the opacity dkappa/dz, which shapes
+ * the visibility function g, stays below the two tolerances below, and
+ * shrinks down to one step where they are exceeded. The table is
+ * therefore as fine as before around the features of recombination, and
+ * much coarser elsewhere. Reionization has its own adaptive sampling,
+ * controlled by reionization_sampling.
+ *
+ * Off by default: with the tolerances below, it shifts the low-l lensing
+ * potential spectrum by up to 5e-3 (l=2) and EE at l=2 by 1e-3. Switch it
+ * on for faster runs when this accuracy is sufficient.
+ */
+class_precision_parameter(recfast_adaptive_sampling,int,_FALSE_)
+class_precision_parameter(recfast_sampling_tol_xe,double,2.e-3)
+class_precision_parameter(recfast_sampling_tol_g,double,2.e-3)
+class_precision_parameter(recfast_dz_max,double,20.)  /**< Largest redshift interval between two lines of the recombination table */
 /**
  * If there is interacting DM, we want the thermodynamics table to
  * start at a much larger z, in order to capture the possible
@@ -212,6 +239,27 @@ class_precision_parameter(l_max_dr,int,17)   /**< number of momenta in Boltzmann
 class_precision_parameter(l_max_ur,int,17)   /**< number of momenta in Boltzmann hierarchy for relativistic neutrino/relics (scalar), at least 4 */
 class_precision_parameter(l_max_idr,int,17)   /**< number of momenta in Boltzmann hierarchy for interacting dark radiation */
 class_precision_parameter(l_max_ncdm,int,17)   /**< number of momenta in Boltzmann hierarchy for relativistic neutrino/relics (scalar), at least 4 */
+
+/**
+ * Adaptive truncation of the scalar Boltzmann hierarchies of photons,
+ * ur and ncdm. If l_max_adaptive is _TRUE_, each hierarchy starts with
+ * l_max_adaptive_min multipoles (or its usual l_max if smaller) and
+ * grows by steps of l_max_adaptive_step. The truncation \f$ l \f$ is
+ * kept as long as \f$ k \tau < \f$ l_max_adaptive_ktau_over_l
+ * \f$ \times l \f$, since the amplitude of multipoles
+ * \f$ l \gg k \tau \f$ is suppressed like \f$ (k \tau)^l/(2l+1)!! \f$.
+ * New multipoles are started from this small-argument limit. With
+ * output tCl,pCl,mPk, l_max_scalars=2500 and P_k_max_1/Mpc=15, the
+ * default threshold keeps TT and EE within 2e-5 of a fixed truncation
+ * (relative, at each l) and P(k) within 1e-4 (relative, at each k; this
+ * is the change caused by a 10% change of tol_perturb_integration). A
+ * threshold of 0.5 gives errors up to 7e-4 in EE at l~13.
+ */
+class_precision_parameter(l_max_adaptive,int,_FALSE_)
+class_precision_parameter(l_max_adaptive_min,int,6)
+class_precision_parameter(l_max_adaptive_step,int,6)
+class_precision_parameter(l_max_adaptive_ktau_over_l,double,0.2)
+
 class_precision_parameter(l_max_g_ten,int,5)     /**< number of momenta in Boltzmann hierarchy for photon temperature (tensor), at least 4 */
 class_precision_parameter(l_max_pol_g_ten,int,5) /**< number of momenta in Boltzmann hierarchy for photon polarization (tensor), at least 4 */
 
@@ -235,6 +283,20 @@ class_precision_parameter(perturb_sampling_stepsize,double,0.1)
  */
 class_precision_parameter(tol_perturb_integration,double,1.0e-5)
 
+/**
+ * tolerance schedule for the perturbation integration: the tolerance
+ * is multiplied by tol_perturb_integration_early_factor before
+ * tol_perturb_integration_early_tau_over_tau_rec times the time of
+ * recombination, and by tol_perturb_integration_late_factor after
+ * tol_perturb_integration_late_tau_over_tau_rec times this time.
+ * Both factors are one by default, i.e. the tolerance is constant;
+ * factors above one trade accuracy in the corresponding epoch for speed.
+ */
+class_precision_parameter(tol_perturb_integration_early_factor,double,1.0)
+class_precision_parameter(tol_perturb_integration_early_tau_over_tau_rec,double,0.5)
+class_precision_parameter(tol_perturb_integration_late_factor,double,1.0)
+class_precision_parameter(tol_perturb_integration_late_tau_over_tau_rec,double,2.0)
+
 /**
  * cutoff relevant for controlling stiffness in the PPF scheme. It is
  * neccessary for the Runge-Kutta evolver, but not for ndf15. However,
@@ -335,6 +397,8 @@ class_precision_parameter(l_linstep,int,40) /**< factor for logarithmic spacing
 
 class_precision_parameter(l_logstep,double,1.12) /**< maximum spacing of values of l over which Bessel and transfer functions are sampled (so, spacing becomes linear instead of logarithmic at some point) */
 
+class_precision_parameter(transfer_l_block_size,int,0) /**< number of multipoles computed by one transfer task at a given wavenumber; 0 for automatic (a quarter of the l values when running on several threads, all of them otherwise) */
+
 class_precision_parameter(hyper_x_min,double,1.0e-5)  /**< flat case: lower bound on the smallest value of x at which we sample \f$ \Phi_l^{\nu}(x)\f$ or \f$ j_l(x)\f$ */
 class_precision_parameter(hyper_sampling_flat,double,8.0)  /**< flat case: number of sampled points x per approximate wavelength \f$ 2\pi \f$, should remain >7.5 */
 class_precision_parameter(hyper_sampling_curved_low_nu,double,7.0)  /**< open/closed cases: number of sampled points x per approximate wavelength \f$ 2\pi/\nu\f$, when \f$ \nu \f$ smaller than hyper_nu_sampling_step */
@@ -493,6 +557,39 @@ class_precision_parameter(num_mu_minus_lmax,int,70) /**< difference between num_
 class_precision_parameter(delta_l_max,int,500)/**< difference between l_max in unlensed and lensed spectra */
 class_precision_parameter(tol_gauss_legendre,double,ppr->smallest_allowed_variation) /**< tolerance with which quadrature points are found: must be very small for an accurate integration (if not entered manually, set automatically to match machine precision) */
 
+/*
+ * Memory
+ * */
+
+/**
+ * If _TRUE_, the large tables of the perturbation, transfer, non-linear
+ * and spectra modules are taken from an arena owned by the input module
+ * (see tools/arena.h). They are released all at once when the last
+ * module of the cosmology is destroyed, and the arena is recycled by the
+ * next cosmology, which saves the page faults of re-allocating tables of
+ * the same size in parameter scans.
+ */
+class_precision_parameter(use_arena,int,_FALSE_)
+
+/*
+ * Threads
+ * */
+
+/**
+ * If _TRUE_, each parallel stage starts at most as many workers as it has
+ * tasks, and only as many as are worth their start-up cost given the
+ * estimated work of the stage (see stage_threads_min_work). If _FALSE_,
+ * every stage starts number_of_threads workers. In both cases, the
+ * workers of all concurrent stages of the process are limited by
+ * Tools::ThreadBudget.
+ */
+class_precision_parameter(stage_threads_automatic,int,_TRUE_)
+/**
+ * Smallest estimated number of floating-point operations given to each
+ * worker of a parallel stage in automatic mode.
+ */
+class_precision_parameter(stage_threads_min_work,double,1.e5)
+
 #undef class_precision_parameter
 #undef class_string_parameter
 #undef class_type_parameter
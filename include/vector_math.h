@@ -0,0 +1,73 @@
+/**
+ * definitions for module vector_math.c
+ */
+
+#ifndef __VECTOR_MATH__
+#define __VECTOR_MATH__
+
+#include "common.h"
+#include <stdint.h>
+
+/**
+ * Largest |x| for which the vectorised sine and cosine use their own
+ * argument reduction. Beyond it, elements are recomputed with libm.
+ */
+#define _VECTOR_MATH_TRIG_MAX_ 1.e6
+
+/**
+ * Is x finite? The test is done on the exponent bits, since isfinite()
+ * and x == x may be folded to true under -ffast-math.
+ */
+static inline int vector_math_isfinite(double x){
+  uint64_t bits;
+  memcpy(&bits, &x, sizeof(double));
+  return ((bits >> 52) & 0x7ff) != 0x7ff;
+}
+
+/**
+ * Boilerplate for C++
+ */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  int vector_exp(
+                 int size,
+                 const double * x,
+                 double * y
+                 );
+
+  int vector_log(
+                 int size,
+                 const double * x,
+                 double * y
+                 );
+
+  int vector_pow(
+                 int size,
+                 const double * x,
+                 double p,
+                 double * y
+                 );
+
+  int vector_sincos(
+                    int size,
+                    const double * x,
+                    double * sinx,
+                    double * cosx
+                    );
+
+  int vector_trigonometric_integrals(
+                                     int size,
+                                     const double * x,
+                                     double * Si,
+                                     double * Ci,
+                                     double * sinx,
+                                     double * cosx
+                                     );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -5,6 +5,7 @@
 #include "class.h"
 #include "cosmology.h"
 #include "output_module.h"
+#include "surrogate.h"
 
 int main(int argc, char **argv) {
 
@@ -15,6 +16,11 @@ int main(int argc, char **argv) {
     return _FAILURE_;
   }
 
+  if (SurrogateModel::surrogate_training_requested(fc)) {
+    SurrogateModel surrogate_model{fc};
+    return _SUCCESS_;
+  }
+
   Cosmology cosmology{fc};
 
   OutputModule output_module(cosmology.GetInputModule(), cosmology.GetBackgroundModule(), cosmology.GetThermodynamicsModule(), cosmology.GetPerturbationsModule(), cosmology.GetPrimordialModule(), cosmology.GetNonlinearModule(), cosmology.GetSpectraModule(), cosmology.GetLensingModule());
@@ -123,6 +123,53 @@ cdef extern from "cosmology.h":
         SpectraModulePtr& GetSpectraModule() except +raise_my_py_error
         LensingModulePtr& GetLensingModule() except +raise_my_py_error
 
+cdef extern from "surrogate.h":
+    cdef cppclass SurrogateModel:
+        SurrogateModel(FileContent& fc) except +raise_my_py_error
+        SurrogateModel(string filename) except +raise_my_py_error
+        int surrogate_write(string filename)
+        vector[string] parameter_names_
+        vector[double] parameter_min_
+        vector[double] parameter_max_
+        int l_max_
+        double error_tolerance_
+        double validation_error_
+
+    ctypedef shared_ptr[const SurrogateModel] SurrogateModelPtr
+
+    cdef cppclass SurrogateCosmology:
+        SurrogateCosmology(SurrogateModelPtr model, FileContent& fc) except +raise_my_py_error
+        map[string, vector[double]] cl_output(int lmax) except +raise_my_py_error
+        int pk_at_k_and_z(double k, double z, double* pk)
+        bool is_emulated_
+        double error_estimate_
+        int l_max_
+        ErrorMsg error_message_
+
+cdef fill_file_content(FileContent* fc, dict pars):
+    cdef:
+        char* dumc
+        int i
+
+    fc.size = len(pars)
+    fc.name = <FileArg*> malloc(sizeof(FileArg)*fc.size)
+    assert(fc.name != nullptr)
+    fc.value = <FileArg*> malloc(sizeof(FileArg)*fc.size)
+    assert(fc.value != nullptr)
+    fc.read = <short*> malloc(sizeof(short)*fc.size)
+    assert(fc.read != nullptr)
+
+    # fill parameter file
+    for i, (name, value) in enumerate(pars.items()):
+        dumcp = name.encode()
+        dumc = dumcp
+        sprintf(fc.name[i], "%s", dumc)
+
+        dumcp = str(value).encode()
+        dumc = dumcp
+        sprintf(fc.value[i], "%s", dumc)
+        fc.read[i] = 0
+
 # To support the legacy name Class for the cosmology class.
 cdef class Class(PyCosmology):
     pass
@@ -204,29 +251,10 @@ cdef class PyCosmology:
     cdef _update_fc_from_pars(self):
         cdef:
             FileContent new_file_content
-            char* dumc
-            int i
 
         # _fc will be cleaned up by its destructor
         self._fc = new_file_content
-        self._fc.size = len(self._pars)
-        self._fc.name = <FileArg*> malloc(sizeof(FileArg)*self._fc.size)
-        assert(self._fc.name != nullptr)
-        self._fc.value = <FileArg*> malloc(sizeof(FileArg)*self._fc.size)
-        assert(self._fc.value != nullptr)
-        self._fc.read = <short*> malloc(sizeof(short)*self._fc.size)
-        assert(self._fc.read != nullptr)
-
-        # fill parameter file
-        for i, (name, value) in enumerate(self._pars.items()):
-            dumcp = name.encode()
-            dumc = dumcp
-            sprintf(self._fc.name[i], "%s", dumc)
-
-            dumcp = str(value).encode()
-            dumc = dumcp
-            sprintf(self._fc.value[i], "%s", dumc)
-            self._fc.read[i] = 0
+        fill_file_content(&self._fc, self._pars)
         return self
 
     # The functions struct_cleanup(), empty(), set() and compute() are not neccessary, but they are here to support
@@ -1300,7 +1328,7 @@ cdef class PyCosmology:
         if status == _FAILURE_:
             raise CosmoSevereError(deref(perturbations_module).error_message_)
 
-        tmp = <bytes> titles
+        tmp = <bytes> titles.c_str()
         tmp = str(tmp.decode())
         names = tmp.strip("\t").split("\t")
         number_of_titles = len(names)
@@ -1336,6 +1364,71 @@ cdef class PyCosmology:
 
         return transfers
 
+    def get_transfer_cube(self, z, output_format='class'):
+        """
+        Return the density and/or velocity transfer functions for a list of
+        redshifts at once, as one contiguous array. The redshifts are
+        evaluated in parallel. Same requirements as get_transfer().
+
+        Parameters
+        ----------
+        z  : array of redshifts (each with 0<=z<=z_max_pk)
+        output_format  : ('class' or 'camb') Format transfer functions according to
+                         CLASS convention (default) or CAMB convention.
+
+        Returns
+        -------
+        names : list of the column names, the first one being k (h/Mpc)
+        tk : array of shape (z_size, k_size, number_of_titles) with one
+             initial condition, or (z_size, ic_size, k_size, number_of_titles)
+             with several
+        """
+        cdef:
+            string titles
+            double[::1] z_array = np.ascontiguousarray(z, dtype=np.float64).ravel()
+            np.ndarray[np.float64_t, ndim=4] data
+            file_format outf
+            int status
+            Py_ssize_t number_of_titles
+            Py_ssize_t k_num
+            Py_ssize_t ic_num
+            Py_ssize_t z_num = z_array.shape[0]
+
+        if (not self.pt.has_density_transfers) and (not self.pt.has_velocity_transfers):
+            return [], np.zeros((z_num, 0, 0))
+
+        if output_format == 'camb':
+            outf = camb_format
+        else:
+            outf = class_format
+
+        perturbations_module = deref(self._thisptr).GetPerturbationsModule()
+        index_md = deref(perturbations_module).index_md_scalars_
+        titles.resize(_MAXTITLESTRINGLENGTH_)
+
+        status = deref(perturbations_module).perturb_output_titles(outf, <char*> titles.c_str())
+        if status == _FAILURE_:
+            raise CosmoSevereError(deref(perturbations_module).error_message_)
+
+        tmp = <bytes> titles.c_str()
+        tmp = str(tmp.decode())
+        names = tmp.strip("\t").split("\t")
+        number_of_titles = len(names)
+        k_num = deref(perturbations_module).k_size_[index_md]
+        ic_num = deref(perturbations_module).ic_size_[index_md]
+
+        data = np.empty((z_num, ic_num, k_num, number_of_titles), dtype=np.float64)
+        if z_num == 0:
+            return names, data[:, 0] if ic_num == 1 else data
+
+        status = deref(perturbations_module).perturb_output_data_at_z_list(outf, z_num, &z_array[0], number_of_titles, &data[0, 0, 0, 0])
+        if status == _FAILURE_:
+            raise CosmoSevereError(deref(perturbations_module).error_message_)
+
+        if ic_num == 1:
+            return names, data[:, 0]
+        return names, data
+
     @cython.cdivision(True)
     cdef get_slowroll_parameters(self):
         cdef:
@@ -1722,3 +1815,120 @@ cdef class PyCosmology:
 
     cpdef Omega0_cdm(self):
         return self.ba.Omega0_cdm
+
+
+cdef class Surrogate:
+
+    """
+    Cython wrapper for the surrogate (emulator) mode.
+
+    Surrogate(filename) reads a model trained with train_surrogate() or by
+    running class on an input file with surrogate_parameters. set() and
+    compute() work as for Class; the spectra are then predicted by the model,
+    or computed by a full run if the point is not covered (see emulated()).
+    """
+
+    cdef SurrogateModelPtr _model
+    cdef unique_ptr[SurrogateCosmology] _thisptr
+    cdef dict _pars
+    cdef FileContent _fc
+
+    def __init__(self, filename, input_parameters=None):
+        if input_parameters is None:
+            input_parameters = {}
+        self._model.reset(new SurrogateModel(<string> filename.encode()))
+        self._pars = dict(input_parameters)
+
+    property parameters:
+        def __get__(self):
+            return {deref(self._model).parameter_names_[i].decode():
+                    (deref(self._model).parameter_min_[i], deref(self._model).parameter_max_[i])
+                    for i in range(deref(self._model).parameter_names_.size())}
+
+    property validation_error:
+        def __get__(self):
+            return deref(self._model).validation_error_
+
+    cpdef set(self, input_parameters):
+        self._pars.update(input_parameters)
+        self._thisptr.reset()
+        return self
+
+    cpdef empty(self):
+        self._pars = {}
+        self._thisptr.reset()
+        return self
+
+    cpdef compute(self, level=None):
+        cdef:
+            FileContent new_file_content
+            Py_ssize_t i
+        if self._thisptr:
+            return self
+        self._fc = new_file_content
+        fill_file_content(&self._fc, self._pars)
+        self._thisptr.reset(new SurrogateCosmology(self._model, self._fc))
+        problematic_parameters = [self._fc.name[i].decode() for i in range(self._fc.size) if self._fc.read[i] == _FALSE_]
+        if problematic_parameters:
+            raise CosmoSevereError(
+                "Class did not read input parameter(s): {}\n"
+                .format(', '.join(problematic_parameters))
+            )
+        return self
+
+    cpdef emulated(self):
+        self.compute()
+        return deref(self._thisptr).is_emulated_
+
+    cpdef error_estimate(self):
+        self.compute()
+        return deref(self._thisptr).error_estimate_
+
+    cpdef cl(self, int lmax=-1):
+        cdef:
+            dict out_dict
+            int lmaxpp
+            map[string, vector[double]] cl_data
+
+        self.compute()
+        if lmax == -1:
+            lmax = deref(self._thisptr).l_max_
+        cl_data = deref(self._thisptr).cl_output(lmax)
+        lmaxpp = lmax + 1
+
+        out_dict = {}
+        for element in cl_data:
+            key = <bytes> element.first
+            key = str(key.decode())
+            out_dict[key] = np.asarray(<double[:lmaxpp]> &element.second[0]).copy()
+        out_dict['ell'] = np.arange(lmax + 1)
+        return out_dict
+
+    cpdef pk(self, double k, double z):
+        """
+        Total matter pk (in Mpc**3) for a given k (in 1/Mpc) and z, non linear
+        if the model was trained with a non linear method
+        """
+        cdef:
+            double pk
+        self.compute()
+        if deref(self._thisptr).pk_at_k_and_z(k, z, &pk) == _FAILURE_:
+            raise CosmoSevereError(deref(self._thisptr).error_message_)
+        return pk
+
+
+def train_surrogate(input_parameters):
+    """
+    Train a surrogate from a dictionary of input parameters, including
+    surrogate_parameters, surrogate_parameters_min/max and surrogate_file
+    (see explanatory.ini), and return it as a Surrogate.
+    """
+    cdef:
+        FileContent fc
+        SurrogateModel* model
+    if 'surrogate_file' not in input_parameters:
+        raise CosmoSevereError("train_surrogate needs 'surrogate_file'")
+    fill_file_content(&fc, dict(input_parameters))
+    model = new SurrogateModel(fc)
+    del model
+    return Surrogate(str(input_parameters['surrogate_file']).strip())
@@ -119,6 +119,7 @@ int BackgroundModule::background_add_line_to_bg_table(double loga, double* y, do
  * @param intermode     Input: interpolation mode (normal or closeby)
  * @param last_index    Input/Output: index of the previous/current point in the interpolation array (input only for closeby mode, output for both)
  * @param pvecback      Output: vector (assumed to be already allocated)
+ * @param error_message Output: error message, owned by the caller (see "Concurrent queries" in base_module.h)
  * @return the error status
  */
 
@@ -126,7 +127,8 @@ int BackgroundModule::background_at_tau(double tau,
                                         short return_format,
                                         short intermode,
                                         int* last_index,
-                                        double* pvecback /* vector with argument pvecback[index_bg] (must be already allocated with a size compatible with return_format) */
+                                        double* pvecback, /* vector with argument pvecback[index_bg] (must be already allocated with a size compatible with return_format) */
+                                        ErrorMsg error_message
                                         ) const {
 
   /** Summary: */
@@ -139,11 +141,11 @@ int BackgroundModule::background_at_tau(double tau,
   /** - check that tau is in the pre-computed range */
 
   class_test(tau < tau_table_[0],
-             error_message_,
+             error_message,
              "out of range: tau=%e < tau_min=%e, you should decrease the precision parameter a_ini_over_a_today_default\n",tau,tau_table_[0]);
 
   class_test(tau > tau_table_[bt_size_-1],
-             error_message_,
+             error_message,
              "out of range: tau=%e > tau_max=%e\n",tau,tau_table_[bt_size_-1]);
 
   /** - deduce length of returned vector from format mode */
@@ -175,9 +177,9 @@ int BackgroundModule::background_at_tau(double tau,
                                         last_index,
                                         pvecback,
                                         pvecback_size,
-                                        error_message_),
-               error_message_,
-               error_message_);
+                                        error_message),
+               error_message,
+               error_message);
   }
   if (intermode == pba->inter_closeby) {
     class_call(array_interpolate_spline_growing_closeby(
@@ -190,14 +192,18 @@ int BackgroundModule::background_at_tau(double tau,
                                                         last_index,
                                                         pvecback,
                                                         pvecback_size,
-                                                        error_message_),
-               error_message_,
-               error_message_);
+                                                        error_message),
+               error_message,
+               error_message);
   }
 
   return _SUCCESS_;
 }
 
+int BackgroundModule::background_at_tau(double tau, short return_format, short intermode, int* last_index, double* pvecback) const {
+  return background_at_tau(tau, return_format, intermode, last_index, pvecback, error_message_);
+}
+
 /**
  * Conformal time at given redshift.
  *
@@ -206,10 +212,11 @@ int BackgroundModule::background_at_tau(double tau,
  * @param pba Input: pointer to background structure
  * @param z   Input: redshift
  * @param tau Output: conformal time
+ * @param error_message Output: error message, owned by the caller (see "Concurrent queries" in base_module.h)
  * @return the error status
  */
 
-int BackgroundModule::background_tau_of_z(double z, double* tau) const {
+int BackgroundModule::background_tau_of_z(double z, double* tau, ErrorMsg error_message) const {
 
   /** Summary: */
 
@@ -220,11 +227,11 @@ int BackgroundModule::background_tau_of_z(double z, double* tau) const {
 
   /** - check that \f$ z \f$ is in the pre-computed range */
   class_test(z < z_table_[bt_size_ - 1],
-             error_message_,
+             error_message,
              "out of range: z=%e < z_min=%e\n", z, z_table_[bt_size_ - 1]);
 
   class_test(z > z_table_[0],
-             error_message_,
+             error_message,
              "out of range: a=%e > a_max=%e\n", z, z_table_[0]);
 
   /** - interpolate from pre-computed table with array_interpolate() */
@@ -238,13 +245,17 @@ int BackgroundModule::background_tau_of_z(double z, double* tau) const {
                                       &last_index,
                                       tau,
                                       1,
-                                      error_message_),
-             error_message_,
-             error_message_);
+                                      error_message),
+             error_message,
+             error_message);
 
   return _SUCCESS_;
 }
 
+int BackgroundModule::background_tau_of_z(double z, double* tau) const {
+  return background_tau_of_z(z, tau, error_message_);
+}
+
 /**
  * Background quantities at given \f$ a \f$.
  *
@@ -953,12 +964,6 @@ int BackgroundModule::background_solve() {
   struct generic_integrator_workspace gi;
   /* parameters and workspace for the background_derivs function */
   background_parameters_and_workspace bpaw{this};
-  /* a growing table (since the number of time steps is not known a priori) */
-  growTable gTable;
-  /* needed for growing table */
-  double * pData;
-  /* needed for growing table */
-  void * memcopy_result;
   /* initial conformal time */
   double tau_start;
   /* final conformal time */
@@ -967,18 +972,30 @@ int BackgroundModule::background_solve() {
   int i;
   /* vector of quantities to be integrated */
   double * pvecback_integration;
+  /* quantities to be integrated at the beginning and at the end of the last step */
+  double * pvecback_last_step;
   /* vector of all background quantities */
   double * pvecback;
+  /* line of the background table */
+  double * pvecback_line;
+  /* number of lines allocated in the background tables */
+  int bt_size_max;
+  /* workspaces for the spline of tau(z) and of the background table */
+  double * spline_workspace_z;
+  double * spline_workspace_tau;
   /* necessary for calling array_interpolate(), but never used */
   int last_index=0;
   /* comoving radius coordinate in Mpc (equal to conformal distance in flat case) */
   double comoving_radius=0.;
+  /* growth factor today */
+  double D_today;
 
   class_alloc(pvecback,bg_size_*sizeof(double), error_message_);
   bpaw.pvecback = pvecback;
 
   /** - allocate vector of quantities to be integrated */
   class_alloc(pvecback_integration, bi_size_*sizeof(double), error_message_);
+  class_alloc(pvecback_last_step, 2*bi_size_*sizeof(double), error_message_);
 
   /** - initialize generic integrator with initialize_generic_integrator() */
 
@@ -993,36 +1010,47 @@ int BackgroundModule::background_solve() {
   class_call(background_initial_conditions(pvecback, pvecback_integration),
              error_message_,
              error_message_);
+  memcpy(pvecback_last_step, pvecback_integration, bi_size_*sizeof(double));
 
   /* here tau_end is in fact the initial time (in the next loop
      tau_start = tau_end) */
   tau_end=pvecback_integration[index_bi_tau_];
 
-  /** - create a growTable with gt_init() */
-  class_call(gt_init(&gTable),
-             gTable.error_message,
-             error_message_);
+  /** - allocate background tables. Each step multiplies a by about
+        (1+back_integration_stepsize), which gives the number of lines up
+        to a margin; the tables are reallocated in the unlikely case where
+        it is exceeded */
+  bt_size_max = (int)(1.1*log(pba->a_today/pvecback_integration[index_bi_a_])/log1p(ppr->back_integration_stepsize)) + 10;
+
+  class_alloc(tau_table_, bt_size_max*sizeof(double), error_message_);
+
+  class_alloc(z_table_, bt_size_max*sizeof(double), error_message_);
+
+  class_alloc(background_table_, bt_size_max*bg_size_*sizeof(double), error_message_);
 
   /* initialize the counter for the number of steps */
   bt_size_=0;
 
-  /** - loop over integration steps: call background_functions(), find step size, save data in growTable with gt_add(), perform one step with generic_integrator(), store new value of tau */
+  /** - loop over integration steps: fill one line of the background table with background_add_line_to_rk_table(), find step size, perform one step with generic_integrator(), store new value of tau */
 
   while (pvecback_integration[index_bi_a_] < pba->a_today) {
 
     tau_start = tau_end;
 
-    /* -> find step size (trying to adjust the last step as close as possible to the one needed to reach a=a_today; need not be exact, difference corrected later) */
-    class_call(background_functions(pvecback_integration, pba->short_info, pvecback),
+    /* -> write the current values in the table. All columns but the
+       distances and D, which depend on the values today, are final */
+    class_call(background_add_line_to_rk_table(pvecback_integration, &bt_size_max),
                error_message_,
                error_message_);
+    pvecback_line = background_table_ + (bt_size_ - 1)*bg_size_;
 
+    /* -> find step size (trying to adjust the last step as close as possible to the one needed to reach a=a_today; need not be exact, difference corrected later) */
     if ((pvecback_integration[index_bi_a_]*(1. + ppr->back_integration_stepsize)) < pba->a_today) {
-      tau_end = tau_start + ppr->back_integration_stepsize/(pvecback_integration[index_bi_a_]*pvecback[index_bg_H_]);
+      tau_end = tau_start + ppr->back_integration_stepsize/(pvecback_integration[index_bi_a_]*pvecback_line[index_bg_H_]);
       /* no possible segmentation fault here: non-zeroness of "a" has been checked in background_functions() */
     }
     else {
-      tau_end = tau_start + (pba->a_today/pvecback_integration[index_bi_a_] - 1.)/(pvecback_integration[index_bi_a_]*pvecback[index_bg_H_]);
+      tau_end = tau_start + (pba->a_today/pvecback_integration[index_bi_a_] - 1.)/(pvecback_integration[index_bi_a_]*pvecback_line[index_bg_H_]);
       /* no possible segmentation fault here: non-zeroness of "a" has been checked in background_functions() */
     }
 
@@ -1030,11 +1058,7 @@ int BackgroundModule::background_solve() {
                error_message_,
                "integration step: relative change in time =%e < machine precision : leads either to numerical error or infinite loop",(tau_end-tau_start)/tau_start);
 
-    /* -> save data in growTable */
-    class_call(gt_add(&gTable,_GT_END_, (void*) pvecback_integration, sizeof(double)*bi_size_),
-               gTable.error_message,
-               error_message_);
-    bt_size_++;
+    memcpy(pvecback_last_step, pvecback_integration, bi_size_*sizeof(double));
 
     /* -> perform one step */
     class_call(generic_integrator(background_derivs,
@@ -1053,13 +1077,6 @@ int BackgroundModule::background_solve() {
 
   }
 
-  /** - save last data in growTable with gt_add() */
-  class_call(gt_add(&gTable, _GT_END_, (void*) pvecback_integration, sizeof(double)*bi_size_),
-             gTable.error_message,
-             error_message_);
-  bt_size_++;
-
-
   /* integration finished */
 
   /** - clean up generic integrator with cleanup_generic_integrator() */
@@ -1067,16 +1084,13 @@ int BackgroundModule::background_solve() {
              gi.error_message,
              error_message_);
 
-  /** - retrieve data stored in the growTable with gt_getPtr() */
-  class_call(gt_getPtr(&gTable,(void**)&pData),
-             gTable.error_message,
-             error_message_);
-
   /** - interpolate to get quantities precisely today with array_interpolate() */
+  memcpy(pvecback_last_step + bi_size_, pvecback_integration, bi_size_*sizeof(double));
+
   class_call(array_interpolate(
-                               pData,
+                               pvecback_last_step,
                                bi_size_,
-                               bt_size_,
+                               2,
                                index_bi_a_,
                                pba->a_today,
                                &last_index,
@@ -1086,15 +1100,18 @@ int BackgroundModule::background_solve() {
              error_message_,
              error_message_);
 
-  /* substitute last line with quantities today */
-  for (i = 0; i < bi_size_; i++)
-    pData[(bt_size_ - 1)*bi_size_ + i] = pvecback_integration[i];
+  /** - the last line of the table contains the quantities today */
+  class_call(background_add_line_to_rk_table(pvecback_integration, &bt_size_max),
+             error_message_,
+             error_message_);
 
   /** - deduce age of the Universe */
   /* -> age in Gyears */
   age_ = pvecback_integration[index_bi_time_]/_Gyr_over_Mpc_;
   /* -> conformal age in Mpc */
   conformal_age_ = pvecback_integration[index_bi_tau_];
+  /* -> growth factor today, for normalising D(z=0)=1 */
+  D_today = pvecback_integration[index_bi_D_];
   /* -> contribution of decaying dark matter and dark radiation to the critical density today: */
   if (pba->has_dcdm == _TRUE_){
     Omega0_dcdm_ = pvecback_integration[index_bi_rho_dcdm_]/pba->H0/pba->H0;
@@ -1103,90 +1120,81 @@ int BackgroundModule::background_solve() {
     Omega0_dr_ = pvecback_integration[index_bi_rho_dr_]/pba->H0/pba->H0;
   }
 
-  /** - allocate background tables */
-  class_alloc(tau_table_, bt_size_*sizeof(double), error_message_);
-
-  class_alloc(z_table_, bt_size_*sizeof(double), error_message_);
-
+  /** - allocate tables of second derivatives and spline workspaces */
   class_alloc(d2tau_dz2_table_, bt_size_*sizeof(double), error_message_);
 
-  class_alloc(background_table_, bt_size_*bg_size_*sizeof(double), error_message_);
-
   class_alloc(d2background_dtau2_table_, bt_size_*bg_size_*sizeof(double), error_message_);
 
-  /** - In a loop over lines, fill background table using the result of the integration plus background_functions() */
-  for (i = 0; i < bt_size_; i++) {
-
-    /* -> establish correspondence between the integrated variable and the bg variables */
-
-    tau_table_[i] = pData[i*bi_size_ + index_bi_tau_];
-
-    class_test(pData[i*bi_size_ + index_bi_a_] <= 0.,
-               error_message_,
-               "a = %e instead of strictly positiv",
-               pData[i*bi_size_ + index_bi_a_]);
+  class_alloc(spline_workspace_z, bt_size_*sizeof(double), error_message_);
 
-    z_table_[i] = pba->a_today/pData[i*bi_size_ + index_bi_a_] - 1.;
+  class_alloc(spline_workspace_tau, bt_size_*bg_size_*sizeof(double), error_message_);
 
-    pvecback[index_bg_time_] = pData[i*bi_size_ + index_bi_time_];
-    pvecback[index_bg_conf_distance_] = conformal_age_ - pData[i*bi_size_ + index_bi_tau_];
+  /** - In a single sweep over lines, fill the columns depending on the
+        values today and perform the forward elimination of the splines,
+        which for line i-1 needs the lines up to i */
+  for (i = 0; i < bt_size_; i++) {
 
-    if (pba->sgnK == 0) comoving_radius = pvecback[index_bg_conf_distance_];
-    else if (pba->sgnK == 1) comoving_radius = sin(sqrt(pba->K)*pvecback[index_bg_conf_distance_])/sqrt(pba->K);
-    else if (pba->sgnK == -1) comoving_radius = sinh(sqrt(-pba->K)*pvecback[index_bg_conf_distance_])/sqrt(-pba->K);
+    pvecback_line = background_table_ + i*bg_size_;
 
-    pvecback[index_bg_ang_distance_] = pba->a_today*comoving_radius/(1. + z_table_[i]);
-    pvecback[index_bg_lum_distance_] = pba->a_today*comoving_radius*(1. + z_table_[i]);
-    pvecback[index_bg_rs_] = pData[i*bi_size_ + index_bi_rs_];
+    pvecback_line[index_bg_conf_distance_] = conformal_age_ - tau_table_[i];
 
-    /* -> compute all other quantities depending only on {B} variables.
-       The value of {B} variables in pData are also copied to pvecback.*/
-    class_call(background_functions(pData + i*bi_size_, pba->long_info, pvecback),
-               error_message_,
-               error_message_);
+    if (pba->sgnK == 0) comoving_radius = pvecback_line[index_bg_conf_distance_];
+    else if (pba->sgnK == 1) comoving_radius = sin(sqrt(pba->K)*pvecback_line[index_bg_conf_distance_])/sqrt(pba->K);
+    else if (pba->sgnK == -1) comoving_radius = sinh(sqrt(-pba->K)*pvecback_line[index_bg_conf_distance_])/sqrt(-pba->K);
 
-    /* -> compute growth functions (valid in dust universe) */
+    pvecback_line[index_bg_ang_distance_] = pba->a_today*comoving_radius/(1. + z_table_[i]);
+    pvecback_line[index_bg_lum_distance_] = pba->a_today*comoving_radius*(1. + z_table_[i]);
 
-    /* Normalise D(z=0)=1 and construct f = D_prime/(aHD) */
-    pvecback[index_bg_D_] = pData[i*bi_size_ + index_bi_D_]/pData[(bt_size_ - 1)*bi_size_ + index_bi_D_];
-    pvecback[index_bg_f_] = pData[i*bi_size_ + index_bi_D_prime_]/
-      (pData[i*bi_size_ + index_bi_D_]*pvecback[index_bg_a_]*pvecback[index_bg_H_]);
+    /* Normalise D(z=0)=1 */
+    pvecback_line[index_bg_D_] /= D_today;
 
-    /* -> write in the table */
-    memcopy_result = memcpy(background_table_ + i*bg_size_, pvecback, bg_size_*sizeof(double));
+    /* -> spline elimination of the first line, which needs the lines up to 2 */
+    if (i == MIN(2, bt_size_ - 1)) {
+      class_call(array_spline_table_line_forward(z_table_, bt_size_, tau_table_, 1, d2tau_dz2_table_, spline_workspace_z, 0, _SPLINE_EST_DERIV_, error_message_),
+                 error_message_,
+                 error_message_);
+      class_call(array_spline_table_line_forward(tau_table_, bt_size_, background_table_, bg_size_, d2background_dtau2_table_, spline_workspace_tau, 0, _SPLINE_EST_DERIV_, error_message_),
+                 error_message_,
+                 error_message_);
+    }
 
-    class_test(memcopy_result != background_table_ + i*bg_size_,
-               error_message_,
-               "cannot copy data back to background_table_");
+    /* -> spline elimination of the previous line */
+    if (i >= 2) {
+      class_call(array_spline_table_line_forward(z_table_, bt_size_, tau_table_, 1, d2tau_dz2_table_, spline_workspace_z, i - 1, _SPLINE_EST_DERIV_, error_message_),
+                 error_message_,
+                 error_message_);
+      class_call(array_spline_table_line_forward(tau_table_, bt_size_, background_table_, bg_size_, d2background_dtau2_table_, spline_workspace_tau, i - 1, _SPLINE_EST_DERIV_, error_message_),
+                 error_message_,
+                 error_message_);
+    }
   }
 
-  /** - free the growTable with gt_free() */
-
-  class_call(gt_free(&gTable),
-             gTable.error_message,
-             error_message_);
-
-  /** - fill tables of second derivatives (in view of spline interpolation) */
-  class_call(array_spline_table_lines(z_table_,
-                                      bt_size_,
-                                      tau_table_,
-                                      1,
-                                      d2tau_dz2_table_,
-                                      _SPLINE_EST_DERIV_,
-                                      error_message_),
+  /** - finish the tables of second derivatives (in view of spline interpolation) */
+  class_call(array_spline_table_lines_backward(z_table_,
+                                               bt_size_,
+                                               tau_table_,
+                                               1,
+                                               d2tau_dz2_table_,
+                                               spline_workspace_z,
+                                               _SPLINE_EST_DERIV_,
+                                               error_message_),
              error_message_,
              error_message_);
 
-  class_call(array_spline_table_lines(tau_table_,
-                                      bt_size_,
-                                      background_table_,
-                                      bg_size_,
-                                      d2background_dtau2_table_,
-                                      _SPLINE_EST_DERIV_,
-                                      error_message_),
+  class_call(array_spline_table_lines_backward(tau_table_,
+                                               bt_size_,
+                                               background_table_,
+                                               bg_size_,
+                                               d2background_dtau2_table_,
+                                               spline_workspace_tau,
+                                               _SPLINE_EST_DERIV_,
+                                               error_message_),
              error_message_,
              error_message_);
 
+  free(spline_workspace_z);
+  free(spline_workspace_tau);
+
   /** - compute remaining "related parameters" */
 
   /**  - so-called "effective neutrino number", computed at earliest
@@ -1198,6 +1206,9 @@ int BackgroundModule::background_solve() {
   Neff_ = (background_table_[index_bg_Omega_r_]*background_table_[index_bg_rho_crit_] - background_table_[index_bg_rho_g_])
     /(7./8.*pow(4./11.,4./3.)*background_table_[index_bg_rho_g_]);
 
+  /* quantities today, for the summary below */
+  pvecback_line = background_table_ + (bt_size_ - 1)*bg_size_;
+
   /** - done */
   if (pba->background_verbose > 0) {
     printf(" -> age = %f Gyr\n", age_);
@@ -1215,9 +1226,9 @@ int BackgroundModule::background_solve() {
     }
     if (pba->has_scf == _TRUE_){
       printf("    Scalar field details:\n");
-      printf("     -> Omega_scf = %g, wished %g\n", pvecback[index_bg_rho_scf_]/pvecback[index_bg_rho_crit_], pba->Omega0_scf);
+      printf("     -> Omega_scf = %g, wished %g\n", pvecback_line[index_bg_rho_scf_]/pvecback_line[index_bg_rho_crit_], pba->Omega0_scf);
       if(pba->has_lambda == _TRUE_)
-        printf("     -> Omega_Lambda = %g, wished %g\n", pvecback[index_bg_rho_lambda_]/pvecback[index_bg_rho_crit_], pba->Omega0_lambda);
+        printf("     -> Omega_Lambda = %g, wished %g\n", pvecback_line[index_bg_rho_lambda_]/pvecback_line[index_bg_rho_crit_], pba->Omega0_lambda);
       printf("     -> parameters: [lambda, alpha, A, B] = \n");
       printf("                    [");
       for (i = 0; i < pba->scf_parameters.size() - 1; i++){
@@ -1228,17 +1239,71 @@ int BackgroundModule::background_solve() {
   }
 
   /**  - total matter, radiation, dark energy today */
-  Omega0_m_ = background_table_[(bt_size_ - 1)*bg_size_ + index_bg_Omega_m_];
-  Omega0_r_ = background_table_[(bt_size_ - 1)*bg_size_ + index_bg_Omega_r_];
+  Omega0_m_ = pvecback_line[index_bg_Omega_m_];
+  Omega0_r_ = pvecback_line[index_bg_Omega_r_];
   Omega0_de_ = 1. - (Omega0_m_ + Omega0_r_ + pba->Omega0_k);
 
   free(pvecback);
   free(pvecback_integration);
+  free(pvecback_last_step);
 
   return _SUCCESS_;
 
 }
 
+/**
+ * Append one line to the background table filled by background_solve(),
+ * reallocating the tables if they are full: conformal time, redshift, and
+ * all quantities which do not depend on the values today. The conformal,
+ * angular and luminosity distances are left for background_solve(), and D
+ * is not yet normalised.
+ *
+ * @param pvecback_B   Input: vector of quantities to be integrated
+ * @param bt_size_max  Input/Output: number of lines allocated in the tables
+ * @return the error status
+ */
+
+int BackgroundModule::background_add_line_to_rk_table(double* pvecback_B, int* bt_size_max) {
+
+  double* pvecback_line;
+
+  if (bt_size_ == *bt_size_max) {
+    *bt_size_max *= 2;
+    class_realloc(tau_table_, tau_table_, (*bt_size_max)*sizeof(double), error_message_);
+    class_realloc(z_table_, z_table_, (*bt_size_max)*sizeof(double), error_message_);
+    class_realloc(background_table_, background_table_, (*bt_size_max)*bg_size_*sizeof(double), error_message_);
+  }
+
+  tau_table_[bt_size_] = pvecback_B[index_bi_tau_];
+
+  class_test(pvecback_B[index_bi_a_] <= 0.,
+             error_message_,
+             "a = %e instead of strictly positiv",
+             pvecback_B[index_bi_a_]);
+
+  z_table_[bt_size_] = pba->a_today/pvecback_B[index_bi_a_] - 1.;
+
+  pvecback_line = background_table_ + bt_size_*bg_size_;
+
+  /* -> compute all other quantities depending only on {B} variables.
+     The value of {B} variables are also copied to the table. */
+  class_call(background_functions(pvecback_B, pba->long_info, pvecback_line),
+             error_message_,
+             error_message_);
+
+  pvecback_line[index_bg_time_] = pvecback_B[index_bi_time_];
+  pvecback_line[index_bg_rs_] = pvecback_B[index_bi_rs_];
+
+  /* -> growth functions (valid in dust universe): D normalised later, f = D_prime/(aHD) */
+  pvecback_line[index_bg_D_] = pvecback_B[index_bi_D_];
+  pvecback_line[index_bg_f_] = pvecback_B[index_bi_D_prime_]/
+    (pvecback_B[index_bi_D_]*pvecback_line[index_bg_a_]*pvecback_line[index_bg_H_]);
+
+  bt_size_++;
+
+  return _SUCCESS_;
+}
+
 int BackgroundModule::background_solve_evolver() {
 
   /** Summary: */
@@ -1715,7 +1780,8 @@ int BackgroundModule::background_output_titles(char titles[_MAXTITLESTRINGLENGTH
   class_store_columntitle(titles,"(.)rho_b",_TRUE_);
   class_store_columntitle(titles,"(.)rho_cdm",pba->has_cdm);
   if (pba->has_ncdm == _TRUE_){
-    for (n=0; n<pba->N_ncdm; n++){
+    /* one column per input species, even if identical species are evolved together */
+    for (n=0; n<pba->ncdm->N_ncdm_input_; n++){
       sprintf(tmp,"(.)rho_ncdm[%d]",n);
       class_store_columntitle(titles,tmp,_TRUE_);
       sprintf(tmp,"(.)p_ncdm[%d]",n);
@@ -1773,9 +1839,9 @@ int BackgroundModule::background_output_data(int number_of_titles, double* data)
     class_store_double(dataptr, pvecback[index_bg_rho_b_], _TRUE_, storeidx);
     class_store_double(dataptr, pvecback[index_bg_rho_cdm_], pba->has_cdm, storeidx);
     if (pba->has_ncdm == _TRUE_){
-      for (n=0; n<pba->N_ncdm; n++){
-        class_store_double(dataptr, pvecback[index_bg_rho_ncdm1_+n], _TRUE_, storeidx);
-        class_store_double(dataptr, pvecback[index_bg_p_ncdm1_+n], _TRUE_, storeidx);
+      for (n=0; n<pba->ncdm->N_ncdm_input_; n++){
+        class_store_double(dataptr, pba->ncdm->fraction_of_input_[n]*pvecback[index_bg_rho_ncdm1_+pba->ncdm->ncdm_of_input_[n]], _TRUE_, storeidx);
+        class_store_double(dataptr, pba->ncdm->fraction_of_input_[n]*pvecback[index_bg_p_ncdm1_+pba->ncdm->ncdm_of_input_[n]], _TRUE_, storeidx);
       }
     }
     class_store_double(dataptr, pvecback[index_bg_rho_lambda_], pba->has_lambda, storeidx);
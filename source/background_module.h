@@ -11,7 +11,9 @@ public:
   int background_output_titles(char titles[_MAXTITLESTRINGLENGTH_]) const;
   int background_output_data(int number_of_titles, double* data) const;
   int background_at_tau(double tau, short return_format, short inter_mode, int* last_index, double* pvecback) const;
+  int background_at_tau(double tau, short return_format, short inter_mode, int* last_index, double* pvecback, ErrorMsg error_message) const;
   int background_tau_of_z(double z, double* tau) const;
+  int background_tau_of_z(double z, double* tau, ErrorMsg error_message) const;
   int background_w_fld(double a, double* w_fld, double* dw_over_da_fld, double* integral_fld) const;
   int background_free_noinput() const;
   double dV_scf(double phi) const;
@@ -99,6 +101,7 @@ private:
   int background_free();
   int background_indices();
   int background_solve();
+  int background_add_line_to_rk_table(double* pvecback_B, int* bt_size_max);
   int background_solve_evolver();
   int background_initial_conditions(double* pvecback, double* pvecback_integration);
   int background_find_equality();
@@ -13,8 +13,29 @@
 #include "spectra.h"
 #include "lensing.h"
 #include "output.h"
+#include "thread_budget.h"
+#include "grid_service.h"
 
 
+/**
+ * Concurrent queries:
+ *
+ * Once constructed, a module is never modified, and its const query
+ * functions may be called from any number of threads at the same time
+ * provided they use the overloads taking an explicit ErrorMsg (and,
+ * where needed, a caller-owned workspace). These are
+ *
+ * - BackgroundModule::background_at_tau(), background_tau_of_z()
+ * - ThermodynamicsModule::thermodynamics_at_z()
+ * - PrimordialModule::primordial_spectrum_at_k()
+ * - NonlinearModule::nonlinear_pk_at_z(), nonlinear_pk_at_k_and_z()
+ * - SpectraModule::spectra_cl_at_l()
+ *
+ * They only read the pre-computed tables, write their error status into
+ * the ErrorMsg passed by the caller and do not allocate memory. The
+ * overloads without ErrorMsg report errors in the shared error_message_
+ * below and are therefore not safe for concurrent use.
+ */
 class BaseModule {
 public:
   BaseModule(InputModulePtr input_module)
@@ -27,7 +48,9 @@ public:
   , ptr(&input_module->transfers_)
   , psp(&input_module->spectra_)
   , ple(&input_module->lensing_)
-  , pop(&input_module->output_) {
+  , pop(&input_module->output_)
+  , arena_(input_module->arena_.get())
+  , grid_service_(input_module->grid_service_.get()) {
     input_module_ = std::move(input_module);
     error_message_[0] = '\n';
   }
@@ -47,7 +70,69 @@ protected:
   const spectra* const psp;
   const lensing* const ple;
   const output* const pop;
+
+  /* arena of the input module, or nullptr; see class_alloc_table() */
+  Tools::Arena* const arena_;
+
+  /* k and tau grids shared with the other modules of this input; see Tools::GridService */
+  Tools::GridService* const grid_service_;
+
+  /**
+   * Number of workers to ask the Tools::ThreadBudget for, in a parallel
+   * stage of task_count tasks of about work_per_task floating-point
+   * operations each (see stage_threads_automatic).
+   */
+  unsigned int number_of_workers(std::size_t task_count, double work_per_task) const {
+    if (ppr->stage_threads_automatic == _FALSE_) {
+      return pba->number_of_threads;
+    }
+    return Tools::ThreadBudget::WorkersForStage(pba->number_of_threads, task_count, work_per_task, ppr->stage_threads_min_work);
+  }
+
+  /**
+   * Publish a list of nodes computed by this module in the grid service
+   * under the given name, and replace it by the nodes held by the
+   * service, which may be those of an identical grid published before.
+   * The list must have been allocated with malloc; it is freed here.
+   */
+  int share_grid(const std::string& name, int size, double** nodes) {
+    const Tools::Grid* grid = grid_service_->Publish(name, *nodes, size);
+    class_test(grid == nullptr,
+               error_message_,
+               "a different grid has already been published as %s", name.c_str());
+    free(*nodes);
+    *nodes = grid->Nodes();
+    return _SUCCESS_;
+  }
 };
 
+/**
+ * Allocate a large table that lives as long as the module. It is taken
+ * from the arena of the input module when there is one (use_arena), and
+ * from malloc otherwise. Such tables must be released with
+ * class_free_table(), which does nothing for arena memory: the arena is
+ * released as a whole once every module sharing the input is gone.
+ */
+#define class_alloc_table(pointer, size, error_message_output)  {                                                \
+  if (arena_ != nullptr) {                                                                                       \
+    pointer = (typeof(pointer)) arena_->Allocate(size);                                                          \
+    if (pointer == NULL) {                                                                                       \
+      int size_int;                                                                                              \
+      size_int = size;                                                                                           \
+      class_alloc_message((char*)error_message_output,#pointer, size_int);                                       \
+      return _FAILURE_;                                                                                          \
+    }                                                                                                            \
+  }                                                                                                              \
+  else {                                                                                                         \
+    class_alloc(pointer, size, error_message_output);                                                            \
+  }                                                                                                              \
+}
+
+#define class_free_table(pointer)  {                                                                             \
+  if (arena_ == nullptr) {                                                                                       \
+    free(pointer);                                                                                               \
+  }                                                                                                              \
+}
+
 
 #endif //BASE_MODULE_H
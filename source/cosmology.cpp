@@ -9,6 +9,13 @@
 #include "lensing_module.h"
 #include "output_module.h"
 
+Cosmology::Cosmology(std::unique_ptr<InputModule> input_module) {
+  /* Take over the modules already computed while shooting for unknown parameters */
+  background_module_ptr_ = std::move(input_module->shooting_background_module_);
+  thermodynamics_module_ptr_ = std::move(input_module->shooting_thermodynamics_module_);
+  input_module_ptr_ = std::move(input_module);
+}
+
 InputModulePtr& Cosmology::GetInputModule() {
   return input_module_ptr_;
 }
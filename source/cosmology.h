@@ -6,9 +6,8 @@
 class Cosmology {
 public:
   Cosmology(FileContent& fc)
-  : input_module_ptr_(InputModulePtr(new InputModule(fc))) {}
-  Cosmology(std::unique_ptr<InputModule> input_module)
-  : input_module_ptr_(std::move(input_module)) {}
+  : Cosmology(std::unique_ptr<InputModule>(new InputModule(fc))) {}
+  Cosmology(std::unique_ptr<InputModule> input_module);
 
   InputModulePtr& GetInputModule();
   BackgroundModulePtr& GetBackgroundModule();
@@ -13,8 +13,8 @@
 #include "nonlinear_module.h"
 #include "lensing_module.h"
 #include "spectra_module.h"
+#include "thread_budget.h"
 
-#include <thread>
 /**
  * Use this routine to extract initial parameters from files 'xxx.ini'
  * and/or 'xxx.pre'. They can be the arguments of the main() routine.
@@ -170,6 +170,7 @@ int InputModule::file_content_from_arguments(int argc, char **argv, FileContent&
 
 InputModule::InputModule(FileContent& fc)
 : file_content_(fc)
+, grid_service_(new Tools::GridService())
 , shooting_workspace_(file_content_) {
   for (int i = 0; i < file_content_.size; ++i) {
     file_content_.read[i] = _FALSE_;
@@ -178,6 +179,152 @@ InputModule::InputModule(FileContent& fc)
   if (status == _FAILURE_) {
     throw std::invalid_argument(error_message_);
   }
+  if (precision_.use_arena == _TRUE_) {
+    arena_ = Tools::Arena::Acquire();
+  }
+}
+
+/**
+ * Copy an initialised input module. The file content is shared, all
+ * parameter structures are copied, and the few arrays allocated while
+ * reading the input are duplicated, so that fields of the copy can be
+ * overridden without touching the original. Nothing is parsed: this is
+ * the cheap way of preparing internal re-runs of the code (e.g. in
+ * NonlinearModule::prepare_pk_eq()).
+ */
+
+InputModule::InputModule(const InputModule& other)
+: file_content_(other.file_content_)
+, precision_(other.precision_)
+, background_(other.background_)
+, thermodynamics_(other.thermodynamics_)
+, perturbations_(other.perturbations_)
+, transfers_(other.transfers_)
+, primordial_(other.primordial_)
+, spectra_(other.spectra_)
+, nonlinear_(other.nonlinear_)
+, lensing_(other.lensing_)
+, output_(other.output_)
+, grid_service_(new Tools::GridService())
+, shooting_workspace_(file_content_) {
+  error_message_[0] = '\0';
+  int status = input_copy_arrays();
+  if (status == _FAILURE_) {
+    throw std::invalid_argument(error_message_);
+  }
+  /* own arena, so that the tables of a temporary re-run are not kept until the original goes away */
+  if (precision_.use_arena == _TRUE_) {
+    arena_ = Tools::Arena::Acquire();
+  }
+}
+
+/**
+ * Input module for one step of the shooting: the precision parameters
+ * are taken from the module doing the shooting and only the input
+ * parameters are read again, since the derived parameters depend on the
+ * value of the unknown parameter. The read flags of the file content are
+ * left as they are, so that the precision parameters still count as read.
+ */
+
+InputModule::InputModule(FileContent& fc, const precision& pr)
+: file_content_(fc)
+, precision_(pr)
+, grid_service_(new Tools::GridService())
+, shooting_workspace_(file_content_) {
+  error_message_[0] = '\0';
+  int status = input_read_parameters();
+  if (status == _FAILURE_) {
+    throw std::invalid_argument(error_message_);
+  }
+}
+
+/**
+ * Free the arrays owned by the parameter structures: those allocated
+ * while reading the input, or duplicated by the copy constructor.
+ */
+
+InputModule::~InputModule() {
+  free(perturbations_.alpha_idm_dr);
+  free(perturbations_.beta_idr);
+  free(thermodynamics_.binned_reio_z);
+  free(thermodynamics_.binned_reio_xe);
+  free(thermodynamics_.many_tanh_z);
+  free(thermodynamics_.many_tanh_xe);
+  free(thermodynamics_.reio_inter_z);
+  free(thermodynamics_.reio_inter_xe);
+  if (primordial_.primordial_spec_type == external_Pk) {
+    free(primordial_.command);
+  }
+}
+
+/**
+ * Overrides of a copy (see InputModule(const InputModule&)), to be set
+ * before the copy is passed to a Cosmology. SetVerbose() sets the
+ * verbosity of all modules.
+ */
+
+void InputModule::SetNumberOfThreads(int number_of_threads) {
+  background_.number_of_threads = number_of_threads;
+}
+
+void InputModule::SetVerbose(int verbose) {
+  background_.background_verbose = verbose;
+  thermodynamics_.thermodynamics_verbose = verbose;
+  perturbations_.perturbations_verbose = verbose;
+  transfers_.transfer_verbose = verbose;
+  primordial_.primordial_verbose = verbose;
+  spectra_.spectra_verbose = verbose;
+  nonlinear_.nonlinear_verbose = verbose;
+  lensing_.lensing_verbose = verbose;
+  output_.output_verbose = verbose;
+}
+
+void InputModule::SetFluidEquationOfState(double w0_fld, double wa_fld) {
+  background_.w0_fld = w0_fld;
+  background_.wa_fld = wa_fld;
+}
+
+/**
+ * Duplicate the arrays owned by the parameter structures (called by the
+ * copy constructor, while they still point to the arrays of the original).
+ */
+
+int InputModule::input_copy_arrays() {
+
+  thermo* pth = &thermodynamics_;
+  perturbs* ppt = &perturbations_;
+  primordial* ppm = &primordial_;
+  precision* ppr = &precision_;
+  double* array;
+  char* string;
+
+  /* the pointers are NULL (see input_default_params()) unless the array was read */
+  double** arrays[] = {&ppt->alpha_idm_dr, &ppt->beta_idr,
+                       &pth->binned_reio_z, &pth->binned_reio_xe,
+                       &pth->many_tanh_z, &pth->many_tanh_xe,
+                       &pth->reio_inter_z, &pth->reio_inter_xe};
+  int sizes[] = {ppr->l_max_idr - 1, ppr->l_max_idr - 1,
+                 pth->binned_reio_num, pth->binned_reio_num,
+                 pth->many_tanh_num, pth->many_tanh_num,
+                 pth->reio_inter_num, pth->reio_inter_num};
+
+  for (int index = 0; index < (int)(sizeof(sizes)/sizeof(int)); index++) {
+    if (*arrays[index] != NULL) {
+      class_alloc(array, sizes[index]*sizeof(double), error_message_);
+      memcpy(array, *arrays[index], sizes[index]*sizeof(double));
+      *arrays[index] = array;
+    }
+  }
+
+  if (ppm->primordial_spec_type == external_Pk) {
+    class_alloc(string, strlen(ppm->command) + 1, error_message_);
+    strcpy(string, ppm->command);
+    ppm->command = string;
+  }
+
+  /* pba->ncdm is only queried through const member functions and can be shared */
+
+  return _SUCCESS_;
 }
 
 int InputModule::FixUnknownParameters(int input_verbose, int unknown_parameters_size, int* target_indices) {
@@ -198,6 +345,7 @@ int InputModule::FixUnknownParameters(int input_verbose, int unknown_parameters_
               unknown_parameters_size*sizeof(int),
               error_message_);
   shooting_workspace_.target_size = unknown_parameters_size;
+  shooting_workspace_.ppr = &precision_;
   class_alloc(shooting_workspace_.target_name,
               shooting_workspace_.target_size*sizeof(enum target_names),
               error_message_);
@@ -246,10 +394,16 @@ int InputModule::FixUnknownParameters(int input_verbose, int unknown_parameters_
     class_call(input_find_root(&xzero, &fevals, &shooting_workspace_, error_message_),
                error_message_, error_message_);
 
-    /* Store xzero */
+    /* Store xzero. The last evaluation, with the final parameters, is
+       done at full precision and keeps its background and
+       thermodynamics modules for the Cosmology built on this input. */
     sprintf(file_content_.value[shooting_workspace_.unknown_parameters_index[0]],"%e",xzero);
     double fzero_value;
-    input_fzerofun_1d(xzero, (void*)(&shooting_workspace_), &fzero_value, error_message_);
+    shooting_workspace_.is_final_evaluation = _TRUE_;
+    class_call(input_fzerofun_1d(xzero, (void*)(&shooting_workspace_), &fzero_value, error_message_),
+               error_message_, error_message_);
+    shooting_background_module_ = std::move(shooting_workspace_.background_module);
+    shooting_thermodynamics_module_ = std::move(shooting_workspace_.thermodynamics_module);
 
     if (input_verbose > 0) {
       fprintf(stdout, " -> found '%s = %s'\n",
@@ -578,21 +732,13 @@ int InputModule::input_read_parameters() {
              errmsg);
   if (flag1 == _TRUE_) {
     pba->number_of_threads = int1;
+    // An explicit request must not be capped by the process-wide default.
+    Tools::ThreadBudget::RaiseLimit(MAX(int1, 1));
   }
   else {
-    // If threads was not specified an input, use std::thread::hardware_concurrency() as
-    // default. Then loop through a list of environment variable names, and if one of
-    // them is set to value 0 < threads <= 8192, use that one instead.
-    pba->number_of_threads = std::thread::hardware_concurrency();
-    for (const std::string& env_var_name : {"SLURM_CPUS_PER_TASK", "OMP_NUM_THREADS"}) {
-      if (char* s = std::getenv(env_var_name.c_str())) {
-        int threads = std::atoi(s);
-        if ((threads > 0) && (threads <= 8192)) {
-          pba->number_of_threads = threads;
-          break;
-        }
-      }
-    }
+    // If threads was not specified an input, use std::thread::hardware_concurrency(),
+    // or SLURM_CPUS_PER_TASK or OMP_NUM_THREADS if set.
+    pba->number_of_threads = Tools::ThreadBudget::DefaultThreadCount();
   }
 
   /** Knowing the gauge from the very beginning is useful (even if
@@ -1028,7 +1174,13 @@ int InputModule::input_read_parameters() {
   ncdm_settings.tol_ncdm = ppr->tol_ncdm;
   ncdm_settings.tol_ncdm_bg = ppr->tol_ncdm_bg;
   ncdm_settings.tol_M_ncdm = ppr->tol_M_ncdm;
-  pba->ncdm = NonColdDarkMatter::Create(pfc, ncdm_settings);
+  ncdm_settings.merge_identical_species = ppr->ncdm_merge_identical_species;
+  try {
+    pba->ncdm = NonColdDarkMatter::Create(pfc, ncdm_settings);
+  }
+  catch (std::exception& e) {
+    class_stop(errmsg, "%s", e.what());
+  }
   if (pba->ncdm) {
     pba->N_ncdm = pba->ncdm->N_ncdm_;
     pba->Omega0_ncdm_tot = pba->ncdm->GetOmega0();
@@ -3069,6 +3221,10 @@ int InputModule::input_default_params() {
   pth->binned_reio_num=0;
   pth->binned_reio_z=NULL;
   pth->binned_reio_xe=NULL;
+  pth->many_tanh_z=NULL;
+  pth->many_tanh_xe=NULL;
+  pth->reio_inter_z=NULL;
+  pth->reio_inter_xe=NULL;
   pth->binned_reio_step_sharpness = 0.3;
 
   pth->annihilation = 0.;
@@ -3141,6 +3297,8 @@ int InputModule::input_default_params() {
   ppt->gauge=synchronous;
 
   ppt->idr_nature=idr_free_streaming;
+  ppt->alpha_idm_dr=NULL;
+  ppt->beta_idr=NULL;
 
   ppt->has_Nbody_gauge_transfers = _FALSE_;
 
@@ -3437,6 +3595,7 @@ int InputModule::input_try_unknown_parameters(double* unknown_parameter, int unk
   int flag;
   int param;
   short compute_sigma8 = _FALSE_;
+  short compute_thermodynamics = _FALSE_;
 
   pfzw = (struct fzerofun_workspace *) voidpfzw;
   /** - Read input parameters */
@@ -3445,7 +3604,7 @@ int InputModule::input_try_unknown_parameters(double* unknown_parameter, int unk
             "%e",unknown_parameter[i]);
   }
 
-  std::unique_ptr<InputModule> input_module{new InputModule(pfzw->fc)};
+  std::unique_ptr<InputModule> input_module{new InputModule(pfzw->fc, *pfzw->ppr)};
   precision& pr = input_module->precision_;      /* for precision parameters */
   background& ba = input_module->background_;    /* for cosmological background */
   thermo& th = input_module->thermodynamics_;    /* for thermodynamics */
@@ -3490,9 +3649,11 @@ int InputModule::input_try_unknown_parameters(double* unknown_parameter, int unk
 
   }
 
-  // Zero the verbose flags
-  ba.background_verbose = 0;
-  th.thermodynamics_verbose = 0;
+  // Zero the verbose flags (except for the modules kept from the final evaluation)
+  if (pfzw->is_final_evaluation == _FALSE_) {
+    ba.background_verbose = 0;
+    th.thermodynamics_verbose = 0;
+  }
   pt.perturbations_verbose = 0;
   pm.primordial_verbose = 0;
   nl.nonlinear_verbose = 0;
@@ -3501,7 +3662,9 @@ int InputModule::input_try_unknown_parameters(double* unknown_parameter, int unk
   le.lensing_verbose = 0;
 
   // Optimise some precision flags:
-  pr.recfast_Nz0 = 10000;
+  if (pfzw->is_final_evaluation == _FALSE_) {
+    pr.recfast_Nz0 = 10000;
+  }
 
   Cosmology cosmology{std::move(input_module)};
 
@@ -3511,6 +3674,7 @@ int InputModule::input_try_unknown_parameters(double* unknown_parameter, int unk
     case theta_s: {
       ThermodynamicsModulePtr thm = cosmology.GetThermodynamicsModule();
       output[i] = 100.*thm->rs_rec_/thm->ra_rec_ - pfzw->target_value[i];
+      compute_thermodynamics = _TRUE_;
       break;
     }
     case Omega_dcdmdr: {
@@ -3553,11 +3717,22 @@ int InputModule::input_try_unknown_parameters(double* unknown_parameter, int unk
     case sigma8: {
       NonlinearModulePtr nl = cosmology.GetNonlinearModule();
       output[i] = nl->sigma8_[nl->index_pk_m_] - pfzw->target_value[i];
+      compute_thermodynamics = _TRUE_;
       break;
     }
     }
   }
 
+  /** - Keep the modules of the final evaluation. The background and
+      thermodynamics modules only depend on the precision, background and
+      thermo structures, which are the same as in the final run. */
+  if (pfzw->is_final_evaluation == _TRUE_) {
+    pfzw->background_module = cosmology.GetBackgroundModule();
+    if (compute_thermodynamics == _TRUE_) {
+      pfzw->thermodynamics_module = cosmology.GetThermodynamicsModule();
+    }
+  }
+
   return _SUCCESS_;
 }
 
@@ -3568,7 +3743,7 @@ int InputModule::input_get_guess(double* xguess, double* dxdy, fzerofun_workspac
   double Omega_M, a_decay, gamma, Omega0_dcdmdr=1.0;
   int index_guess;
 
-  std::shared_ptr<InputModule> input_module = std::make_shared<InputModule>(pfzw->fc);
+  std::unique_ptr<InputModule> input_module{new InputModule(pfzw->fc, *pfzw->ppr)};
   background& ba = input_module->background_;    /* for cosmological background */
   /** Summary: */
   /** - Here we should write reasonable guesses for the unknown parameters.
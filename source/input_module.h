@@ -15,6 +15,8 @@
 #include "nonlinear.h"
 #include "lensing.h"
 #include "output.h"
+#include "arena.h"
+#include "grid_service.h"
 
 #include <string>
 #include <vector>
@@ -26,6 +28,12 @@ enum target_names {theta_s, Omega_dcdmdr, omega_dcdmdr, Omega_scf, Omega_ini_dcd
 class InputModule {
 public:
   InputModule(FileContent& fc);
+  /* deep copy of an initialised module, without parsing; override fields of the copy with the setters below */
+  InputModule(const InputModule& other);
+  ~InputModule();
+  void SetNumberOfThreads(int number_of_threads);
+  void SetVerbose(int verbose);
+  void SetFluidEquationOfState(double w0_fld, double wa_fld);
   static int file_content_from_arguments(int argc, char** argv, FileContent& fc, ErrorMsg errmsg);
 
   FileContent& file_content_;
@@ -41,7 +49,19 @@ public:
   output output_;
   ErrorMsg error_message_;
 
+  /* modules computed during the shooting with the final parameters, taken over by Cosmology (may be empty) */
+  BackgroundModulePtr shooting_background_module_;
+  ThermodynamicsModulePtr shooting_thermodynamics_module_;
+
+  /* arena for the large tables of the modules sharing this input (empty unless use_arena is set) */
+  std::shared_ptr<Tools::Arena> arena_;
+
+  /* k and tau grids shared by the modules of this input, and the tables computed on them */
+  std::shared_ptr<Tools::GridService> grid_service_;
+
 private:
+  InputModule(FileContent& fc, const precision& pr);
+
   struct fzerofun_workspace {
     fzerofun_workspace(FileContent& fc_ref) : fc(fc_ref) {}
     ~fzerofun_workspace() {
@@ -51,9 +71,13 @@ private:
     }
     int* unknown_parameters_index = nullptr;
     FileContent& fc;
+    const precision* ppr = nullptr;
     enum target_names* target_name = nullptr;
     double* target_value = nullptr;
     int target_size;
+    short is_final_evaluation = _FALSE_;
+    BackgroundModulePtr background_module;
+    ThermodynamicsModulePtr thermodynamics_module;
   };
   static const std::vector<std::string> kTargetNamestrings_;
   static const std::vector<std::string> kUnknownNamestrings_;
@@ -66,6 +90,7 @@ private:
   int input_read_precisions();
   int input_default_params();
   int input_default_precision();
+  int input_copy_arrays();
   static int input_auxillary_target_conditions(FileContent* pfc, enum target_names target_name, double target_value, int* aux_flag, ErrorMsg error_message);
   static int compare_doubles(const void* a, const void* b);
   static int file_exists(const char* fname);
@@ -2,6 +2,7 @@
 
 #include "primordial.h"
 #include "trigonometric_integrals.h"
+#include "vector_math.h"
 
 #ifndef __NONLINEAR__
 #define __NONLINEAR__
@@ -18,6 +18,7 @@
 #include "nonlinear_module.h"
 #include "non_cold_dark_matter.h"
 #include "cosmology.h"
+#include "thread_pool.h"
 
 NonlinearModule::NonlinearModule(InputModulePtr input_module, BackgroundModulePtr background_module, PerturbationsModulePtr perturbations_module, PrimordialModulePtr primordial_module)
 : BaseModule(std::move(input_module))
@@ -77,6 +78,7 @@ NonlinearModule::~NonlinearModule() {
  * @param index_pk    Input: index of pk type (_m, _cb)
  * @param out_pk      Output: P(k) returned as out_pk_l[index_k]
  * @param out_pk_ic   Output:  P_ic(k) returned as  out_pk_ic[index_k * ic_ic_size_ + index_ic1_ic2]
+ * @param error_message Output: error message, owned by the caller (see "Concurrent queries" in base_module.h)
  * @return the error status
  */
 
@@ -86,7 +88,8 @@ int NonlinearModule::nonlinear_pk_at_z(
                                        double z,
                                        int index_pk,
                                        double * out_pk, // array out_pk[index_k]
-                                       double * out_pk_ic // array out_pk_ic[index_k * ic_ic_size_ + index_ic1_ic2]
+                                       double * out_pk_ic, // array out_pk_ic[index_k * ic_ic_size_ + index_ic1_ic2]
+                                       ErrorMsg error_message
                                        ) const {
   double tau;
   double ln_tau;
@@ -129,11 +132,11 @@ int NonlinearModule::nonlinear_pk_at_z(
   else {
 
     class_test(ln_tau_size_ == 1,
-               error_message_,
+               error_message,
                "You are asking for the matter power spectrum at z=%e but the code was asked to store it only at z=0. You probably forgot to pass the input parameter z_max_pk (see explanatory.ini)",z);
 
     /** --> get value of contormal time tau */
-    class_call(background_module_->background_tau_of_z(z, &tau), background_module_->error_message_, error_message_);
+    class_call(background_module_->background_tau_of_z(z, &tau, error_message), error_message, error_message);
 
     ln_tau = log(tau);
     last_index = ln_tau_size_-1;
@@ -144,7 +147,7 @@ int NonlinearModule::nonlinear_pk_at_z(
 
       /** --> if ln(tau) much too small, raise an error */
       class_test(ln_tau < ln_tau_[0] - _EPSILON_,
-                 error_message_,
+                 error_message,
                  "requested z was not inside of tau tabulation range (Requested ln(tau_=%.10e, Min %.10e). Solution might be to increase input parameter z_max_pk (see explanatory.ini)",ln_tau,ln_tau_[0]);
 
       /** --> if ln(tau) too small but within tolerance, round it and get right values without interpolating */
@@ -169,7 +172,7 @@ int NonlinearModule::nonlinear_pk_at_z(
 
       /** --> if ln(tau) much too large, raise an error */
       class_test(ln_tau > ln_tau_[ln_tau_size_ - 1] + _EPSILON_,
-                 error_message_,
+                 error_message,
                  "requested z was not inside of tau tabulation range (Requested ln(tau_=%.10e, Max %.10e) ",
                  ln_tau,
                  ln_tau_[ln_tau_size_ - 1]);
@@ -207,9 +210,9 @@ int NonlinearModule::nonlinear_pk_at_z(
                                             &last_index,
                                             out_pk,
                                             k_size_,
-                                            error_message_),
-                   error_message_,
-                   error_message_);
+                                            error_message),
+                   error_message,
+                   error_message);
 
         /** --> interpolate P_ic_l(k) at tau from pre-computed array */
         if (do_ic == _TRUE_) {
@@ -222,9 +225,9 @@ int NonlinearModule::nonlinear_pk_at_z(
                                               &last_index,
                                               out_pk_ic,
                                               k_size_*ic_ic_size_,
-                                              error_message_),
-                     error_message_,
-                     error_message_);
+                                              error_message),
+                     error_message,
+                     error_message);
         }
       }
       else {
@@ -239,9 +242,9 @@ int NonlinearModule::nonlinear_pk_at_z(
                                             &last_index,
                                             out_pk,
                                             k_size_,
-                                            error_message_),
-                   error_message_,
-                   error_message_);
+                                            error_message),
+                   error_message,
+                   error_message);
       }
     }
   }
@@ -285,6 +288,10 @@ int NonlinearModule::nonlinear_pk_at_z(
   return _SUCCESS_;
 }
 
+int NonlinearModule::nonlinear_pk_at_z(enum linear_or_logarithmic mode, enum pk_outputs pk_output, double z, int index_pk, double * out_pk, double * out_pk_ic) const {
+  return nonlinear_pk_at_z(mode, pk_output, z, index_pk, out_pk, out_pk_ic, error_message_);
+}
+
 /*
  * Same as nonlinear_pk_at_z() (see the comments there about
  * the input/output format), excepted that we don't pass in input one
@@ -382,6 +389,8 @@ int NonlinearModule::nonlinear_pks_at_z(
  * @param index_pk    Input: index of pk type (_m, _cb)
  * @param out_pk      Output: pointer to P
  * @param out_pk_ic   Ouput:  P_ic returned as out_pk_ic_l[index_ic1_ic2]
+ * @param workspace Input: workspace of size nonlinear_pk_at_k_and_z_workspace_size(), so that the call does not allocate
+ * @param error_message Output: error message, owned by the caller (see "Concurrent queries" in base_module.h)
  * @return the error status
  */
 
@@ -391,7 +400,9 @@ int NonlinearModule::nonlinear_pk_at_k_and_z(
                                              double z,
                                              int index_pk,
                                              double * out_pk, // number *out_pk_l
-                                             double * out_pk_ic // array out_pk_ic_l[index_ic_ic]
+                                             double * out_pk_ic, // array out_pk_ic_l[index_ic_ic]
+                                             double * workspace, // array of size nonlinear_pk_at_k_and_z_workspace_size()
+                                             ErrorMsg error_message
                                              ) const {
 
   double * out_pk_at_z;
@@ -414,7 +425,7 @@ int NonlinearModule::nonlinear_pk_at_k_and_z(
       (the test for z will be done when calling nonlinear_pk_linear_at_z()) */
 
   class_test((k < 0.) || (k > exp(ln_k_[k_size_ - 1])),
-             error_message_,
+             error_message,
              "k=%e out of bounds [%e:%e]", k, 0., exp(ln_k_[k_size_ - 1]));
 
   /** - deal with case k = 0 for which P(k) is set to zero
@@ -436,44 +447,40 @@ int NonlinearModule::nonlinear_pk_at_k_and_z(
 
     /** --> First, get P(k) at the right z */
 
-    class_alloc(out_pk_at_z,
-                k_size_*sizeof(double),
-                error_message_);
-
+    out_pk_at_z = workspace;
+    ddout_pk_at_z = out_pk_at_z + k_size_;
     if (do_ic == _TRUE_) {
-      class_alloc(out_pk_ic_at_z,
-                  k_size_*ic_ic_size_*sizeof(double),
-                  error_message_);
+      out_pk_ic_at_z = ddout_pk_at_z + k_size_;
     }
+    ddout_pk_ic_at_z = ddout_pk_at_z + k_size_ + k_size_*ic_ic_size_;
+    pk_primordial_k = ddout_pk_ic_at_z + k_size_*ic_ic_size_;
+    pk_primordial_kmin = pk_primordial_k + ic_ic_size_;
 
     class_call(nonlinear_pk_at_z(linear,
                                  pk_output,
                                  z,
                                  index_pk,
                                  out_pk_at_z,
-                                 out_pk_ic_at_z
+                                 out_pk_ic_at_z,
+                                 error_message
                                  ),
-               error_message_,
-               error_message_);
+               error_message,
+               error_message);
 
     /** - deal with standard case kmin <= k <= kmax
         (just need to interpolate at the right k) */
 
     if (k > exp(ln_k_[0])) {
 
-      class_alloc(ddout_pk_at_z,
-                  k_size_*sizeof(double),
-                  error_message_);
-
       class_call(array_spline_table_lines(ln_k_,
                                           k_size_,
                                           out_pk_at_z,
                                           1,
                                           ddout_pk_at_z,
                                           _SPLINE_NATURAL_,
-                                          error_message_),
-                 error_message_,
-                 error_message_);
+                                          error_message),
+                 error_message,
+                 error_message);
 
       class_call(array_interpolate_spline(ln_k_,
                                           k_size_,
@@ -484,27 +491,21 @@ int NonlinearModule::nonlinear_pk_at_k_and_z(
                                           &last_index,
                                           out_pk,
                                           1,
-                                          error_message_),
-                 error_message_,
-                 error_message_);
-
-      free(ddout_pk_at_z);
+                                          error_message),
+                 error_message,
+                 error_message);
 
       if (do_ic == _TRUE_) {
 
-        class_alloc(ddout_pk_ic_at_z,
-                    k_size_*ic_ic_size_*sizeof(double),
-                    error_message_);
-
         class_call(array_spline_table_lines(ln_k_,
                                             k_size_,
                                             out_pk_ic_at_z,
                                             ic_ic_size_,
                                             ddout_pk_ic_at_z,
                                             _SPLINE_NATURAL_,
-                                            error_message_),
-                   error_message_,
-                   error_message_);
+                                            error_message),
+                   error_message,
+                   error_message);
 
         class_call(array_interpolate_spline(ln_k_,
                                             k_size_,
@@ -515,11 +516,9 @@ int NonlinearModule::nonlinear_pk_at_k_and_z(
                                             &last_index,
                                             out_pk_ic,
                                             ic_ic_size_,
-                                            error_message_),
-                   error_message_,
-                   error_message_);
-
-        free(ddout_pk_ic_at_z);
+                                            error_message),
+                   error_message,
+                   error_message);
       }
     }
 
@@ -549,31 +548,25 @@ int NonlinearModule::nonlinear_pk_at_k_and_z(
 
       /* compute P_primordial(k) */
 
-      class_alloc(pk_primordial_k,
-                  sizeof(double)*ic_ic_size_,
-                  error_message_);
-
       class_call(primordial_module_->primordial_spectrum_at_k(index_md_scalars_,
                                                              linear,
                                                              k,
-                                                             pk_primordial_k),
-                 primordial_module_->error_message_,
-                 error_message_);
+                                                             pk_primordial_k,
+                                                             error_message),
+                 error_message,
+                 error_message);
 
       /* compute P_primordial(kmin) */
 
       kmin = exp(ln_k_[0]);
 
-      class_alloc(pk_primordial_kmin,
-                  sizeof(double)*ic_ic_size_,
-                  error_message_);
-
       class_call(primordial_module_->primordial_spectrum_at_k(index_md_scalars_,
                                                              linear,
                                                              kmin,
-                                                             pk_primordial_kmin),
-                 primordial_module_->error_message_,
-                 error_message_);
+                                                             pk_primordial_kmin,
+                                                             error_message),
+                 error_message,
+                 error_message);
 
       /* finally, infer P(k) */
 
@@ -585,20 +578,38 @@ int NonlinearModule::nonlinear_pk_at_k_and_z(
                                      /kmin/pk_primordial_kmin[index_ic_ic]);
         }
       }
-
-      free(pk_primordial_k);
-      free(pk_primordial_kmin);
-    }
-
-    free(out_pk_at_z);
-    if (do_ic == _TRUE_) {
-      free(out_pk_ic_at_z);
     }
   }
 
   return _SUCCESS_;
 }
 
+int NonlinearModule::nonlinear_pk_at_k_and_z(enum pk_outputs pk_output, double k, double z, int index_pk, double * out_pk, double * out_pk_ic) const {
+  double * workspace;
+
+  class_alloc(workspace, nonlinear_pk_at_k_and_z_workspace_size()*sizeof(double), error_message_);
+
+  class_call_except(nonlinear_pk_at_k_and_z(pk_output, k, z, index_pk, out_pk, out_pk_ic, workspace, error_message_),
+                    error_message_,
+                    error_message_,
+                    free(workspace));
+
+  free(workspace);
+
+  return _SUCCESS_;
+}
+
+/**
+ * Size (in number of doubles) of the workspace that callers of the
+ * reentrant version of nonlinear_pk_at_k_and_z() must provide.
+ *
+ * @return the workspace size
+ */
+
+int NonlinearModule::nonlinear_pk_at_k_and_z_workspace_size() const {
+  return 2*k_size_*(1 + ic_ic_size_) + 2*ic_ic_size_;
+}
+
 /*
  * Same as nonlinear_pk_at_k_and_z() (see the comments there about
  * the input/output format), excepted that we don't pass in input one
@@ -722,31 +733,55 @@ int NonlinearModule::nonlinear_pks_at_kvec_and_zvec(
     class_alloc(ddln_pk_cb_table, sizeof(double)*k_size_*zvec_size, error_message_);
   }
 
-  /** - Construct table of log(P(k_n,z_j)) for pre-computed wavenumbers but requested redshifts: */
+  /** - Construct table of log(P(k_n,z_j)) for pre-computed wavenumbers but requested redshifts
+        (in parallel over redshifts, with one error message per redshift): */
+
+  ErrorMsg* error_messages;
+  class_alloc(error_messages, zvec_size*sizeof(ErrorMsg), error_message_);
+
+  Tools::ThreadLease thread_lease(number_of_workers(zvec_size, 50.*k_size_));
+  Tools::TaskSystem task_system(thread_lease.Count());
+  std::vector<std::future<int>> future_output;
 
   for (index_zvec=0; index_zvec<zvec_size; index_zvec++){
+    future_output.push_back(task_system.AsyncTask([this, pk_output, zvec, ln_pk_table, ln_pk_cb_table, error_messages, index_zvec] () {
+      if (has_pk_m_) {
+        class_call(nonlinear_pk_at_z(logarithmic,
+                                     pk_output,
+                                     zvec[index_zvec],
+                                     index_pk_m_,
+                                     &(ln_pk_table[index_zvec*k_size_]),
+                                     NULL,
+                                     error_messages[index_zvec]),
+                   error_messages[index_zvec],
+                   error_messages[index_zvec]);
+      }
+      if (has_pk_cb_) {
+        class_call(nonlinear_pk_at_z(logarithmic,
+                                     pk_output,
+                                     zvec[index_zvec],
+                                     index_pk_cb_,
+                                     &(ln_pk_cb_table[index_zvec*k_size_]),
+                                     NULL,
+                                     error_messages[index_zvec]),
+                   error_messages[index_zvec],
+                   error_messages[index_zvec]);
+      }
+      return _SUCCESS_;
+    }));
+  }
 
-    if (has_pk_m_) {
-      class_call(nonlinear_pk_at_z(logarithmic,
-                                   pk_output,
-                                   zvec[index_zvec],
-                                   index_pk_m_,
-                                   &(ln_pk_table[index_zvec*k_size_]),
-                                   NULL),
-                 error_message_,
-                 error_message_);
-    }
-    if (has_pk_m_) {
-      class_call(nonlinear_pk_at_z(logarithmic,
-                                   pk_output,
-                                   zvec[index_zvec],
-                                   index_pk_cb_,
-                                   &(ln_pk_cb_table[index_zvec*k_size_]),
-                                   NULL),
-                 error_message_,
-                 error_message_);
+  int status = _SUCCESS_;
+  for (index_zvec=0; index_zvec<zvec_size; index_zvec++){
+    if ((future_output[index_zvec].get() != _SUCCESS_) && (status == _SUCCESS_)) {
+      strcpy(error_message_, error_messages[index_zvec]);
+      status = _FAILURE_;
     }
   }
+  free(error_messages);
+  if (status == _FAILURE_) {
+    return _FAILURE_;
+  }
 
   /** - Spline it for interpolation along k */
 
@@ -1282,6 +1317,14 @@ int NonlinearModule::nonlinear_init() {
       class_alloc(ddlnpk_l[index_pk], k_size_extra_*sizeof(double), error_message_);
     }
 
+    /** --> Then go through preliminary steps specific to Halofit */
+
+    if (pnl->method == nl_halofit){
+      class_call(nonlinear_halofit_kernel_init(),
+                 error_message_,
+                 error_message_);
+    }
+
     /** --> Then go through preliminary steps specific to HMcode */
 
     if (pnl->method == nl_HMcode){
@@ -1499,19 +1542,16 @@ int NonlinearModule::nonlinear_free() {
 
   if ((has_pk_matter_ == _TRUE_) || (pnl->method > nl_none)) {
 
-    free(k_);
-    free(ln_k_);
+    /* k_, ln_k_, ln_tau_ and ln_pk_primordial_ belong to the grid service */
     free(is_non_zero_);
-    if (ppt->z_max_pk != 0.) {
-      free(ln_tau_);
-    }
-    
+
+
     for (index_pk = 0; index_pk < pk_size_; index_pk++) {
-      free(ln_pk_ic_l_[index_pk]);
-      free(ln_pk_l_[index_pk]);
+      class_free_table(ln_pk_ic_l_[index_pk]);
+      class_free_table(ln_pk_l_[index_pk]);
       if (ln_tau_size_ > 1) {
-        free(ddln_pk_ic_l_[index_pk]);
-        free(ddln_pk_l_[index_pk]);
+        class_free_table(ddln_pk_ic_l_[index_pk]);
+        class_free_table(ddln_pk_l_[index_pk]);
       }
     }
     free(ln_pk_ic_l_);
@@ -1527,13 +1567,13 @@ int NonlinearModule::nonlinear_free() {
 
   if (pnl->method > nl_none) {
 
-    free(tau_);
+    free(halofit_kernel_);
     for(index_pk = 0; index_pk < pk_size_; index_pk++){
-      free(nl_corr_density_[index_pk]);
+      class_free_table(nl_corr_density_[index_pk]);
       free(k_nl_[index_pk]);
-      free(ln_pk_nl_[index_pk]);
+      class_free_table(ln_pk_nl_[index_pk]);
       if (ln_tau_size_ > 1)
-        free(ddln_pk_nl_[index_pk]);
+        class_free_table(ddln_pk_nl_[index_pk]);
     }
     free(nl_corr_density_);
     free(k_nl_);
@@ -1612,6 +1652,12 @@ int NonlinearModule::nonlinear_indices() {
              error_message_,
              error_message_);
 
+  /** - tabulate the primordial spectrum on this list, since nonlinear_pk_linear() needs it at the same nodes for each time */
+
+  class_call(primordial_module_->primordial_spectrum_on_grid(index_md_scalars_, logarithmic, grid_service_->Find("nonlinear_ln_k"), &ln_pk_primordial_),
+             primordial_module_->error_message_,
+             error_message_);
+
   /** - get list of tau values */
 
   class_call(nonlinear_get_tau_list(), error_message_, error_message_);
@@ -1622,8 +1668,8 @@ int NonlinearModule::nonlinear_indices() {
   class_alloc(ln_pk_l_, pk_size_*sizeof(double*), error_message_);
 
   for (index_pk = 0; index_pk < pk_size_; index_pk++) {
-    class_alloc(ln_pk_ic_l_[index_pk], ln_tau_size_*k_size_*ic_ic_size_*sizeof(double*), error_message_);
-    class_alloc(ln_pk_l_[index_pk], ln_tau_size_*k_size_*sizeof(double*), error_message_);
+    class_alloc_table(ln_pk_ic_l_[index_pk], ln_tau_size_*k_size_*ic_ic_size_*sizeof(double*), error_message_);
+    class_alloc_table(ln_pk_l_[index_pk], ln_tau_size_*k_size_*sizeof(double*), error_message_);
   }
 
   /** - if interpolation of \f$P(k,\tau)\f$ will be needed (as a function of tau),
@@ -1635,8 +1681,8 @@ int NonlinearModule::nonlinear_indices() {
     class_alloc(ddln_pk_l_, pk_size_*sizeof(double*), error_message_);
 
     for (index_pk = 0; index_pk < pk_size_; index_pk++) {
-      class_alloc(ddln_pk_ic_l_[index_pk], ln_tau_size_*k_size_*ic_ic_size_*sizeof(double*), error_message_);
-      class_alloc(ddln_pk_l_[index_pk], ln_tau_size_*k_size_*sizeof(double*), error_message_);
+      class_alloc_table(ddln_pk_ic_l_[index_pk], ln_tau_size_*k_size_*ic_ic_size_*sizeof(double*), error_message_);
+      class_alloc_table(ddln_pk_l_[index_pk], ln_tau_size_*k_size_*sizeof(double*), error_message_);
     }
   }
 
@@ -1660,10 +1706,10 @@ int NonlinearModule::nonlinear_indices() {
 
     for (index_pk = 0; index_pk < pk_size_; index_pk++){
       class_alloc(k_nl_[index_pk], tau_size_*sizeof(double), error_message_);
-      class_alloc(nl_corr_density_[index_pk], tau_size_*k_size_*sizeof(double), error_message_);
-      class_alloc(ln_pk_nl_[index_pk], ln_tau_size_*k_size_*sizeof(double*), error_message_);
+      class_alloc_table(nl_corr_density_[index_pk], tau_size_*k_size_*sizeof(double), error_message_);
+      class_alloc_table(ln_pk_nl_[index_pk], ln_tau_size_*k_size_*sizeof(double*), error_message_);
       if (ln_tau_size_ > 1)
-        class_alloc(ddln_pk_nl_[index_pk], ln_tau_size_*k_size_*sizeof(double*), error_message_);
+        class_alloc_table(ddln_pk_nl_[index_pk], ln_tau_size_*k_size_*sizeof(double*), error_message_);
     }
   }
 
@@ -1727,11 +1773,20 @@ int NonlinearModule::nonlinear_get_k_list() {
     ln_k_[index_k] = log(k) + exponent*log(10.);
   }
 
+  /** - publish the lists in the grid service: without extrapolation, k_ is then the list of the perturbation module */
+  class_call(share_grid("nonlinear_k", k_size_extra_, &k_),
+             error_message_,
+             error_message_);
+  class_call(share_grid("nonlinear_ln_k", k_size_extra_, &ln_k_),
+             error_message_,
+             error_message_);
+
   return _SUCCESS_;
 }
 
 /**
- * Copy list of tau from perturbation module
+ * Get the lists of tau of the perturbation module from the grid service
+ * (no copy)
  *
  * @param ppt Input: pointer to perturbation structure
  * @param pnl Input/Output: pointer to nonlinear structure
@@ -1740,30 +1795,18 @@ int NonlinearModule::nonlinear_get_k_list() {
 
 int NonlinearModule::nonlinear_get_tau_list() {
 
-  int index_tau;
-
   /** -> for linear calculations: only late times are considered, given the value z_max_pk inferred from the ionput */
   ln_tau_size_ = perturbations_module_->ln_tau_size_;
 
   if (perturbations_module_->ln_tau_size_ > 1) {
-
-    class_alloc(ln_tau_, ln_tau_size_*sizeof(double), error_message_);
-
-    for (index_tau = 0; index_tau < ln_tau_size_; index_tau++) {
-      ln_tau_[index_tau] = perturbations_module_->ln_tau_[index_tau];
-    }
+    ln_tau_ = grid_service_->Find("ln_tau")->Nodes();
   }
 
   /** -> for non-linear calculations: we wills store a correction factor for all times */
   if (pnl->method > nl_none) {
 
     tau_size_ = perturbations_module_->tau_size_;
-
-    class_alloc(tau_, tau_size_*sizeof(double), error_message_);
-
-    for (index_tau = 0; index_tau < tau_size_; index_tau++) {
-      tau_[index_tau] = perturbations_module_->tau_sampling_[index_tau];
-    }
+    tau_ = grid_service_->Find("tau_sampling")->Nodes();
   }
   return _SUCCESS_;
 }
@@ -1939,17 +1982,13 @@ int NonlinearModule::nonlinear_pk_linear(
   int index_k;
   int index_tp;
   int index_ic1,index_ic2,index_ic1_ic1,index_ic1_ic2,index_ic2_ic2;
-  double * primordial_pk;
+  const double * primordial_pk;
   double pk;
   double * pk_ic;
   double source_ic1;
   double source_ic2;
   double cosine_correlation;
 
-  /** - allocate temporary vector where the primordial spectrum will be stored */
-
-  class_alloc(primordial_pk, ic_ic_size_*sizeof(double), error_message_);
-
   class_alloc(pk_ic, ic_ic_size_*sizeof(double), error_message_);
 
   if ((has_pk_m_ == _TRUE_) && (index_pk == index_pk_m_)) {
@@ -1966,10 +2005,8 @@ int NonlinearModule::nonlinear_pk_linear(
 
   for (index_k=0; index_k<k_size; index_k++) {
 
-    /** --> get primordial spectrum */
-    class_call(primordial_module_->primordial_spectrum_at_k(index_md_scalars_, logarithmic, ln_k_[index_k], primordial_pk),
-               primordial_module_->error_message_,
-               error_message_);
+    /** --> get primordial spectrum, tabulated on ln_k_ by nonlinear_indices() */
+    primordial_pk = ln_pk_primordial_ + index_k*ic_ic_size_;
 
     /** --> initialize a local variable for P_m(k) and P_cb(k) to zero */
     pk = 0.;
@@ -2059,7 +2096,6 @@ int NonlinearModule::nonlinear_pk_linear(
     lnpk[index_k] = log(pk);
   }
 
-  free(primordial_pk);
   free(pk_ic);
 
   return _SUCCESS_;
@@ -2362,7 +2398,7 @@ int NonlinearModule::nonlinear_halofit(
   int index_k;
   double pk_lin,pk_quasi,pk_halo,rk;
   double sigma,rknl,rneff,rncur,d1,d2;
-  double diff,xlogr1,xlogr2,rmid;
+  double diff,rmid;
 
   double gam,a,b,c,xmu,xnu,alpha,beta,f1,f2,f3;
   double pk_linaa;
@@ -2376,25 +2412,16 @@ int NonlinearModule::nonlinear_halofit(
   double sum1,sum2,sum3;
   double anorm;
 
-  double *integrand_array;
+  double *integrand;
   int integrand_size;
-  int index_ia_k;
-  int index_ia_pk;
-  int index_ia_sum;
-  int index_ia_ddsum;
-  /*
-    int index_ia_sum2;
-    int index_ia_ddsum2;
-    int index_ia_sum3;
-    int index_ia_ddsum3;
-  */
-  int ia_size;
-  int index_ia;
+  int index_R_low, index_R_high, index_R_mid, index_R_first;
+  int index_node;
+  double ln_sigma2_node[4], d1_node[4], d2_node[4];
+  double u1, u2, umid;
 
   double k_integrand;
   double lnpk_integrand;
 
-  double R;
 
   double * w_and_Omega;
 
@@ -2464,26 +2491,18 @@ int NonlinearModule::nonlinear_halofit(
   /*      Until the 17.02.2015 the values of k used for integrating sigma(R) quantities needed by Halofit where the same as in the perturbation module.
           Since then, we sample these integrals on more values, in order to get more precise integrals (thanks Matteo Zennaro for noticing the need for this).
 
-          We create a temporary integrand_array which columns will be:
-          - k in 1/Mpc
-          - just linear P(k) in Mpc**3
-          - 1/(2(pi**2)) P(k) k**2 exp(-(kR)**2) or 1/(2(pi**2)) P(k) k**2 2 (kR) exp(-(kR)**2) or 1/(2(pi**2)) P(k) k**2 4 (kR)(1-kR) exp(-(kR)**2)
-          - second derivative of previous line with spline
+          The integrals are done in ln(k) with the trapezoidal rule, on the
+          grid of nonlinear_halofit_kernel_init(). We store in integrand
+          1/(2(pi**2)) P(k) k**3 times the quadrature weight, such that each
+          moment at a node of the R grid is a dot product with the
+          pre-computed window functions (see nonlinear_halofit_moments()).
   */
 
-  index_ia=0;
-  class_define_index(index_ia_k,     _TRUE_,index_ia,1);
-  class_define_index(index_ia_pk,    _TRUE_,index_ia,1);
-  class_define_index(index_ia_sum,   _TRUE_,index_ia,1);
-  class_define_index(index_ia_ddsum, _TRUE_,index_ia,1);
-  ia_size = index_ia;
-
-  integrand_size=(int)(log(k_[k_size_ - 1]/k_[0])/log(10.)*ppr->halofit_k_per_decade) + 1;
+  integrand_size = halofit_integrand_size_;
 
-  class_alloc(integrand_array, integrand_size*ia_size*sizeof(double), error_message_);
+  class_alloc(integrand, integrand_size*sizeof(double), error_message_);
 
-
-  /* we fill integrand_array with values of k and P(k) using interpolation */
+  /* we fill integrand with values of P(k) using interpolation */
 
   last_index=0;
 
@@ -2511,9 +2530,10 @@ int NonlinearModule::nonlinear_halofit(
                  error_message_);
     }
 
-    integrand_array[index_k*ia_size + index_ia_k] = k_integrand;
-    integrand_array[index_k*ia_size + index_ia_pk] = exp(lnpk_integrand);
-
+    integrand[index_k] = exp(lnpk_integrand)*pow(k_integrand, 3)*anorm*halofit_dlnR_;
+    if ((index_k == 0) || (index_k == integrand_size - 1)) {
+      integrand[index_k] *= 0.5;
+    }
   }
 
   class_call(background_module_->background_at_tau(tau, pba->long_info, pba->inter_normal, &last_index, pvecback),
@@ -2538,25 +2558,11 @@ int NonlinearModule::nonlinear_halofit(
      result at the *highest* redshift at which halofit can make
      computations, at the expense of requiring a larger k_max; but
      this parameter is not relevant for the precision on P_nl(k,z) at
-     other redshifts, so there is normally no need to change i
+     other redshifts, so there is normally no need to change i.
+     This value is the first node of the R grid.
   */
 
-  R=sqrt(-log(ppr->halofit_sigma_precision))/integrand_array[(integrand_size-1)*ia_size + index_ia_k];
-
-  class_call(nonlinear_halofit_integrate(
-                                         integrand_array,
-                                         integrand_size,
-                                         ia_size,
-                                         index_ia_k,
-                                         index_ia_pk,
-                                         index_ia_sum,
-                                         index_ia_ddsum,
-                                         R,
-                                         halofit_integral_one,
-                                         &sum1
-                                         ),
-             error_message_,
-             error_message_);
+  nonlinear_halofit_moments(integrand, 0, &sum1, NULL, NULL);
 
   sigma  = sqrt(sum1);
 
@@ -2567,143 +2573,93 @@ int NonlinearModule::nonlinear_halofit(
      commands to avoid memory leaks, and calling this whole function
      not through a class_call) */
 
-  /*
-    class_test_except(sigma < 1.,
-    error_message_,
-    free(pvecback);free(integrand_array),
-    "Your k_max=%g 1/Mpc is too small for Halofit to find the non-linearity scale z_nl at z=%g. Increase input parameter P_k_max_h/Mpc or P_k_max_1/Mpc",
-    k_[k_size_-1],
-    pba->a_today/pvecback[background_module_->index_bg_a_]-1.);
-  */
-
   if (sigma < 1.) {
     * nl_corr_not_computable_at_this_k = _TRUE_;
     free(pvecback);
-    free(integrand_array);
+    free(integrand);
     return _SUCCESS_;
   }
   else {
     * nl_corr_not_computable_at_this_k = _FALSE_;
   }
 
-  xlogr1 = log(R)/log(10.);
-
-  /* maximum value of R in the bisection algorithm leading to the
-     determination of R_nl.  For this value we can make a
-     conservaitive guess: 1/halofit_min_k_nonlinear, where
+  /* maximum value of R in the search for R_nl.  For this value we
+     can make a conservaitive guess: 1/halofit_min_k_nonlinear, where
      halofit_min_k_nonlinear is the minimum value of k at which we ask
      halofit to give us an estimate of P_nl(k,z). By assumption we
      treat all smaller k's as linear, so we know that
      sigma(1/halofit_min_k_nonlinear) must be <<1 (and if it is not
-     the test below will alert us) */
-
-  R=1./ppr->halofit_min_k_nonlinear;
-
-  /* corresponding value of sigma_R */
-  class_call(nonlinear_halofit_integrate(
-                                         integrand_array,
-                                         integrand_size,
-                                         ia_size,
-                                         index_ia_k,
-                                         index_ia_pk,
-                                         index_ia_sum,
-                                         index_ia_ddsum,
-                                         R,
-                                         halofit_integral_one,
-                                         &sum1
-                                         ),
-             error_message_,
-             error_message_);
+     the test below will alert us). The last node of the R grid is
+     just above this value. */
+
+  nonlinear_halofit_moments(integrand, halofit_R_size_ - 1, &sum1, NULL, NULL);
 
   sigma  = sqrt(sum1);
 
-  class_test(sigma > 1.,
-             error_message_,
-             "Your input value for the precision parameter halofit_min_k_nonlinear=%e is too large, such that sigma(R=1/halofit_min_k_nonlinear)=% > 1. For self-consistency, it should have been <1. Decrease halofit_min_k_nonlinear",
-             ppr->halofit_min_k_nonlinear,sigma);
+  class_test_except(sigma > 1.,
+                    error_message_,
+                    free(pvecback);free(integrand),
+                    "Your input value for the precision parameter halofit_min_k_nonlinear=%e is too large, such that sigma(R=1/halofit_min_k_nonlinear)=% > 1. For self-consistency, it should have been <1. Decrease halofit_min_k_nonlinear",
+                    ppr->halofit_min_k_nonlinear,sigma);
+
+  /* find the two nodes of the R grid between which sigma crosses one */
+
+  index_R_low = 0;
+  index_R_high = halofit_R_size_ - 1;
+  while (index_R_high - index_R_low > 1) {
+    index_R_mid = (index_R_low + index_R_high)/2;
+    nonlinear_halofit_moments(integrand, index_R_mid, &sum1, NULL, NULL);
+    if (sum1 > 1.) {
+      index_R_low = index_R_mid;
+    }
+    else {
+      index_R_high = index_R_mid;
+    }
+  }
 
-  xlogr2 = log(R)/log(10.);
+  /* tabulate ln(sigma^2) and its first two logarithmic derivatives
+     on the four nodes around the crossing */
 
+  index_R_first = MAX(0, MIN(index_R_low - 1, halofit_R_size_ - 4));
+  for (index_node = 0; index_node < 4; index_node++) {
+    nonlinear_halofit_moments(integrand, index_R_first + index_node, &sum1, &sum2, &sum3);
+    ln_sigma2_node[index_node] = log(sum1);
+    d1_node[index_node] = -sum2/sum1;
+    d2_node[index_node] = -sum2*sum2/sum1/sum1 - sum3/sum1;
+  }
+
+  free(integrand);
+
+  /* solve sigma(R_nl) = 1 by bisection on the cubic interpolation
+     of ln(sigma^2) in ln(R), with u = (ln(R)-ln(R_first))/dlnR */
+
+  u1 = index_R_low - index_R_first;
+  u2 = u1 + 1.;
   counter = 0;
   do {
-    rmid = pow(10,(xlogr2+xlogr1)/2.0);
+    umid = 0.5*(u1 + u2);
     counter ++;
 
-    class_call(nonlinear_halofit_integrate(
-                                           integrand_array,
-                                           integrand_size,
-                                           ia_size,
-                                           index_ia_k,
-                                           index_ia_pk,
-                                           index_ia_sum,
-                                           index_ia_ddsum,
-                                           rmid,
-                                           halofit_integral_one,
-                                           &sum1
-                                           ),
-               error_message_,
-               error_message_);
+    diff = 0.5*nonlinear_halofit_cubic(ln_sigma2_node, umid);
 
-    sigma  = sqrt(sum1);
-
-    diff = sigma - 1.0;
-
-    if (diff > ppr->halofit_tol_sigma){
-      xlogr1=log10(rmid);
+    if (diff > 0.) {
+      u1 = umid;
     }
-    else if (diff < -ppr->halofit_tol_sigma) {
-      xlogr2 = log10(rmid);
+    else {
+      u2 = umid;
     }
 
-    /* The first version of this test woukld let the code continue: */
-    /*
-      class_test_except(counter > _MAX_IT_,
-      error_message_,
-      free(pvecback);free(integrand_array),
-      "could not converge within maximum allowed number of iterations");
-    */
-    /* ... but in this situation it sounds better to make it stop and return an error! */
-    class_test(counter > _MAX_IT_,
-               error_message_,
-               "could not converge within maximum allowed number of iterations");
+    class_test_except(counter > _MAX_IT_,
+                      error_message_,
+                      free(pvecback),
+                      "could not converge within maximum allowed number of iterations");
 
   } while (fabs(diff) > ppr->halofit_tol_sigma);
 
-  /* evaluate all the other integrals at R=rmid */
-
-  class_call(nonlinear_halofit_integrate(
-                                         integrand_array,
-                                         integrand_size,
-                                         ia_size,
-                                         index_ia_k,
-                                         index_ia_pk,
-                                         index_ia_sum,
-                                         index_ia_ddsum,
-                                         rmid,
-                                         halofit_integral_two,
-                                         &sum2
-                                         ),
-             error_message_,
-             error_message_);
-
-  class_call(nonlinear_halofit_integrate(
-                                         integrand_array,
-                                         integrand_size,
-                                         ia_size,
-                                         index_ia_k,
-                                         index_ia_pk,
-                                         index_ia_sum,
-                                         index_ia_ddsum,
-                                         rmid,
-                                         halofit_integral_three,
-                                         &sum3
-                                         ),
-             error_message_,
-             error_message_);
+  rmid = halofit_R_min_*exp((index_R_first + umid)*halofit_dlnR_);
 
-  sigma  = sqrt(sum1);
-  d1 = -sum2/sum1;
-  d2 = -sum2*sum2/sum1/sum1 - sum3/sum1;
+  d1 = nonlinear_halofit_cubic(d1_node, umid);
+  d2 = nonlinear_halofit_cubic(d2_node, umid);
 
   rknl  = 1./rmid;
   rneff = -3.-d1;
@@ -2773,85 +2729,109 @@ int NonlinearModule::nonlinear_halofit(
   }
 
   free(pvecback);
-  free(integrand_array);
   return _SUCCESS_;
 }
 
 /**
- * Internal routione of Halofit. In original Halofit, this is
- * equivalent to the function wint(). It performs convolutions of the
- * linear spectrum with two window functions.
+ * Tabulate the Gaussian window functions of Halofit.
+ *
+ * The moments of the linear spectrum needed by Halofit are integrals
+ * over ln(k), sampled with halofit_k_per_decade points per decade
+ * between k_min and k_max. We sample R with the same logarithmic step,
+ * from R_min = sqrt(-ln(halofit_sigma_precision))/k_max to just above
+ * 1/halofit_min_k_nonlinear. The window functions then only depend on
+ * index_k + index_R, and are computed once for all redshifts:
+ *
+ * - exp(-(kR)**2)
+ * - 2 (kR)**2 exp(-(kR)**2)
+ * - 4 (kR)**2 (1-(kR)**2) exp(-(kR)**2)
  *
- * @param pnl             Input: pointer to non linear structure
- * @param integrand_array Input: array with k, P_L(k) values
- * @param integrand_size  Input: one dimension of that array
- * @param ia_size         Input: other dimension of that array
- * @param index_ia_k      Input: index for k
- * @param index_ia_pk     Input: index for pk
- * @param index_ia_sum    Input: index for the result
- * @param index_ia_ddsum  Input: index for its spline
- * @param R               Input: radius
- * @param type            Input: which window function to use
- * @param sum             Output: result of the integral
  * @return the error status
  */
 
-int NonlinearModule::nonlinear_halofit_integrate(
-                                                 double * integrand_array,
-                                                 int integrand_size,
-                                                 int ia_size,
-                                                 int index_ia_k,
-                                                 int index_ia_pk,
-                                                 int index_ia_sum,
-                                                 int index_ia_ddsum,
-                                                 double R,
-                                                 enum halofit_integral_type type,
-                                                 double * sum
-                                                 ) {
-
-  double k,pk,x2,integrand;
-  int index_k;
-  double anorm = 1./(2*pow(_PI_,2));
+int NonlinearModule::nonlinear_halofit_kernel_init() {
 
-  for (index_k=0; index_k < integrand_size; index_k++) {
-    k = integrand_array[index_k*ia_size + index_ia_k];
-    pk = integrand_array[index_k*ia_size + index_ia_pk];
-    x2 = k*k*R*R;
+  int index_kR;
+  double k_max, x0, x2, window;
 
-    integrand = pk*k*k*anorm*exp(-x2);
-    if (type == halofit_integral_two) integrand *= 2.*x2;
-    if (type == halofit_integral_three) integrand *= 4.*x2*(1.-x2);
+  halofit_integrand_size_ = (int)(log(k_[k_size_ - 1]/k_[0])/log(10.)*ppr->halofit_k_per_decade) + 1;
+  halofit_dlnR_ = log(10.)/ppr->halofit_k_per_decade;
 
-    integrand_array[index_k*ia_size + index_ia_sum] = integrand;
-  }
+  k_max = k_[0]*pow(10., (halofit_integrand_size_ - 1)/ppr->halofit_k_per_decade);
+  halofit_R_min_ = sqrt(-log(ppr->halofit_sigma_precision))/k_max;
+  halofit_R_size_ = (int)ceil(log(1./ppr->halofit_min_k_nonlinear/halofit_R_min_)/halofit_dlnR_) + 1;
 
-  /* fill in second derivatives */
-  class_call(array_spline(integrand_array,
-                          ia_size,
-                          integrand_size,
-                          index_ia_k,
-                          index_ia_sum,
-                          index_ia_ddsum,
-                          _SPLINE_NATURAL_,
-                          error_message_),
-             error_message_,
-             error_message_);
-
-  /* integrate */
-  class_call(array_integrate_all_spline(integrand_array,
-                                        ia_size,
-                                        integrand_size,
-                                        index_ia_k,
-                                        index_ia_sum,
-                                        index_ia_ddsum,
-                                        sum,
-                                        error_message_),
+  class_test(halofit_R_size_ < 4,
              error_message_,
-             error_message_);
+             "k_max=%g 1/Mpc is too small compared to halofit_min_k_nonlinear=%g 1/Mpc for Halofit", k_[k_size_ - 1], ppr->halofit_min_k_nonlinear);
+
+  halofit_kernel_size_ = halofit_integrand_size_ + halofit_R_size_ - 1;
+  class_alloc(halofit_kernel_, 3*halofit_kernel_size_*sizeof(double), error_message_);
+
+  x0 = k_[0]*halofit_R_min_;
+  for (index_kR = 0; index_kR < halofit_kernel_size_; index_kR++) {
+    x2 = pow(x0*exp(index_kR*halofit_dlnR_), 2);
+    window = exp(-x2);
+    halofit_kernel_[index_kR] = window;
+    halofit_kernel_[halofit_kernel_size_ + index_kR] = 2.*x2*window;
+    halofit_kernel_[2*halofit_kernel_size_ + index_kR] = 4.*x2*(1.-x2)*window;
+  }
 
   return _SUCCESS_;
 }
 
+/**
+ * Internal routine of Halofit. In original Halofit, this is
+ * equivalent to the function wint(). It performs convolutions of the
+ * linear spectrum with the three window functions, at the node
+ * index_R of the R grid.
+ *
+ * @param integrand  Input: weighted integrand, see nonlinear_halofit()
+ * @param index_R    Input: index of R on the grid of nonlinear_halofit_kernel_init()
+ * @param sum1       Output: sigma^2(R)
+ * @param sum2       Output: -d sigma^2/d ln(R), not computed if NULL
+ * @param sum3       Output: moment with the third window, not computed if NULL
+ */
+
+void NonlinearModule::nonlinear_halofit_moments(const double * integrand,
+                                                int index_R,
+                                                double * sum1,
+                                                double * sum2,
+                                                double * sum3
+                                                ) const {
+
+  const double * window1 = halofit_kernel_ + index_R;
+  const double * window2 = window1 + halofit_kernel_size_;
+  const double * window3 = window2 + halofit_kernel_size_;
+  double s1 = 0., s2 = 0., s3 = 0.;
+  int index_k;
+
+  if (sum2 == NULL) {
+    for (index_k = 0; index_k < halofit_integrand_size_; index_k++) {
+      s1 += integrand[index_k]*window1[index_k];
+    }
+  }
+  else {
+    for (index_k = 0; index_k < halofit_integrand_size_; index_k++) {
+      s1 += integrand[index_k]*window1[index_k];
+      s2 += integrand[index_k]*window2[index_k];
+      s3 += integrand[index_k]*window3[index_k];
+    }
+    *sum2 = s2;
+    *sum3 = s3;
+  }
+  *sum1 = s1;
+}
+
+/**
+ * Cubic interpolation through four equally spaced nodes y[0..3], at
+ * position u in units of the node spacing.
+ */
+
+double NonlinearModule::nonlinear_halofit_cubic(const double * y, double u) const {
+  return -y[0]*(u-1.)*(u-2.)*(u-3.)/6. + y[1]*u*(u-2.)*(u-3.)/2. - y[2]*u*(u-1.)*(u-3.)/2. + y[3]*u*(u-1.)*(u-2.)/6.;
+}
+
 /**
  * Computes the nonlinear correction on the linear power spectrum via
  * the method presented in Mead et al. 1505.07833
@@ -2923,7 +2903,6 @@ int NonlinearModule::nonlinear_hmcode(
   double z_form, g_form;
 
   double eta;
-  double gst, window_nfw;
   double nu_cut;
   double fac, k_star, fdamp;
   double pk_lin, pk_2h, pk_1h;
@@ -2940,6 +2919,14 @@ int NonlinearModule::nonlinear_hmcode(
 
   double * p1h_integrand;
 
+  /* per-mass quantities of the 1-halo integrand, independent of k */
+  double * ks_over_k;
+  double * norm_nfw;
+  double * hmf;
+  double * ks;
+  double * window;
+  double * vec_workspace;
+
 
   /** include precision parameters that control the number of entries in the growth and sigma tables */
   ng = ppr->n_hmcode_tables;
@@ -3242,32 +3229,43 @@ int NonlinearModule::nonlinear_hmcode(
   i++;
   index_ncol=i;
 
-  for (index_k = 0; index_k < k_size_; index_k++){
+  class_alloc(p1h_integrand, index_cut*index_ncol*sizeof(double), error_message_);
+  class_alloc(ks_over_k, index_cut*sizeof(double), error_message_);
+  class_alloc(norm_nfw, index_cut*sizeof(double), error_message_);
+  class_alloc(hmf, index_cut*sizeof(double), error_message_);
+  class_alloc(ks, index_cut*sizeof(double), error_message_);
+  class_alloc(window, index_cut*sizeof(double), error_message_);
+  class_alloc(vec_workspace, 9*index_cut*sizeof(double), error_message_);
+
+  /* The window is evaluated at k nu^eta, with scale radius r_virial/conc. Everything
+     except the overall factor k only depends on the mass, so it is tabulated once here. */
+  for (index_mass=0; index_mass<index_cut; index_mass++){
+    norm_nfw[index_mass] = 1.+conc[index_mass];
+  }
+  class_call(vector_pow(index_cut, nu_arr, eta, ks_over_k), error_message_, error_message_);
+  class_call(vector_log(index_cut, norm_nfw, norm_nfw), error_message_, error_message_);
+  for (index_mass=0; index_mass<index_cut; index_mass++){
+    ks_over_k[index_mass] *= r_virial[index_mass]/conc[index_mass];
+    norm_nfw[index_mass] = 1./(norm_nfw[index_mass]-conc[index_mass]/(1.+conc[index_mass]));
+    p1h_integrand[index_mass*index_ncol+index_nu] = nu_arr[index_mass];
+  }
+  class_call(nonlinear_hmcode_halomassfunction_vec(index_cut, nu_arr, hmf, vec_workspace),
+             error_message_, error_message_);
 
-    class_alloc(p1h_integrand, index_cut*index_ncol*sizeof(double), error_message_);
+  for (index_k = 0; index_k < k_size_; index_k++){
 
     pk_lin = exp(lnpk_l[index_pk][index_k])*pow(k_[index_k], 3)*anorm; //convert P_k to Delta_k^2
 
-    for (index_mass=0; index_mass<index_cut; index_mass++){ //Calculates the integrand for the ph1 integral at all nu values
-      //get the nu^eta-value of the window
-      class_call(nonlinear_hmcode_window_nfw(
-                                             pow(nu_arr[index_mass], eta)*k_[index_k],
-                                             r_virial[index_mass],
-                                             conc[index_mass],
-                                             &window_nfw),
-                 error_message_, error_message_);
-      //get the value of the halo mass function
-      class_call(nonlinear_hmcode_halomassfunction(
-                                                   nu_arr[index_mass],
-                                                   &gst),
-                 error_message_, error_message_);
-
-      p1h_integrand[index_mass*index_ncol+index_nu] = nu_arr[index_mass];
-
-      p1h_integrand[index_mass*index_ncol+index_y] = mass[index_mass]*gst*pow(window_nfw, 2.);
-      //if ((tau==background_module_->conformal_age_) && (index_k == 0)) {
-      //fprintf(stdout, "%d %e %e\n", index_cut, p1h_integrand[index_mass*index_ncol+index_nu], p1h_integrand[index_mass*index_ncol+index_y]);
-      //}
+    for (index_mass=0; index_mass<index_cut; index_mass++){
+      ks[index_mass] = k_[index_k]*ks_over_k[index_mass];
+    }
+
+    /* window function and halo mass function at all nu values of the p1h integral at once */
+    class_call(nonlinear_hmcode_window_nfw_vec(index_cut, ks, conc, norm_nfw, window, vec_workspace),
+               error_message_, error_message_);
+
+    for (index_mass=0; index_mass<index_cut; index_mass++){
+      p1h_integrand[index_mass*index_ncol+index_y] = mass[index_mass]*hmf[index_mass]*window[index_mass]*window[index_mass];
     }
     class_call(array_spline(p1h_integrand,
                             index_ncol,
@@ -3311,9 +3309,16 @@ int NonlinearModule::nonlinear_hmcode(
     if (pk_2h<0.) pk_2h=0.;
     pk_nl[index_k] = pow((pow(pk_1h, alpha) + pow(pk_2h, alpha)), (1./alpha))/pow(k_[index_k], 3)/anorm; //converted back to P_k
 
-    free(p1h_integrand);
   }
 
+  free(p1h_integrand);
+  free(ks_over_k);
+  free(norm_nfw);
+  free(hmf);
+  free(ks);
+  free(window);
+  free(vec_workspace);
+
   // print parameter values
   if ((pnl->nonlinear_verbose > 1 && tau == background_module_->conformal_age_) || pnl->nonlinear_verbose > 3){
     fprintf(stdout, " -> Parameters at redshift z = %e:\n", z_at_tau);
@@ -3846,6 +3851,50 @@ int NonlinearModule::nonlinear_hmcode_window_nfw(double k, double rv, double c,
   return _SUCCESS_;
 }
 
+/**
+ * Vectorised version of nonlinear_hmcode_window_nfw(), evaluating the
+ * window for all masses of the 1-halo integral at once. The sine and
+ * cosine integrals at ks and ks(1+c) are computed together with the
+ * sines and cosines they share, and sin(ks c) follows from those by the
+ * addition theorem.
+ *
+ * @param size       Input: number of masses
+ * @param ks         Input: array of k*rv/c, with virial radius rv
+ * @param c          Input: array of concentrations c = rv/rs
+ * @param norm       Input: array of 1/(ln(1+c)-c/(1+c))
+ * @param window_nfw Output: Window Function of the NFW profile
+ * @param workspace  Input: workspace of size 9*size
+ * @return the error status
+ */
+
+int NonlinearModule::nonlinear_hmcode_window_nfw_vec(int size, double* ks, double* c, double* norm, double* window_nfw, double* workspace){
+  double * ks2 = workspace;
+  double * si1 = workspace + size;
+  double * ci1 = workspace + 2*size;
+  double * sin1 = workspace + 3*size;
+  double * cos1 = workspace + 4*size;
+  double * si2 = workspace + 5*size;
+  double * ci2 = workspace + 6*size;
+  double * sin2 = workspace + 7*size;
+  double * cos2 = workspace + 8*size;
+  int i;
+
+  for (i=0; i<size; i++){
+    ks2[i] = ks[i]*(1.+c[i]);
+  }
+
+  class_call(vector_trigonometric_integrals(size, ks, si1, ci1, sin1, cos1), error_message_, error_message_);
+  class_call(vector_trigonometric_integrals(size, ks2, si2, ci2, sin2, cos2), error_message_, error_message_);
+
+  for (i=0; i<size; i++){
+    window_nfw[i] = (cos1[i]*(ci2[i]-ci1[i])
+                     + sin1[i]*(si2[i]-si1[i])
+                     - (sin2[i]*cos1[i]-cos2[i]*sin1[i])/ks2[i])*norm[i];
+  }
+
+  return _SUCCESS_;
+}
+
 /**
  * This is the Sheth-Tormen halo mass function (1999, MNRAS, 308, 119)
  *
@@ -3870,6 +3919,47 @@ int NonlinearModule::nonlinear_hmcode_halomassfunction(
   return _SUCCESS_;
 }
 
+/**
+ * Vectorised version of nonlinear_hmcode_halomassfunction()
+ *
+ * @param size       Input: number of \f$ \nu \f$ values
+ * @param nu         Input: array of \f$ \nu \f$ values
+ * @param hmf        Output: Value of the halo mass function at each \f$ \nu \f$
+ * @param workspace  Input: workspace of size 2*size
+ * @return the error status
+ */
+
+int NonlinearModule::nonlinear_hmcode_halomassfunction_vec(
+                                                           int size,
+                                                           double * nu,
+                                                           double * hmf,
+                                                           double * workspace
+                                                           ){
+
+  double p, q, A;
+  double * qnu2 = workspace;
+  double * expo = workspace + size;
+  int i;
+
+  p=0.3;
+  q=0.707;
+  A=0.21616;
+
+  for (i=0; i<size; i++){
+    qnu2[i] = q*nu[i]*nu[i];
+    expo[i] = -qnu2[i]/2.;
+  }
+
+  class_call(vector_pow(size, qnu2, -p, hmf), error_message_, error_message_);
+  class_call(vector_exp(size, expo, expo), error_message_, error_message_);
+
+  for (i=0; i<size; i++){
+    hmf[i] = A*(1.+hmf[i])*expo[i];
+  }
+
+  return _SUCCESS_;
+}
+
 /**
  * Compute sigma8(z)
  *
@@ -4189,11 +4279,12 @@ int NonlinearModule::prepare_pk_eq() {
   class_alloc(pk_eq_w_and_Omega_, pk_eq_tau_size_*pk_eq_size_*sizeof(double), error_message_);
   class_alloc(pk_eq_ddw_and_ddOmega_, pk_eq_tau_size_*pk_eq_size_*sizeof(double), error_message_);
 
-  /** - call the background module in order to fill a table of tau_i[z_i] */
-  std::unique_ptr<InputModule> input{new InputModule(input_module_->file_content_)};
-  /** - the fake calls of the background and thermodynamics module will be done in non-verbose mode */
-  input->background_.background_verbose = 0;
-  input->thermodynamics_.thermodynamics_verbose = 0;
+  /** - call the background module in order to fill a table of tau_i[z_i]. The
+      fake models are copies of our input module (no re-parsing), with
+      a few overridden fields; their background and thermodynamics
+      modules are run in non-verbose mode */
+  std::unique_ptr<InputModule> input{new InputModule(*input_module_)};
+  input->SetVerbose(0);
   Cosmology cosmology{std::move(input)};
   BackgroundModulePtr background_module = cosmology.GetBackgroundModule();
   ThermodynamicsModulePtr thermodynamics_module = cosmology.GetThermodynamicsModule();
@@ -4228,11 +4319,9 @@ int NonlinearModule::prepare_pk_eq() {
 
     double w0_fld = pba->w0_fld;
     do {
-      input.reset(new InputModule(input_module_->file_content_));
-      input->background_.background_verbose = 0;
-      input->thermodynamics_.thermodynamics_verbose = 0;
-      input->background_.w0_fld = w0_fld;
-      input->background_.wa_fld = 0.0;
+      input.reset(new InputModule(*input_module_));
+      input->SetVerbose(0);
+      input->SetFluidEquationOfState(w0_fld, 0.0);
 
       Cosmology cosmology{std::move(input)};
       background_module = cosmology.GetBackgroundModule();
@@ -4259,8 +4348,6 @@ int NonlinearModule::prepare_pk_eq() {
     pk_eq_w_and_Omega_[pk_eq_size_*index_pk_eq_z + index_pk_eq_Omega_m_] = pvecback[background_module->index_bg_Omega_m_];
     free(pvecback);
 
-    class_call(background_module->background_free_noinput(), background_module->error_message_, error_message_);
-
   }
 
   /* in verbose mode, report the results */
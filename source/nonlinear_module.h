@@ -11,8 +11,11 @@ public:
 
   /* external functions (meant to be called from other modules) */
   int nonlinear_pk_at_z(enum linear_or_logarithmic mode, enum pk_outputs pk_output, double z, int index_pk, double* out_pk, double* out_pk_ic) const;
+  int nonlinear_pk_at_z(enum linear_or_logarithmic mode, enum pk_outputs pk_output, double z, int index_pk, double* out_pk, double* out_pk_ic, ErrorMsg error_message) const;
   int nonlinear_pks_at_z(enum linear_or_logarithmic mode, enum pk_outputs pk_output, double z, double* out_pk, double* out_pk_ic, double* out_pk_cb, double* out_pk_cb_ic) const;
   int nonlinear_pk_at_k_and_z(enum pk_outputs pk_output, double k, double z, int index_pk, double* out_pk, double* out_pk_ic) const;
+  int nonlinear_pk_at_k_and_z(enum pk_outputs pk_output, double k, double z, int index_pk, double* out_pk, double* out_pk_ic, double* workspace, ErrorMsg error_message) const;
+  int nonlinear_pk_at_k_and_z_workspace_size() const;
   int nonlinear_pks_at_k_and_z(enum pk_outputs pk_output, double k, double z, double* out_pk, double* out_pk_ic, double* out_pk_cb, double* out_pk_cb_ic) const;
   int nonlinear_pks_at_kvec_and_zvec(enum pk_outputs pk_output, double* kvec, int kvec_size, double* zvec, int zvec_size, double* out_pk, double* out_pk_cb) const;
   int nonlinear_sigmas_at_z(double R, double z, int index_pk, enum out_sigmas sigma_output, double* result) const;
@@ -50,7 +53,9 @@ private:
   int nonlinear_pk_linear(int index_pk, int index_tau, int k_size, double* lnpk, double* lnpk_ic);
   int nonlinear_sigmas(double R, double* lnpk_l, double* ddlnpk_l, int k_size, double k_per_decade, enum out_sigmas sigma_output, double* result) const;
   int nonlinear_halofit(int index_pk, double tau, double* pk_nl, double* lnpk_l, double* ddlnpk_l, double* k_nl, short* halofit_found_k_max);
-  int nonlinear_halofit_integrate(double* integrand_array, int integrand_size, int ia_size, int index_ia_k, int index_ia_pk, int index_ia_sum, int index_ia_ddsum, double R, enum halofit_integral_type type, double* sum);
+  int nonlinear_halofit_kernel_init();
+  void nonlinear_halofit_moments(const double* integrand, int index_R, double* sum1, double* sum2, double* sum3) const;
+  double nonlinear_halofit_cubic(const double* y, double u) const;
   int nonlinear_hmcode(int index_pk, int index_tau, double tau, double*pk_nl, double** lnpk_l, double** ddlnpk_l, double* k_nl, short* halofit_found_k_max, nonlinear_workspace* pnw);
   int nonlinear_hmcode_workspace_init(nonlinear_workspace* pnw);
   int nonlinear_hmcode_workspace_free(nonlinear_workspace* pnw);
@@ -60,7 +65,9 @@ private:
   int nonlinear_hmcode_fill_growtab(nonlinear_workspace* pnw);
   int nonlinear_hmcode_growint(double a, double w, double wa, double* growth);
   int nonlinear_hmcode_window_nfw(double k, double rv, double c, double* window_nfw);
+  int nonlinear_hmcode_window_nfw_vec(int size, double* ks, double* c, double* norm, double* window_nfw, double* workspace);
   int nonlinear_hmcode_halomassfunction(double nu, double* hmf);
+  int nonlinear_hmcode_halomassfunction_vec(int size, double* nu, double* hmf, double* workspace);
   int nonlinear_hmcode_sigma8_at_z(double z, double* sigma_8, double* sigma_8_cb, nonlinear_workspace* pnw);
   int nonlinear_hmcode_sigmadisp_at_z(double z, double* sigma_disp, double* sigma_disp_cb, nonlinear_workspace* pnw);
   int nonlinear_hmcode_sigmadisp100_at_z(double z, double* sigma_disp_100, double* sigma_disp_100_cb, nonlinear_workspace* pnw);
@@ -83,7 +90,8 @@ private:
                         some output at z>0, instead of only z=0.  This
                         array only covers late times, used for the
                         output of P(k) or T(k), and matching the
-                        condition z(tau) < z_max_pk */
+                        condition z(tau) < z_max_pk (grid "ln_tau" of the
+                        perturbation module in the grid service) */
 
   int ln_tau_size_;     /**< number of values in this array */
 
@@ -134,10 +142,12 @@ private:
   //@{
 
   int k_size_extra_;/** total number of k values of extrapolated k array (high k)*/
+  double* ln_pk_primordial_; /**< ln_pk_primordial_[index_k*ic_ic_size_ + index_ic1_ic2] = primordial spectrum on ln_k_, in the logarithmic format of primordial_spectrum_at_k() (owned by the grid service) */
 
   int tau_size_;    /**< tau_size = number of values */
   double* tau_;    /**< tau[index_tau] = list of time values, covering
-                      all the values of the perturbation module */
+                      all the values of the perturbation module (its grid
+                      "tau_sampling" in the grid service) */
 
   double** k_nl_;              /**< wavenumber at which non-linear corrections become important,
                                     defined differently by different non_linear_method's */
@@ -168,6 +178,14 @@ private:
   int index_pk_cluster_;    /**< equal to index_pk_cb if it exists, otherwise to index_pk_m
                               (always defined, useful e.g. for galaxy clustering spectrum) */
 
+  int halofit_integrand_size_;    /**< for Halofit: number of ln(k) values in the integrals */
+  int halofit_R_size_;            /**< for Halofit: number of R values on which sigma(R) can be evaluated */
+  double halofit_R_min_;          /**< for Halofit: smallest R, in Mpc */
+  double halofit_dlnR_;           /**< for Halofit: step in ln(R), equal to the step in ln(k) */
+  int halofit_kernel_size_;       /**< for Halofit: number of values of k*R */
+  double* halofit_kernel_ = nullptr; /**< for Halofit: the three window functions,
+                                        halofit_kernel_[index_window*halofit_kernel_size_ + index_k + index_R] */
+
   double c_min_;      /** for HMcode: minimum concentration in Bullock 2001 mass-concentration relation */
   double eta_0_;      /** for HMcode: halo bloating parameter */
 
@@ -891,28 +891,32 @@ int OutputModule::output_tk() {
   number_of_titles = get_number_of_titles(titles);
   size_data = number_of_titles*perturbations_module_->k_size_[index_md];
 
-  class_alloc(data, sizeof(double)*perturbations_module_->ic_size_[index_md]*size_data, error_message_);
+  /** - first, check that requested redshifts z_pk are consistent */
 
   for (index_z = 0; index_z < pop->z_pk_num; index_z++) {
-
-    z = pop->z_pk[index_z];
-
-    /** - first, check that requested redshift z_pk is consistent */
-
     class_test((pop->z_pk[index_z] > ppt->z_max_pk),
                error_message_,
                "T_i(k,z) computed up to z=%f but requested at z=%f. Must increase z_max_pk in precision file.",ppt->z_max_pk,pop->z_pk[index_z]);
+  }
+
+  /** - second, compute the transfer functions at all redshifts at once */
+
+  class_alloc(data, sizeof(double)*pop->z_pk_num*perturbations_module_->ic_size_[index_md]*size_data, error_message_);
+
+  class_call(perturbations_module_->perturb_output_data_at_z_list(pop->output_format, pop->z_pk_num, pop->z_pk, number_of_titles, data),
+             perturbations_module_->error_message_,
+             error_message_);
+
+  for (index_z = 0; index_z < pop->z_pk_num; index_z++) {
+
+    z = pop->z_pk[index_z];
 
     if (pop->z_pk_num == 1)
       redshift_suffix[0]='\0';
     else
       sprintf(redshift_suffix,"z%d_",index_z+1);
 
-    /** - second, open only the relevant files, and write a heading in each of them */
-
-    class_call(perturbations_module_->perturb_output_data(pop->output_format, pop->z_pk[index_z], number_of_titles, data),
-               perturbations_module_->error_message_,
-               error_message_);
+    /** - third, open only the relevant files, and write a heading in each of them */
 
     for (index_ic = 0; index_ic < perturbations_module_->ic_size_[index_md]; index_ic++) {
 
@@ -960,7 +964,7 @@ int OutputModule::output_tk() {
 
       output_print_data(tkfile,
                         titles,
-                        data+index_ic*size_data,
+                        data+(index_z*perturbations_module_->ic_size_[index_md] + index_ic)*size_data,
                         size_data);
 
       /** - free memory and close files */
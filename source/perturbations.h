@@ -293,6 +293,11 @@ struct perturb_vector
                             perturbations enter in the calculation of
                             source functions */
 
+  int * index_map;       /**< index of each perturbation in the vector of
+                            the previous approximation interval, or -1 if
+                            it did not exist there (NULL in the first
+                            interval) */
+
 };
 
 
@@ -402,6 +407,7 @@ struct perturb_workspace
   int index_ap_rsa_idr; /**< index for dark radiation streaming approximation */
   int index_ap_ufa; /**< index for ur fluid approximation */
   int index_ap_ncdmfa; /**< index for ncdm fluid approximation */
+  int index_ap_lmax; /**< index for the truncation level of the Boltzmann hierarchies (if l_max_adaptive) */
   int ap_size;      /**< number of relevant approximations for a given mode */
 
   int * approx;     /**< array of approximation flags holding at a given time: approx[index_ap] */
@@ -52,6 +52,10 @@ int PerturbationsModule::perturb_sources(double tau, double* pvecperturbations,
   auto pppaw = static_cast<perturb_parameters_and_workspace*>(parameters_and_workspace);
   return pppaw->perturbations_module->perturb_sources_member(tau, pvecperturbations, pvecderivs, index_tau, parameters_and_workspace, error_message);
 }
+int PerturbationsModule::perturb_sources_block(double* tau, double* pvecperturbations, double* pvecderivs, int index_tau, int tau_block_size, int y_stride, void* parameters_and_workspace, ErrorMsg error_message) {
+  auto pppaw = static_cast<perturb_parameters_and_workspace*>(parameters_and_workspace);
+  return pppaw->perturbations_module->perturb_sources_block_member(tau, pvecperturbations, pvecderivs, index_tau, tau_block_size, y_stride, parameters_and_workspace, error_message);
+}
 int PerturbationsModule::perturb_print_variables(double tau, double* y, double* dy, void* parameters_and_workspace, ErrorMsg error_message) {
   auto pppaw = static_cast<perturb_parameters_and_workspace*>(parameters_and_workspace);
   return pppaw->perturbations_module->perturb_print_variables_member(tau, y, dy, parameters_and_workspace, error_message);
@@ -78,6 +82,10 @@ int PerturbationsModule::perturb_derivs(double tau, double* y, double* dy, void*
  */
 
 int PerturbationsModule::perturb_sources_at_tau(int index_md, int index_ic, int index_tp, double tau, double* psource) const {
+  return perturb_sources_at_tau(index_md, index_ic, index_tp, tau, psource, error_message_);
+}
+
+int PerturbationsModule::perturb_sources_at_tau(int index_md, int index_ic, int index_tp, double tau, double* psource, ErrorMsg error_message) const {
 
   /** Summary: */
 
@@ -104,9 +112,9 @@ int PerturbationsModule::perturb_sources_at_tau(int index_md, int index_ic, int
                                          tau,
                                          psource,
                                          k_size_[index_md],
-                                         error_message_),
-               error_message_,
-               error_message_);
+                                         error_message),
+               error_message,
+               error_message);
   }
 
   /** - more accurate spline interpolation at late times (z<z_max_pk),
@@ -124,9 +132,9 @@ int PerturbationsModule::perturb_sources_at_tau(int index_md, int index_ic, int
                                         &last_index,
                                         psource,
                                         k_size_[index_md],
-                                        error_message_),
-               error_message_,
-               error_message_);
+                                        error_message),
+               error_message,
+               error_message);
   }
 
   return _SUCCESS_;
@@ -147,6 +155,62 @@ int PerturbationsModule::perturb_sources_at_tau(int index_md, int index_ic, int
  */
 
 int PerturbationsModule::perturb_output_data(enum file_format output_format, double z, int number_of_titles, double* data) const {
+  return perturb_output_data(output_format, z, number_of_titles, data, error_message_);
+}
+
+/**
+ * Same as perturb_output_data(), for a list of redshifts at once. The
+ * output is the contiguous array
+ * data[((index_z*ic_size + index_ic)*k_size + index_k)*number_of_titles + index_title],
+ * i.e. one block of perturb_output_data() per redshift. The redshifts are
+ * processed in parallel. Nothing is done for an empty list.
+ *
+ * @param output_format    Input: choice of ordering and normalisation for the output quantities
+ * @param z_size           Input: number of redshifts
+ * @param z                Input: redshifts
+ * @param number_of_titles Input: number of requested source functions (found in perturb_output_titles)
+ * @param data             Output: source functions for all redshifts, k values and initial conditions (previously allocated with the right size)
+ * @return the error status
+ */
+
+int PerturbationsModule::perturb_output_data_at_z_list(enum file_format output_format, int z_size, const double* z, int number_of_titles, double* data) const {
+
+  int index_md = index_md_scalars_;
+  int block_size = ic_size_[index_md]*k_size_[index_md]*number_of_titles;
+
+  if (z_size == 0) {
+    return _SUCCESS_;
+  }
+  if (z_size == 1) {
+    return perturb_output_data(output_format, z[0], number_of_titles, data, error_message_);
+  }
+
+  /* one error message per redshift, since the tasks run concurrently */
+  ErrorMsg* error_messages;
+  class_alloc(error_messages, z_size*sizeof(ErrorMsg), error_message_);
+
+  Tools::ThreadLease thread_lease(number_of_workers(z_size, 20.*block_size));
+  Tools::TaskSystem task_system(thread_lease.Count());
+  std::vector<std::future<int>> future_output;
+
+  for (int index_z = 0; index_z < z_size; index_z++) {
+    future_output.push_back(task_system.AsyncTask([this, output_format, z, number_of_titles, data, block_size, error_messages, index_z] () {
+      return perturb_output_data(output_format, z[index_z], number_of_titles, data + index_z*block_size, error_messages[index_z]);
+    }));
+  }
+
+  int status = _SUCCESS_;
+  for (int index_z = 0; index_z < z_size; index_z++) {
+    if ((future_output[index_z].get() != _SUCCESS_) && (status == _SUCCESS_)) {
+      strcpy(error_message_, error_messages[index_z]);
+      status = _FAILURE_;
+    }
+  }
+  free(error_messages);
+  return status;
+}
+
+int PerturbationsModule::perturb_output_data(enum file_format output_format, double z, int number_of_titles, double* data, ErrorMsg error_message) const {
 
   int n_ncdm;
   double k, k_over_h, k2;
@@ -168,7 +232,7 @@ int PerturbationsModule::perturb_output_data(enum file_format output_format, dou
   if (k_size_[index_md]*ic_size_[index_md]*tp_size_[index_md] > 0) {
     class_alloc(tkfull,
                 k_size_[index_md]*ic_size_[index_md]*tp_size_[index_md]*sizeof(double),
-                error_message_);
+                error_message);
   }
 
   /** - compute \f$T_i(k)\f$ for each k (if several ic's, compute it for each ic; if z_pk = 0, this is done by directly reading inside the pre-computed table; if not, this is done by interpolating the table at the correct value of tau. */
@@ -191,29 +255,31 @@ int PerturbationsModule::perturb_output_data(enum file_format output_format, dou
   else {
 
     /* check the time corresponding to the highest redshift requested in output plus one */
-    class_call(background_module_->background_tau_of_z(z, &tau),
-               background_module_->error_message_,
-               error_message_);
+    class_call(background_module_->background_tau_of_z(z, &tau, error_message),
+               error_message,
+               error_message);
 
     class_test(log(tau) < ln_tau_[0],
-               "Asking sources at a z bigger than z_max_pk, something probably went wrong\n",
-               error_message_);
+               error_message,
+               "Asking sources at a z bigger than z_max_pk, something probably went wrong\n");
 
     class_alloc(pvecsources,
                 k_size_[index_md]*sizeof(double),
-                error_message_);
-
-    for (index_k = 0; index_k < k_size_[index_md]; index_k++) {
-      for (index_tp = 0; index_tp < tp_size_[index_md]; index_tp++) {
-        for (index_ic = 0; index_ic < ic_size_[index_md]; index_ic++) {
-          class_call(perturb_sources_at_tau(index_md,
-                                            index_ic,
-                                            index_tp,
-                                            tau,
-                                            pvecsources),
-                     error_message_,
-                     error_message_);
+                error_message);
 
+    /* each call interpolates one source type at all k at once */
+    for (index_tp = 0; index_tp < tp_size_[index_md]; index_tp++) {
+      for (index_ic = 0; index_ic < ic_size_[index_md]; index_ic++) {
+        class_call(perturb_sources_at_tau(index_md,
+                                          index_ic,
+                                          index_tp,
+                                          tau,
+                                          pvecsources,
+                                          error_message),
+                   error_message,
+                   error_message);
+
+        for (index_k = 0; index_k < k_size_[index_md]; index_k++) {
           tkfull[(index_k*ic_size_[index_md] + index_ic)*tp_size_[index_md] + index_tp] = pvecsources[index_k];
         }
       }
@@ -249,8 +315,8 @@ int PerturbationsModule::perturb_output_data(enum file_format output_format, dou
           class_store_double(dataptr, tk[index_tp_delta_ur_], has_source_delta_ur_, storeidx);
           class_store_double(dataptr, tk[index_tp_delta_idr_], has_source_delta_idr_, storeidx);
           if (pba->has_ncdm == _TRUE_){
-            for (n_ncdm = 0; n_ncdm < pba->N_ncdm; n_ncdm++){
-              class_store_double(dataptr, tk[index_tp_delta_ncdm1_ + n_ncdm], has_source_delta_ncdm_, storeidx);
+            for (n_ncdm = 0; n_ncdm < pba->ncdm->N_ncdm_input_; n_ncdm++){
+              class_store_double(dataptr, tk[index_tp_delta_ncdm1_ + pba->ncdm->ncdm_of_input_[n_ncdm]], has_source_delta_ncdm_, storeidx);
             }
           }
           class_store_double(dataptr, tk[index_tp_delta_dcdm_], has_source_delta_dcdm_, storeidx);
@@ -277,8 +343,8 @@ int PerturbationsModule::perturb_output_data(enum file_format output_format, dou
           class_store_double(dataptr, tk[index_tp_theta_ur_], has_source_theta_ur_, storeidx);
           class_store_double(dataptr, tk[index_tp_theta_idr_], has_source_theta_idr_, storeidx);
           if (pba->has_ncdm == _TRUE_){
-            for (n_ncdm = 0; n_ncdm < pba->N_ncdm; n_ncdm++){
-              class_store_double(dataptr, tk[index_tp_theta_ncdm1_ + n_ncdm], has_source_theta_ncdm_, storeidx);
+            for (n_ncdm = 0; n_ncdm < pba->ncdm->N_ncdm_input_; n_ncdm++){
+              class_store_double(dataptr, tk[index_tp_theta_ncdm1_ + pba->ncdm->ncdm_of_input_[n_ncdm]], has_source_theta_ncdm_, storeidx);
             }
           }
           class_store_double(dataptr, tk[index_tp_theta_dcdm_], has_source_theta_dcdm_, storeidx);
@@ -337,7 +403,7 @@ int PerturbationsModule::perturb_output_titles(enum file_format output_format, c
       class_store_columntitle(titles, "d_ur", pba->has_ur);
       class_store_columntitle(titles, "d_idr", pba->has_idr);
       if (pba->has_ncdm == _TRUE_) {
-        for (n_ncdm=0; n_ncdm < pba->N_ncdm; n_ncdm++) {
+        for (n_ncdm=0; n_ncdm < pba->ncdm->N_ncdm_input_; n_ncdm++) {
           sprintf(tmp, "d_ncdm[%d]", n_ncdm);
           class_store_columntitle(titles, tmp, _TRUE_);
         }
@@ -366,7 +432,7 @@ int PerturbationsModule::perturb_output_titles(enum file_format output_format, c
       class_store_columntitle(titles, "t_ur", pba->has_ur);
       class_store_columntitle(titles, "t_idr", pba->has_idr);
       if (pba->has_ncdm == _TRUE_) {
-        for (n_ncdm=0; n_ncdm < pba->N_ncdm; n_ncdm++) {
+        for (n_ncdm=0; n_ncdm < pba->ncdm->N_ncdm_input_; n_ncdm++) {
           sprintf(tmp, "t_ncdm[%d]", n_ncdm);
           class_store_columntitle(titles, tmp, _TRUE_);
         }
@@ -658,10 +724,19 @@ int PerturbationsModule::perturb_init() {
 
   /** - create an array of workspaces in multi-thread case */
 
-  /** - loop over modes (scalar, tensors, etc). For each mode: */
-  Tools::TaskSystem task_system(pba->number_of_threads);
+  /** - take the workers for the wavenumbers of all modes and initial
+        conditions; each of them integrates the perturbations over many
+        more time steps than the tau_size_ source samples */
+  int k_task_count = 0;
+  for (index_md = 0; index_md < md_size_; index_md++) {
+    k_task_count += ic_size_[index_md]*k_size_[index_md];
+  }
+  std::unique_ptr<Tools::ThreadLease> thread_lease(new Tools::ThreadLease(number_of_workers(k_task_count, 1.e3*tau_size_)));
+  std::unique_ptr<Tools::TaskSystem> task_system(new Tools::TaskSystem(thread_lease->Count()));
   std::vector<std::future<int>> future_output;
 
+  /** - loop over modes (scalar, tensors, etc). For each mode: */
+
   for (index_md = 0; index_md < md_size_; index_md++) {
 
     if (ppt->perturbations_verbose > 1)
@@ -678,7 +753,7 @@ int PerturbationsModule::perturb_init() {
 
       /* integrating backwards is slightly more optimal for parallel runs */
       for (index_k = k_size_[index_md] - 1; index_k >= 0; index_k--) {
-        future_output.push_back(task_system.AsyncTask([this, index_md, index_ic, index_k] () {
+        future_output.push_back(task_system->AsyncTask([this, index_md, index_ic, index_k] () {
           if (ppt->perturbations_verbose > 2) {
             printf("evolving mode k=%e /Mpc  (%d/%d)", k_[index_md][index_k], index_k + 1, k_size_[index_md]);
             if (pba->sgnK != 0)
@@ -713,12 +788,24 @@ int PerturbationsModule::perturb_init() {
 
   if (ln_tau_size_ > 1) {
 
+    /* the splines are much cheaper than the wavenumbers: start again with as many workers as they are worth */
+    int tp_task_count = 0;
+    double tp_work = 0.;
+    for (index_md = 0; index_md < md_size_; index_md++) {
+      tp_task_count += ic_size_[index_md]*tp_size_[index_md];
+      tp_work += 10.*ic_size_[index_md]*tp_size_[index_md]*ln_tau_size_*k_size_[index_md];
+    }
+    task_system.reset();
+    thread_lease.reset();
+    thread_lease.reset(new Tools::ThreadLease(number_of_workers(tp_task_count, tp_work/MAX(tp_task_count, 1))));
+    task_system.reset(new Tools::TaskSystem(thread_lease->Count()));
+
     for (index_md = 0; index_md < md_size_; index_md++) {
 
       for (index_ic = 0; index_ic < ic_size_[index_md]; index_ic++) {
 
         for (index_tp = 0; index_tp < tp_size_[index_md]; index_tp++) {
-          future_output.push_back(task_system.AsyncTask([this, index_md, index_tp, index_ic] () {
+          future_output.push_back(task_system->AsyncTask([this, index_md, index_tp, index_ic] () {
             class_call(array_spline_table_lines(ln_tau_,
                                                 ln_tau_size_,
                                                 late_sources_[index_md][index_ic*tp_size_[index_md] + index_tp],
@@ -769,9 +856,9 @@ int PerturbationsModule::perturb_free() {
 
         for (index_tp = 0; index_tp < tp_size_[index_md]; index_tp++) {
 
-          free(sources_[index_md][index_ic*tp_size_[index_md] + index_tp]);
+          class_free_table(sources_[index_md][index_ic*tp_size_[index_md] + index_tp]);
           if (ln_tau_size_ > 1)
-            free(ddlate_sources_[index_md][index_ic*tp_size_[index_md] + index_tp]);
+            class_free_table(ddlate_sources_[index_md][index_ic*tp_size_[index_md] + index_tp]);
 
         }
       }
@@ -780,13 +867,9 @@ int PerturbationsModule::perturb_free() {
       free(late_sources_[index_md]);
       free(ddlate_sources_[index_md]);
 
-      free(k_[index_md]);
-
     }
 
-    free(tau_sampling_);
-    if (ln_tau_size_ > 1)
-      free(ln_tau_);
+    /* tau_sampling_, ln_tau_, k_[index_md] and the tables at each tau belong to the grid service */
 
     free(tp_size_);
 
@@ -1270,6 +1353,7 @@ int PerturbationsModule::perturb_timesampling_for_sources() {
   double tau_mid;
 
   double timescale_source;
+  const Tools::Grid* tau_sampling_grid;
   double rate_thermo;
   double rate_isw_squared;
   double a_prime_over_a;
@@ -1541,6 +1625,55 @@ int PerturbationsModule::perturb_timesampling_for_sources() {
   free(pvecback);
   free(pvecthermo);
 
+  /** - hand the time sampling over to the grid service, so that the
+      non-linear and transfer modules use the same nodes */
+
+  class_call(share_grid("tau_sampling", tau_size_, &tau_sampling_),
+             error_message_,
+             error_message_);
+  tau_sampling_grid = grid_service_->Find("tau_sampling");
+
+  /** - tabulate the background and thermodynamics quantities needed
+      by perturb_sources() at each sampling point, once for all
+      wavenumbers */
+
+  class_call(grid_service_->Tabulate(tau_sampling_grid,
+                                     "background_normal",
+                                     background_module_->bg_size_normal_,
+                                     [&] (double* table) {
+                                       last_index_back = first_index_back;
+                                       for (index_tau = 0; index_tau < tau_size_; index_tau++) {
+                                         class_call(background_module_->background_at_tau(tau_sampling_[index_tau], pba->normal_info, pba->inter_closeby, &last_index_back, table + index_tau*background_module_->bg_size_normal_),
+                                                    background_module_->error_message_,
+                                                    error_message_);
+                                       }
+                                       return _SUCCESS_;
+                                     },
+                                     &background_at_tau_sampling_),
+             error_message_,
+             error_message_);
+
+  class_call(grid_service_->Tabulate(tau_sampling_grid,
+                                     "thermodynamics",
+                                     thermodynamics_module_->th_size_,
+                                     [&] (double* table) {
+                                       last_index_thermo = first_index_thermo;
+                                       for (index_tau = 0; index_tau < tau_size_; index_tau++) {
+                                         pvecback = background_at_tau_sampling_ + index_tau*background_module_->bg_size_normal_;
+                                         class_call(thermodynamics_module_->thermodynamics_at_z(pba->a_today/pvecback[background_module_->index_bg_a_] - 1.,
+                                                                                               thermodynamics_module_->inter_closeby_,
+                                                                                               &last_index_thermo,
+                                                                                               pvecback,
+                                                                                               table + index_tau*thermodynamics_module_->th_size_),
+                                                    thermodynamics_module_->error_message_,
+                                                    error_message_);
+                                       }
+                                       return _SUCCESS_;
+                                     },
+                                     &thermodynamics_at_tau_sampling_),
+             error_message_,
+             error_message_);
+
   /** - check the maximum redshift z_max_pk at which the Fourier
       transfer functions \f$ T_i(k,z)\f$ should be computable by
       interpolation. If it is equal to zero, only \f$ T_i(k,z=0)\f$
@@ -1592,6 +1725,10 @@ int PerturbationsModule::perturb_timesampling_for_sources() {
     for (index_tau = 0; index_tau < ln_tau_size_; index_tau++) {
       ln_tau_[index_tau] = log(tau_sampling_[index_tau - ln_tau_size_ + tau_size_]);
     }
+
+    class_call(share_grid("ln_tau", ln_tau_size_, &ln_tau_),
+               error_message_,
+               error_message_);
   }
 
   /** - loop over modes, initial conditions and types. For each of
@@ -1601,18 +1738,18 @@ int PerturbationsModule::perturb_timesampling_for_sources() {
     for (index_ic = 0; index_ic < ic_size_[index_md]; index_ic++) {
       for (index_tp = 0; index_tp < tp_size_[index_md]; index_tp++) {
 
-        class_alloc(sources_[index_md][index_ic*tp_size_[index_md] + index_tp],
-                    k_size_[index_md]*tau_size_*sizeof(double),
-                    error_message_);
+        class_alloc_table(sources_[index_md][index_ic*tp_size_[index_md] + index_tp],
+                          k_size_[index_md]*tau_size_*sizeof(double),
+                          error_message_);
 
         if (ln_tau_size_ > 1) {
           /* late_sources is just a pointer to the end of sources (starting from the relevant time index) */
           late_sources_[index_md][index_ic*tp_size_[index_md] + index_tp] =
             &(sources_[index_md][index_ic*tp_size_[index_md] + index_tp][(tau_size_ - ln_tau_size_)*k_size_[index_md]]);
 
-          class_alloc(ddlate_sources_[index_md][index_ic*tp_size_[index_md] + index_tp],
-                      k_size_[index_md]*ln_tau_size_*sizeof(double),
-                      error_message_);
+          class_alloc_table(ddlate_sources_[index_md][index_ic*tp_size_[index_md] + index_tp],
+                            k_size_[index_md]*ln_tau_size_*sizeof(double),
+                            error_message_);
         }
       }
     }
@@ -2240,6 +2377,14 @@ int PerturbationsModule::perturb_get_k_list() {
   free(k_max_cmb);
   free(k_max_cl);
 
+  /** - hand the k lists over to the grid service, so that the other modules use the same nodes */
+
+  for (index_mode = 0; index_mode < md_size_; index_mode++) {
+    class_call(share_grid("k_" + std::to_string(index_mode), k_size_[index_mode], &(k_[index_mode])),
+               error_message_,
+               error_message_);
+  }
+
   return _SUCCESS_;
 
 }
@@ -2367,6 +2512,7 @@ int PerturbationsModule::perturb_workspace_init(int index_md, perturb_workspace*
     class_define_index(ppw->index_ap_ncdmfa,pba->has_ncdm,index_ap,1);
     class_define_index(ppw->index_ap_tca_idm_dr,pba->has_idm_dr,index_ap,1);
     class_define_index(ppw->index_ap_rsa_idr,pba->has_idr,index_ap,1);
+    class_define_index(ppw->index_ap_lmax,ppr->l_max_adaptive,index_ap,1);
 
   }
 
@@ -2395,6 +2541,9 @@ int PerturbationsModule::perturb_workspace_init(int index_md, perturb_workspace*
     if (pba->has_ncdm == _TRUE_) {
       ppw->approx[ppw->index_ap_ncdmfa]=(int)ncdmfa_off;
     }
+    if (ppr->l_max_adaptive == _TRUE_) {
+      ppw->approx[ppw->index_ap_lmax]=0;
+    }
   }
 
   if (_tensors_) {
@@ -2524,6 +2673,24 @@ int PerturbationsModule::perturb_solve(int index_md, int index_ic, int index_k,
   /* approximation scheme within previous interval: previous_approx[index_ap] */
   int * previous_approx;
 
+  /* state of the ndf15 evolver carried from one interval to the next;
+     held in a struct so that it is released on the error paths too */
+  struct WarmStart {
+    struct ndf15_warm_start state;
+    WarmStart() { ndf15_warm_start_init(&state); }
+    ~WarmStart() { ndf15_warm_start_free(&state); }
+  } warm_start;
+
+  /* pieces of an interval with constant tolerance (see perturb_tolerance_schedule()) */
+  int piece_number;
+  int index_piece;
+  double piece_limit[4];
+  double piece_tolerance[3];
+  /* index map of the pieces after the first one; a vector so that it is
+     released on the error paths too */
+  std::vector<int> identity_map;
+  int index_pt;
+
   int n_ncdm,is_early_enough;
 
   /* Related to the perturbation output */
@@ -2743,33 +2910,74 @@ int PerturbationsModule::perturb_solve(int index_md, int index_ic, int index_k,
                error_message_,
                error_message_);
 
-    /** - --> (d) integrate the perturbations over the current interval. */
-
-    auto generic_evolver = &evolver_ndf15;
-    if(ppr->evolver == rk){
-        generic_evolver = &evolver_rk;
-    }
-//    }
-
-    class_call(generic_evolver(perturb_derivs,
-                               interval_limit[index_interval],
-                               interval_limit[index_interval+1],
-                               ppw->pv->y,
-                               ppw->pv->used_in_sources,
-                               ppw->pv->pt_size,
-                               &ppaw,
-                               ppr->tol_perturb_integration,
-                               ppr->smallest_allowed_variation,
-                               perturb_timescale,
-                               ppr->perturb_integration_stepsize,
-                               tau_sampling_,
-                               tau_actual_size,
-                               perturb_sources,
-                               perhaps_print_variables,
-                               error_message_),
+    /** - --> (d) integrate the perturbations over the current interval,
+        in pieces over which the tolerance schedule is constant. Within
+        the interval, the vector does not change from one piece to the
+        next. */
+
+    class_call(perturb_tolerance_schedule(interval_limit[index_interval],
+                                          interval_limit[index_interval+1],
+                                          &piece_number,
+                                          piece_limit,
+                                          piece_tolerance),
                error_message_,
                error_message_);
 
+    if (piece_number > 1) {
+      identity_map.resize(ppw->pv->pt_size);
+      for (index_pt = 0; index_pt < ppw->pv->pt_size; index_pt++)
+        identity_map[index_pt] = index_pt;
+    }
+
+    for (index_piece = 0; index_piece < piece_number; index_piece++) {
+
+      if (ppr->evolver == rk) {
+        class_call(evolver_rk(perturb_derivs,
+                              piece_limit[index_piece],
+                              piece_limit[index_piece+1],
+                              ppw->pv->y,
+                              ppw->pv->used_in_sources,
+                              ppw->pv->pt_size,
+                              &ppaw,
+                              piece_tolerance[index_piece],
+                              ppr->smallest_allowed_variation,
+                              perturb_timescale,
+                              ppr->perturb_integration_stepsize,
+                              tau_sampling_,
+                              tau_actual_size,
+                              perturb_sources,
+                              perhaps_print_variables,
+                              error_message_),
+                   error_message_,
+                   error_message_);
+      }
+      else {
+        /* the evolver continues from the state reached at the end of the
+           previous interval, using the index map of the new vector */
+        class_call(evolver_ndf15_warm(perturb_derivs,
+                                      piece_limit[index_piece],
+                                      piece_limit[index_piece+1],
+                                      ppw->pv->y,
+                                      ppw->pv->used_in_sources,
+                                      ppw->pv->pt_size,
+                                      &ppaw,
+                                      piece_tolerance[index_piece],
+                                      ppr->smallest_allowed_variation,
+                                      perturb_timescale,
+                                      ppr->perturb_integration_stepsize,
+                                      tau_sampling_,
+                                      tau_actual_size,
+                                      perturb_sources,
+                                      perturb_sources_block,
+                                      perhaps_print_variables,
+                                      &(warm_start.state),
+                                      (index_piece == 0) ? ppw->pv->index_map : identity_map.data(),
+                                      error_message_),
+                   error_message_,
+                   error_message_);
+      }
+    }
+
   }
 
   /** - if perturbations were printed in a file, close the file */
@@ -2858,7 +3066,7 @@ int PerturbationsModule::perturb_prepare_k_output() {
       class_store_columntitle(scalar_titles_, "theta_cdm", pba->has_cdm);
       /* Non-cold dark matter */
       if ((pba->has_ncdm == _TRUE_) && ((ppt->has_density_transfers == _TRUE_) || (ppt->has_velocity_transfers == _TRUE_) || (has_source_delta_m_ == _TRUE_))) {
-        for(n_ncdm=0; n_ncdm < pba->N_ncdm; n_ncdm++){
+        for(n_ncdm=0; n_ncdm < pba->ncdm->N_ncdm_input_; n_ncdm++){
           sprintf(tmp, "delta_ncdm[%d]", n_ncdm);
           class_store_columntitle(scalar_titles_, tmp, _TRUE_);
           sprintf(tmp, "theta_ncdm[%d]", n_ncdm);
@@ -2905,7 +3113,7 @@ int PerturbationsModule::perturb_prepare_k_output() {
       class_store_columntitle(tensor_titles_, "l4_ur", evolve_tensor_ur_);
 
       if (evolve_tensor_ncdm_ == _TRUE_) {
-        for(n_ncdm=0; n_ncdm < pba->N_ncdm; n_ncdm++){
+        for(n_ncdm=0; n_ncdm < pba->ncdm->N_ncdm_input_; n_ncdm++){
           sprintf(tmp, "delta_ncdm[%d]", n_ncdm);
           class_store_columntitle(tensor_titles_, tmp, _TRUE_);
           sprintf(tmp, "theta_ncdm[%d]", n_ncdm);
@@ -3214,6 +3422,11 @@ int PerturbationsModule::perturb_find_approximation_switches(
               fprintf(stdout,"Mode k=%e: will switch on ncdm fluid approximation at tau=%e\n",k,interval_limit[index_switch]);
             }
           }
+          if (ppr->l_max_adaptive == _TRUE_) {
+            if (interval_approx[index_switch-1][ppw->index_ap_lmax] != interval_approx[index_switch][ppw->index_ap_lmax]) {
+              fprintf(stdout,"Mode k=%e: will extend Boltzmann hierarchies to l=%d at tau=%e\n",k,perturb_l_max_truncated(ppw, ppw->max_l_max),interval_limit[index_switch]);
+            }
+          }
         }
 
         if (_tensors_) {
@@ -3240,6 +3453,58 @@ int PerturbationsModule::perturb_find_approximation_switches(
   return _SUCCESS_;
 }
 
+/**
+ * Blocks of consecutive perturbations which have the same meaning in all
+ * approximation schemes: index of the first one, and number of elements
+ * given by offset plus (if not null) a maximum multipole.
+ */
+struct perturb_vector_block {
+  int perturb_vector::* index;
+  int perturb_vector::* l_max;
+  int offset;
+};
+
+static const perturb_vector_block perturb_vector_blocks_[] = {
+  {&perturb_vector::index_pt_delta_g, nullptr, 1},
+  {&perturb_vector::index_pt_theta_g, nullptr, 1},
+  {&perturb_vector::index_pt_shear_g, nullptr, 1},
+  {&perturb_vector::index_pt_l3_g, &perturb_vector::l_max_g, -2},
+  {&perturb_vector::index_pt_pol0_g, nullptr, 1},
+  {&perturb_vector::index_pt_pol1_g, nullptr, 1},
+  {&perturb_vector::index_pt_pol2_g, nullptr, 1},
+  {&perturb_vector::index_pt_pol3_g, &perturb_vector::l_max_pol_g, -2},
+  {&perturb_vector::index_pt_delta_b, nullptr, 1},
+  {&perturb_vector::index_pt_theta_b, nullptr, 1},
+  {&perturb_vector::index_pt_delta_cdm, nullptr, 1},
+  {&perturb_vector::index_pt_theta_cdm, nullptr, 1},
+  {&perturb_vector::index_pt_delta_idm_dr, nullptr, 1},
+  {&perturb_vector::index_pt_theta_idm_dr, nullptr, 1},
+  {&perturb_vector::index_pt_delta_dcdm, nullptr, 1},
+  {&perturb_vector::index_pt_theta_dcdm, nullptr, 1},
+  {&perturb_vector::index_pt_delta_fld, nullptr, 1},
+  {&perturb_vector::index_pt_theta_fld, nullptr, 1},
+  {&perturb_vector::index_pt_Gamma_fld, nullptr, 1},
+  {&perturb_vector::index_pt_phi_scf, nullptr, 1},
+  {&perturb_vector::index_pt_phi_prime_scf, nullptr, 1},
+  {&perturb_vector::index_pt_delta_ur, nullptr, 1},
+  {&perturb_vector::index_pt_theta_ur, nullptr, 1},
+  {&perturb_vector::index_pt_shear_ur, nullptr, 1},
+  {&perturb_vector::index_pt_l3_ur, &perturb_vector::l_max_ur, -2},
+  {&perturb_vector::index_pt_delta_idr, nullptr, 1},
+  {&perturb_vector::index_pt_theta_idr, nullptr, 1},
+  {&perturb_vector::index_pt_shear_idr, nullptr, 1},
+  {&perturb_vector::index_pt_l3_idr, &perturb_vector::l_max_idr, -2},
+  {&perturb_vector::index_pt_perturbed_recombination_delta_temp, nullptr, 1},
+  {&perturb_vector::index_pt_perturbed_recombination_delta_chi, nullptr, 1},
+  {&perturb_vector::index_pt_F0_dr, &perturb_vector::l_max_dr, 1},
+  {&perturb_vector::index_pt_eta, nullptr, 1},
+  {&perturb_vector::index_pt_phi, nullptr, 1},
+  {&perturb_vector::index_pt_hv_prime, nullptr, 1},
+  {&perturb_vector::index_pt_V, nullptr, 1},
+  {&perturb_vector::index_pt_gw, nullptr, 1},
+  {&perturb_vector::index_pt_gwdot, nullptr, 1}
+};
+
 /**
  * Initialize the field '-->pv' of a perturb_workspace structure, which
  * is a perturb_vector structure. This structure contains indices and
@@ -3310,6 +3575,12 @@ int PerturbationsModule::perturb_vector_init(
       needed), relevant for perturb_vector_free() */
   ppv->l_max_ncdm = NULL;
   ppv->q_size_ncdm = NULL;
+  ppv->index_map = NULL;
+
+  /** - mark all indices as undefined, so that perturb_vector_index_map() can tell which perturbations exist */
+  for (const perturb_vector_block& block : perturb_vector_blocks_)
+    ppv->*(block.index) = -1;
+  ppv->index_pt_psi0_ncdm1 = -1;
 
   /** - define all indices in this new vector (depends on approximation scheme, described by the input structure ppw-->pa) */
 
@@ -3327,6 +3598,11 @@ int PerturbationsModule::perturb_vector_init(
                error_message_,
                "ppr->l_max_pol_g should be at least 4");
 
+    /* reject inconsistent values of the smallest truncation of adaptive hierarchies */
+    class_test((ppr->l_max_adaptive == _TRUE_) && ((ppr->l_max_adaptive_min < 4) || (ppr->l_max_adaptive_step < 1)),
+               error_message_,
+               "ppr->l_max_adaptive_min should be at least 4 and ppr->l_max_adaptive_step at least 1");
+
     /* reject inconsistent values of the number of mutipoles in decay radiation hierarchy */
     if (pba->has_dr == _TRUE_) {
       class_test(ppr->l_max_dr < 4,
@@ -3353,7 +3629,7 @@ int PerturbationsModule::perturb_vector_init(
 
       /* temperature */
 
-      ppv->l_max_g = ppr->l_max_g;
+      ppv->l_max_g = perturb_l_max_truncated(ppw, ppr->l_max_g);
 
       class_define_index(ppv->index_pt_delta_g,_TRUE_,index_pt,1); /* photon density */
       class_define_index(ppv->index_pt_theta_g,_TRUE_,index_pt,1); /* photon velocity */
@@ -3365,7 +3641,7 @@ int PerturbationsModule::perturb_vector_init(
 
         /* polarization */
 
-        ppv->l_max_pol_g = ppr->l_max_pol_g;
+        ppv->l_max_pol_g = perturb_l_max_truncated(ppw, ppr->l_max_pol_g);
 
         class_define_index(ppv->index_pt_pol0_g,_TRUE_,index_pt,1);
         class_define_index(ppv->index_pt_pol1_g,_TRUE_,index_pt,1);
@@ -3429,7 +3705,7 @@ int PerturbationsModule::perturb_vector_init(
       class_define_index(ppv->index_pt_shear_ur,_TRUE_,index_pt,1); /* shear of ultra-relativistic neutrinos/relics */
 
       if (ppw->approx[ppw->index_ap_ufa] == (int)ufa_off) {
-        ppv->l_max_ur = ppr->l_max_ur;
+        ppv->l_max_ur = perturb_l_max_truncated(ppw, ppr->l_max_ur);
         class_define_index(ppv->index_pt_l3_ur,_TRUE_,index_pt,ppv->l_max_ur-2); /* additional momenta in Boltzmann hierarchy (beyond l=0,1,2,3) */
       }
     }
@@ -3467,7 +3743,7 @@ int PerturbationsModule::perturb_vector_init(
                      error_message_,
                      "ppr->l_max_ncdm=%d should be at least 4, i.e. we must integrate at least over first four momenta of non-cold dark matter perturbed phase-space distribution",n_ncdm);
           //Copy value from precision parameter:
-          ppv->l_max_ncdm[n_ncdm] = ppr->l_max_ncdm;
+          ppv->l_max_ncdm[n_ncdm] = perturb_l_max_truncated(ppw, ppr->l_max_ncdm);
           ppv->q_size_ncdm[n_ncdm] = pba->ncdm->q_size_ncdm_[n_ncdm];
         }
         else{
@@ -3791,6 +4067,13 @@ int PerturbationsModule::perturb_vector_init(
 
   else {
 
+    /** - --> relate the new vector to the previous one (this lets the
+        evolver continue with its step size, order and Jacobian) */
+
+    class_call(perturb_vector_index_map(ppw->pv, ppv),
+               error_message_,
+               error_message_);
+
     /** - --> (a) for the scalar mode: */
 
     if (_scalars_) {
@@ -3810,7 +4093,45 @@ int PerturbationsModule::perturb_vector_init(
                    "at tau=%g: the dark tight-coupling approximation can be switched off, not on",tau);
       }
 
-      /** - ---> (a.2.) some variables (b, cdm, fld, ...) are not affected by
+      /** - ---> (a.2.) case of extending the Boltzmann hierarchies
+          (adaptive l_max): all perturbations keep their meaning, the
+          new multipoles are started from the small-argument limit
+          F_l = F_{l-1} k tau/(2l+1) of the free-streaming solution */
+
+      if ((ppr->l_max_adaptive == _TRUE_) && (pa_old[ppw->index_ap_lmax] != ppw->approx[ppw->index_ap_lmax])) {
+
+        if (ppt->perturbations_verbose>2)
+          fprintf(stdout,"Mode k=%e: extend Boltzmann hierarchies to l=%d at tau=%e\n",k,perturb_l_max_truncated(ppw, ppw->max_l_max),tau);
+
+        for (index_pt=0; index_pt<ppv->pt_size; index_pt++) {
+          if (ppv->index_map[index_pt] >= 0)
+            ppv->y[index_pt] = ppw->pv->y[ppv->index_map[index_pt]];
+        }
+
+        /* new multipoles: F_l = F_{l-1} k tau/(2l+1), the small-argument limit of the free-streaming solution */
+        if (ppw->approx[ppw->index_ap_tca] == (int)tca_off && ppw->approx[ppw->index_ap_rsa] == (int)rsa_off) {
+          for (l=ppw->pv->l_max_g+1; l<=ppv->l_max_g; l++)
+            ppv->y[ppv->index_pt_delta_g+l] = ppv->y[ppv->index_pt_delta_g+l-1]*k*tau/(2.*l+1.);
+          for (l=ppw->pv->l_max_pol_g+1; l<=ppv->l_max_pol_g; l++)
+            ppv->y[ppv->index_pt_pol0_g+l] = ppv->y[ppv->index_pt_pol0_g+l-1]*k*tau/(2.*l+1.);
+        }
+        if ((pba->has_ur == _TRUE_) && (ppw->approx[ppw->index_ap_rsa] == (int)rsa_off) && (ppw->approx[ppw->index_ap_ufa] == (int)ufa_off)) {
+          for (l=ppw->pv->l_max_ur+1; l<=ppv->l_max_ur; l++)
+            ppv->y[ppv->index_pt_delta_ur+l] = ppv->y[ppv->index_pt_delta_ur+l-1]*k*tau/(2.*l+1.);
+        }
+        if ((pba->has_ncdm == _TRUE_) && (ppw->approx[ppw->index_ap_ncdmfa] == (int)ncdmfa_off)) {
+          index_pt = ppv->index_pt_psi0_ncdm1;
+          for (n_ncdm = 0; n_ncdm < ppv->N_ncdm; n_ncdm++) {
+            for (index_q = 0; index_q < ppv->q_size_ncdm[n_ncdm]; index_q++) {
+              for (l=ppw->pv->l_max_ncdm[n_ncdm]+1; l<=ppv->l_max_ncdm[n_ncdm]; l++)
+                ppv->y[index_pt+l] = ppv->y[index_pt+l-1]*k*tau/(2.*l+1.);
+              index_pt += ppv->l_max_ncdm[n_ncdm]+1;
+            }
+          }
+        }
+      }
+
+      /** - ---> (a.3.) some variables (b, cdm, fld, ...) are not affected by
           any approximation. They need to be reconducted whatever
           the approximation switching is. We treat them here. Below
           we will treat other variables case by case. */
@@ -4698,11 +5019,169 @@ int PerturbationsModule::perturb_vector_free(perturb_vector* pv) {
   free(pv->y);
   free(pv->dy);
   free(pv->used_in_sources);
+  if (pv->index_map != NULL) free(pv->index_map);
   free(pv);
 
   return _SUCCESS_;
 }
 
+/**
+ * Find, for each perturbation in a new vector, its index in the vector of
+ * the previous approximation interval (or -1 if it was not integrated
+ * there). Only blocks of perturbations which keep their meaning across
+ * approximation schemes are related; the ncdm hierarchy is related only
+ * if its shape did not change.
+ *
+ * @param pv_old    Input: vector of the previous approximation interval
+ * @param pv_new    Input/Output: new vector, in which index_map is allocated and filled
+ * @return the error status
+ */
+
+int PerturbationsModule::perturb_vector_index_map(const perturb_vector* pv_old, perturb_vector* pv_new) {
+
+  int index_pt;
+  int index_old;
+  int index_new;
+  int size;
+  int n_ncdm;
+  int index_q;
+  int l;
+
+  class_alloc(pv_new->index_map, pv_new->pt_size*sizeof(int), error_message_);
+  for (index_pt = 0; index_pt < pv_new->pt_size; index_pt++)
+    pv_new->index_map[index_pt] = -1;
+
+  for (const perturb_vector_block& block : perturb_vector_blocks_) {
+    if ((pv_old->*(block.index) < 0) || (pv_new->*(block.index) < 0))
+      continue;
+    size = block.offset;
+    if (block.l_max != nullptr)
+      size += MIN(pv_old->*(block.l_max), pv_new->*(block.l_max));
+    for (index_pt = 0; index_pt < size; index_pt++)
+      pv_new->index_map[pv_new->*(block.index) + index_pt] = pv_old->*(block.index) + index_pt;
+  }
+
+  if ((pv_old->index_pt_psi0_ncdm1 >= 0) && (pv_new->index_pt_psi0_ncdm1 >= 0)) {
+    index_old = pv_old->index_pt_psi0_ncdm1;
+    index_new = pv_new->index_pt_psi0_ncdm1;
+    for (n_ncdm = 0; n_ncdm < pv_new->N_ncdm; n_ncdm++) {
+      /* the fluid approximation (l_max_ncdm = 2) and the full hierarchy (l_max_ncdm >= 4) are not related */
+      if ((pv_old->q_size_ncdm[n_ncdm] != pv_new->q_size_ncdm[n_ncdm]) ||
+          ((pv_old->l_max_ncdm[n_ncdm] != pv_new->l_max_ncdm[n_ncdm]) && (MIN(pv_old->l_max_ncdm[n_ncdm], pv_new->l_max_ncdm[n_ncdm]) < 4)))
+        break;
+      size = MIN(pv_old->l_max_ncdm[n_ncdm], pv_new->l_max_ncdm[n_ncdm]) + 1;
+      for (index_q = 0; index_q < pv_new->q_size_ncdm[n_ncdm]; index_q++) {
+        for (l = 0; l < size; l++)
+          pv_new->index_map[index_new + l] = index_old + l;
+        index_old += pv_old->l_max_ncdm[n_ncdm] + 1;
+        index_new += pv_new->l_max_ncdm[n_ncdm] + 1;
+      }
+    }
+  }
+
+  return _SUCCESS_;
+}
+
+/**
+ * Split an interval of integration into pieces over which the
+ * tolerance of the integrator is constant, following the schedule
+ * defined by tol_perturb_integration_early_factor,
+ * tol_perturb_integration_late_factor and the corresponding times
+ * relative to recombination.
+ *
+ * @param tau_ini          Input: beginning of the interval
+ * @param tau_end          Input: end of the interval
+ * @param piece_number     Output: number of pieces (between 1 and 3)
+ * @param piece_limit      Output: limits of the pieces (array of size 4, already allocated)
+ * @param piece_tolerance  Output: tolerance in each piece (array of size 3, already allocated)
+ * @return the error status
+ */
+
+int PerturbationsModule::perturb_tolerance_schedule(double tau_ini, double tau_end, int* piece_number, double* piece_limit, double* piece_tolerance) const {
+
+  double tau_early = ppr->tol_perturb_integration_early_tau_over_tau_rec*thermodynamics_module_->tau_rec_;
+  double tau_late = ppr->tol_perturb_integration_late_tau_over_tau_rec*thermodynamics_module_->tau_rec_;
+
+  class_test((ppr->tol_perturb_integration_early_factor <= 0.) || (ppr->tol_perturb_integration_late_factor <= 0.) || (tau_early > tau_late),
+             error_message_,
+             "inconsistent tolerance schedule: factors should be positive and the early time should precede the late one");
+
+  *piece_number = 0;
+  piece_limit[0] = tau_ini;
+
+  if ((ppr->tol_perturb_integration_early_factor != 1.) && (tau_ini < tau_early)) {
+    piece_limit[*piece_number + 1] = MIN(tau_end, tau_early);
+    piece_tolerance[*piece_number] = ppr->tol_perturb_integration*ppr->tol_perturb_integration_early_factor;
+    (*piece_number)++;
+  }
+
+  if (piece_limit[*piece_number] < tau_end) {
+    if ((ppr->tol_perturb_integration_late_factor != 1.) && (tau_end > tau_late)) {
+      if (piece_limit[*piece_number] < tau_late) {
+        piece_limit[*piece_number + 1] = tau_late;
+        piece_tolerance[*piece_number] = ppr->tol_perturb_integration;
+        (*piece_number)++;
+      }
+      piece_tolerance[*piece_number] = ppr->tol_perturb_integration*ppr->tol_perturb_integration_late_factor;
+    }
+    else {
+      piece_tolerance[*piece_number] = ppr->tol_perturb_integration;
+    }
+    piece_limit[*piece_number + 1] = tau_end;
+    (*piece_number)++;
+  }
+
+  return _SUCCESS_;
+}
+
+/**
+ * Truncation level of the scalar Boltzmann hierarchies at a given time,
+ * when l_max_adaptive is set. Level n corresponds to a truncation at
+ * \f$ l = \f$ l_max_adaptive_min + n l_max_adaptive_step, and is used as
+ * long as \f$ k \tau \f$ < l_max_adaptive_ktau_over_l \f$ \times l \f$.
+ * The last level does not truncate any hierarchy.
+ *
+ * @param k         Input: wavenumber
+ * @param tau       Input: conformal time
+ * @return the truncation level
+ */
+
+int PerturbationsModule::perturb_l_max_level(double k, double tau) const {
+
+  int l_max;
+  int level_max;
+  double l_needed;
+
+  l_max = MAX(ppr->l_max_g, ppr->l_max_pol_g);
+  if (pba->has_ur == _TRUE_) l_max = MAX(l_max, ppr->l_max_ur);
+  if (pba->has_ncdm == _TRUE_) l_max = MAX(l_max, ppr->l_max_ncdm);
+
+  level_max = MAX(0, (l_max - ppr->l_max_adaptive_min + ppr->l_max_adaptive_step - 1)/ppr->l_max_adaptive_step);
+
+  l_needed = k*tau/ppr->l_max_adaptive_ktau_over_l;
+  if (l_needed < ppr->l_max_adaptive_min)
+    return 0;
+
+  return MIN(level_max, (int)((l_needed - ppr->l_max_adaptive_min)/ppr->l_max_adaptive_step) + 1);
+}
+
+/**
+ * Multipole at which a scalar Boltzmann hierarchy is truncated in the
+ * current approximation scheme.
+ *
+ * @param ppw       Input: workspace with the current approximation scheme
+ * @param l_max     Input: truncation of the full hierarchy
+ * @return the truncation for the current level (l_max itself if l_max_adaptive is not set)
+ */
+
+int PerturbationsModule::perturb_l_max_truncated(perturb_workspace* ppw, int l_max) const {
+
+  if (ppr->l_max_adaptive == _FALSE_)
+    return l_max;
+
+  return MIN(l_max, ppr->l_max_adaptive_min + ppw->approx[ppw->index_ap_lmax]*ppr->l_max_adaptive_step);
+}
+
 /**
  * For each mode, wavenumber and initial condition, this function
  * initializes in the vector all values of perturbed variables (in a
@@ -5600,6 +6079,12 @@ int PerturbationsModule::perturb_approximations(int index_md, double k, double t
         ppw->approx[ppw->index_ap_ncdmfa] = (int)ncdmfa_off;
       }
     }
+
+    /** - --> (d) truncation level of the Boltzmann hierarchies */
+
+    if (ppr->l_max_adaptive == _TRUE_) {
+      ppw->approx[ppw->index_ap_lmax] = perturb_l_max_level(k, tau);
+    }
   }
 
   /** - for tensor modes: */
@@ -6674,7 +7159,7 @@ int PerturbationsModule::perturb_total_stress_energy(int index_md, double k, dou
  * @param tau                      Input: conformal time
  * @param y                        Input: vector of perturbations
  * @param dy                       Input: vector of time derivative of perturbations
- * @param index_tau                Input: index in the array tau_sampling
+ * @param index_tau                Input: index of tau in the array tau_sampling
  * @param parameters_and_workspace Input/Output: in input, all parameters needed by perturb_derivs, in output, source terms
  * @param error_message            Output: error message
  * @return the error status
@@ -6723,21 +7208,18 @@ int PerturbationsModule::perturb_sources_member(double tau, double* y, double* d
   pvecthermo = ppw->pvecthermo;
   pvecmetric = ppw->pvecmetric;
 
-  /** - get background/thermo quantities in this point */
+  /** - get background/thermo quantities in this point, tabulated
+      once for all wavenumbers in perturb_timesampling_for_sources() */
 
-  class_call(background_module_->background_at_tau(tau, pba->normal_info, pba->inter_closeby, &(ppw->last_index_back), pvecback),
-             background_module_->error_message_,
-             error_message);
+  memcpy(pvecback,
+         background_at_tau_sampling_ + index_tau*background_module_->bg_size_normal_,
+         background_module_->bg_size_normal_*sizeof(double));
 
-  z = pba->a_today/pvecback[background_module_->index_bg_a_] - 1.;
+  memcpy(pvecthermo,
+         thermodynamics_at_tau_sampling_ + index_tau*thermodynamics_module_->th_size_,
+         thermodynamics_module_->th_size_*sizeof(double));
 
-  class_call(thermodynamics_module_->thermodynamics_at_z(z,
-                                                        thermodynamics_module_->inter_closeby_,
-                                                        &(ppw->last_index_thermo),
-                                                        pvecback,
-                                                        pvecthermo),
-             thermodynamics_module_->error_message_,
-             error_message);
+  z = pba->a_today/pvecback[background_module_->index_bg_a_] - 1.;
 
   a_rel = ppw->pvecback[background_module_->index_bg_a_]/pba->a_today;
   a2_rel = a_rel * a_rel;
@@ -7228,6 +7710,39 @@ int PerturbationsModule::perturb_sources_member(double tau, double* y, double* d
 
 }
 
+/**
+ * Compute the source functions at a block of consecutive sampling
+ * times, all inside one step of the evolver (see output_block in
+ * evolver_ndf15.c). The background and thermodynamics quantities of
+ * the whole block are read from the tables filled in
+ * perturb_timesampling_for_sources().
+ *
+ * @param tau                      Input: array of conformal times, tau_sampling_[index_tau] to tau_sampling_[index_tau+tau_block_size-1]
+ * @param y                        Input: vectors of perturbations, the one at tau[i] starting at y[i*y_stride]
+ * @param dy                       Input: vectors of their time derivatives, with the same layout
+ * @param index_tau                Input: index of tau[0] in the array tau_sampling
+ * @param tau_block_size           Input: number of times in the block
+ * @param y_stride                 Input: distance between two consecutive vectors in y and dy
+ * @param parameters_and_workspace Input/Output: in input, all parameters needed by perturb_derivs, in output, source terms
+ * @param error_message            Output: error message
+ * @return the error status
+ */
+
+int PerturbationsModule::perturb_sources_block_member(double* tau, double* y, double* dy, int index_tau, int tau_block_size, int y_stride, void* parameters_and_workspace, ErrorMsg error_message) {
+
+  for (int i = 0; i < tau_block_size; i++) {
+    class_call(perturb_sources_member(tau[i],
+                                      y + i*y_stride,
+                                      dy + i*y_stride,
+                                      index_tau + i,
+                                      parameters_and_workspace,
+                                      error_message),
+               error_message,
+               error_message);
+  }
+
+  return _SUCCESS_;
+}
 
 /**
  * When testing the code or a cosmological model, it can be useful to
@@ -7648,11 +8163,11 @@ int PerturbationsModule::perturb_print_variables_member(double tau, double* y, d
     class_store_double(dataptr, theta_cdm, pba->has_cdm, storeidx);
     /* Non-cold Dark Matter */
     if ((pba->has_ncdm == _TRUE_) && ((ppt->has_density_transfers == _TRUE_) || (ppt->has_velocity_transfers == _TRUE_) || (has_source_delta_m_ == _TRUE_))) {
-      for(n_ncdm=0; n_ncdm < pba->N_ncdm; n_ncdm++){
-        class_store_double(dataptr, delta_ncdm[n_ncdm], _TRUE_, storeidx);
-        class_store_double(dataptr, theta_ncdm[n_ncdm], _TRUE_, storeidx);
-        class_store_double(dataptr, shear_ncdm[n_ncdm], _TRUE_, storeidx);
-        class_store_double(dataptr, delta_p_over_delta_rho_ncdm[n_ncdm],  _TRUE_, storeidx);
+      for(n_ncdm=0; n_ncdm < pba->ncdm->N_ncdm_input_; n_ncdm++){
+        class_store_double(dataptr, delta_ncdm[pba->ncdm->ncdm_of_input_[n_ncdm]], _TRUE_, storeidx);
+        class_store_double(dataptr, theta_ncdm[pba->ncdm->ncdm_of_input_[n_ncdm]], _TRUE_, storeidx);
+        class_store_double(dataptr, shear_ncdm[pba->ncdm->ncdm_of_input_[n_ncdm]], _TRUE_, storeidx);
+        class_store_double(dataptr, delta_p_over_delta_rho_ncdm[pba->ncdm->ncdm_of_input_[n_ncdm]],  _TRUE_, storeidx);
       }
     }
     /* Decaying cold dark matter */
@@ -7780,10 +8295,12 @@ int PerturbationsModule::perturb_print_variables_member(double tau, double* y, d
           (ppw->pvecback[background_module_->index_bg_rho_ncdm1_ + n_ncdm] + ppw->pvecback[background_module_->index_bg_p_ncdm1_ + n_ncdm]);
         shear_ncdm[n_ncdm] = rho_plus_p_shear_ncdm/
           (ppw->pvecback[background_module_->index_bg_rho_ncdm1_ + n_ncdm] + ppw->pvecback[background_module_->index_bg_p_ncdm1_ + n_ncdm]);
+      }
 
-        class_store_double(dataptr, delta_ncdm[n_ncdm], _TRUE_, storeidx);
-        class_store_double(dataptr, theta_ncdm[n_ncdm], _TRUE_, storeidx);
-        class_store_double(dataptr, shear_ncdm[n_ncdm], _TRUE_, storeidx);
+      for (n_ncdm=0; n_ncdm < pba->ncdm->N_ncdm_input_; n_ncdm++) {
+        class_store_double(dataptr, delta_ncdm[pba->ncdm->ncdm_of_input_[n_ncdm]], _TRUE_, storeidx);
+        class_store_double(dataptr, theta_ncdm[pba->ncdm->ncdm_of_input_[n_ncdm]], _TRUE_, storeidx);
+        class_store_double(dataptr, shear_ncdm[pba->ncdm->ncdm_of_input_[n_ncdm]], _TRUE_, storeidx);
       }
     }
 
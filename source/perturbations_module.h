@@ -9,6 +9,7 @@ public:
   PerturbationsModule(InputModulePtr input_module, BackgroundModulePtr background_module, ThermodynamicsModulePtr thermodynamics_module);
   ~PerturbationsModule();
   int perturb_output_data(enum file_format output_format, double z, int number_of_titles, double* data) const;
+  int perturb_output_data_at_z_list(enum file_format output_format, int z_size, const double* z, int number_of_titles, double* data) const;
   int perturb_output_titles(enum file_format output_format, char titles[_MAXTITLESTRINGLENGTH_]) const;
   int perturb_output_firstline_and_ic_suffix(int index_ic, char first_line[_LINE_LENGTH_MAX_], FileName ic_suffix) const;
 
@@ -159,13 +160,17 @@ public:
   //@{
 
   double* ln_tau_;      /**< log of the arrau tau_sampling, covering only the final time range required for the output of
-                            Fourier transfer functions (used for interpolations) */
+                            Fourier transfer functions (used for interpolations); nodes of the grid "ln_tau" of the grid service */
   int ln_tau_size_;     /**< number of values in this array */
 
   //@}
 
-  double* tau_sampling_;    /**< array of tau values */
+  double* tau_sampling_;    /**< array of tau values (nodes of the grid "tau_sampling" of the grid service) */
   int tau_size_;            /**< number of values in this array */
+  double* background_at_tau_sampling_;     /**< background quantities (normal format) at each tau value, table "background_normal" on "tau_sampling",
+                                              background_at_tau_sampling_[index_tau*bg_size_normal_ + index_bg] */
+  double* thermodynamics_at_tau_sampling_; /**< thermodynamics quantities at each tau value, table "thermodynamics" on "tau_sampling",
+                                              thermodynamics_at_tau_sampling_[index_tau*th_size_ + index_th] */
 
   int* k_size_cl_;  /**< k_size_cl[index_md] number of k values used
                        for non-CMB \f$ C_l \f$ calculations, requiring a coarse
@@ -173,13 +178,15 @@ public:
   int* k_size_;     /**< k_size[index_md] = total number of k
                        values, including those needed for P(k) but not
                        for \f$ C_l \f$'s */
-  double** k_;      /**< k[index_md][index_k] = list of values */
+  double** k_;      /**< k[index_md][index_k] = list of values (nodes of the grid "k_<index_md>" of the grid service) */
   double k_min_;    /**< minimum value (over all modes) */
   double k_max_;    /**< maximum value (over all modes) */
 
 
 private:
   int perturb_sources_at_tau(int index_md, int index_ic, int index_tp, double tau, double* pvecsources) const;
+  int perturb_sources_at_tau(int index_md, int index_ic, int index_tp, double tau, double* pvecsources, ErrorMsg error_message) const;
+  int perturb_output_data(enum file_format output_format, double z, int number_of_titles, double* data, ErrorMsg error_message) const;
   int perturb_init();
   int perturb_free();
   int perturb_indices_of_perturbs();
@@ -193,6 +200,10 @@ private:
   int perturb_find_approximation_switches(int index_md, double k, perturb_workspace* ppw, double tau_ini, double tau_end, double precision, int interval_number, int* interval_number_of, double* interval_limit, int** interval_approx);
   int perturb_vector_init(int index_md, int index_ic, double k, double tau, perturb_workspace* ppw, int* pa_old);
   int perturb_vector_free(struct perturb_vector * pv);
+  int perturb_vector_index_map(const struct perturb_vector * pv_old, struct perturb_vector * pv_new);
+  int perturb_l_max_level(double k, double tau) const;
+  int perturb_tolerance_schedule(double tau_ini, double tau_end, int* piece_number, double* piece_limit, double* piece_tolerance) const;
+  int perturb_l_max_truncated(perturb_workspace* ppw, int l_max) const;
   int perturb_initial_conditions(int index_md, int index_ic, double k, double tau, perturb_workspace* ppw);
   int perturb_approximations(int index_md, double k, double tau, perturb_workspace* ppw);
   int perturb_einstein(int index_md, double k, double tau, double* y, perturb_workspace* ppw);
@@ -201,6 +212,8 @@ private:
   static int perturb_timescale(double tau, void * parameters_and_workspace, double* timescale, ErrorMsg error_message);
   int perturb_sources_member(double tau, double* pvecperturbations, double* pvecderivs, int index_tau, void * parameters_and_workspace, ErrorMsg error_message);
   static int perturb_sources(double tau, double* pvecperturbations, double* pvecderivs, int index_tau, void * parameters_and_workspace, ErrorMsg error_message);
+  int perturb_sources_block_member(double* tau, double* pvecperturbations, double* pvecderivs, int index_tau, int tau_block_size, int y_stride, void * parameters_and_workspace, ErrorMsg error_message);
+  static int perturb_sources_block(double* tau, double* pvecperturbations, double* pvecderivs, int index_tau, int tau_block_size, int y_stride, void * parameters_and_workspace, ErrorMsg error_message);
   int perturb_print_variables_member(double tau, double* y, double* dy, void * parameters_and_workspace, ErrorMsg error_message);
   static int perturb_print_variables(double tau, double* y, double* dy, void * parameters_and_workspace, ErrorMsg error_message);
   int perturb_derivs_member(double tau, double* y, double* dy, void * parameters_and_workspace, ErrorMsg error_message);
@@ -4,6 +4,7 @@
 #define __PRIMORDIAL__
 
 #include "perturbations.h"
+#include "vector_math.h"
 
 /** enum defining how the primordial spectrum should be computed */
 
@@ -59,6 +59,7 @@ PrimordialModule::~PrimordialModule() {
  * @param mode       Input: linear or logarithmic
  * @param input      Input: wavenumber in 1/Mpc (linear mode) or its logarithm (logarithmic mode)
  * @param output     Output: for each pair of initial conditions, primordial spectra P(k) in \f$Mpc^3\f$ (linear mode), or their logarithms and cross-correlation angles (logarithmic mode)
+ * @param error_message Output: error message, owned by the caller (see "Concurrent queries" in base_module.h)
  * @return the error status
  */
 
@@ -66,7 +67,8 @@ int PrimordialModule::primordial_spectrum_at_k(
                                                int index_md,
                                                enum linear_or_logarithmic mode,
                                                double input,
-                                               double * output /* array with argument output[index_ic1_ic2] (must be already allocated) */
+                                               double * output, /* array with argument output[index_ic1_ic2] (must be already allocated) */
+                                               ErrorMsg error_message
                                                ) const {
 
   /** Summary: */
@@ -81,7 +83,7 @@ int PrimordialModule::primordial_spectrum_at_k(
 
   if (mode == linear) {
     class_test(input<=0.,
-               error_message_,
+               error_message,
                "k = %e",input);
     lnk=log(input);
   }
@@ -95,7 +97,7 @@ int PrimordialModule::primordial_spectrum_at_k(
   if ((lnk > lnk_[lnk_size_ - 1]) || (lnk < lnk_[0])) {
 
     class_test(ppm->primordial_spec_type != analytic_Pk,
-               error_message_,
+               error_message,
                "k=%e out of range [%e : %e]", exp(lnk), exp(lnk_[0]), exp(lnk_[lnk_size_ - 1]));
 
     /* direct computation */
@@ -111,8 +113,8 @@ int PrimordialModule::primordial_spectrum_at_k(
                                                   index_ic1_ic2,
                                                   exp(lnk),
                                                   &(output[index_ic1_ic2])),
-                     error_message_,
-                     error_message_);
+                     error_message,
+                     error_message);
         }
         else {
           output[index_ic1_ic2] = 0.;
@@ -154,9 +156,9 @@ int PrimordialModule::primordial_spectrum_at_k(
                                         &last_index,
                                         output,
                                         ic_ic_size_[index_md],
-                                        error_message_),
-               error_message_,
-               error_message_);
+                                        error_message),
+               error_message,
+               error_message);
 
     /* if mode==logarithmic, output is already in the correct format. Otherwise, apply necessary transformation. */
 
@@ -185,6 +187,47 @@ int PrimordialModule::primordial_spectrum_at_k(
 
 }
 
+int PrimordialModule::primordial_spectrum_at_k(int index_md, enum linear_or_logarithmic mode, double input, double * output) const {
+  return primordial_spectrum_at_k(index_md, mode, input, output, error_message_);
+}
+
+/**
+ * Tabulate the primordial spectra on the nodes of a grid of the grid
+ * service. This is the same as calling primordial_spectrum_at_k() on each
+ * node; it is used where the spectrum is needed many times at the same
+ * wavenumbers, i.e. the transfer k nodes in spectra_compute_cl() and
+ * ln_k_ in the non-linear module. The table is computed once per grid,
+ * mode and format, kept by the grid service, and shared by all callers.
+ *
+ * @param index_md Input: index of mode under consideration (scalar, tensor, ...)
+ * @param mode     Input: linear or logarithmic
+ * @param grid     Input: grid of wavenumbers in 1/Mpc (linear mode) or of their logarithms (logarithmic mode)
+ * @param table    Output: table[index_k*ic_ic_size_[index_md] + index_ic1_ic2], in the format of primordial_spectrum_at_k() (owned by the grid service)
+ * @return the error status
+ */
+
+int PrimordialModule::primordial_spectrum_on_grid(int index_md, enum linear_or_logarithmic mode, const Tools::Grid* grid, double** table) const {
+
+  std::string quantity = "primordial_spectrum_" + std::to_string(index_md) + ((mode == linear) ? "_linear" : "_logarithmic");
+
+  class_call(grid_service_->Tabulate(grid,
+                                     quantity,
+                                     ic_ic_size_[index_md],
+                                     [&] (double* output) {
+                                       for (int index_k = 0; index_k < grid->Size(); index_k++) {
+                                         class_call(primordial_spectrum_at_k(index_md, mode, grid->Nodes()[index_k], output + index_k*ic_ic_size_[index_md]),
+                                                    error_message_,
+                                                    error_message_);
+                                       }
+                                       return _SUCCESS_;
+                                     },
+                                     table),
+             error_message_,
+             error_message_);
+
+  return _SUCCESS_;
+}
+
 /**
  * This routine initializes the primordial structure (in particular, it computes table of primordial spectrum values)
  *
@@ -200,9 +243,10 @@ int PrimordialModule::primordial_init() {
 
   /** - define local variables */
 
-  double k,k_min,k_max;
+  double k_min,k_max;
   int index_md,index_ic1,index_ic2,index_ic1_ic2,index_k;
   double pk,pk1,pk2;
+  double *pk_vec,*pk1_vec,*pk2_vec;
   double dlnk,lnpk_pivot,lnpk_minus,lnpk_plus,lnpk_minusminus,lnpk_plusplus;
   /* uncomment if you use optional test below
      (for correlated isocurvature modes) */
@@ -281,48 +325,68 @@ int PrimordialModule::primordial_init() {
                       error_message_,
                       primordial_free());
 
-    for (index_k = 0; index_k < lnk_size_; index_k++) {
+    class_alloc(pk_vec, lnk_size_*sizeof(double), error_message_);
+    class_alloc(pk1_vec, lnk_size_*sizeof(double), error_message_);
+    class_alloc(pk2_vec, lnk_size_*sizeof(double), error_message_);
 
-      k=exp(lnk_[index_k]);
+    /* whole ln(k) table at once for each pair of initial conditions */
+    for (index_md = 0; index_md < perturbations_module_->md_size_; index_md++) {
+      for (index_ic1 = 0; index_ic1 < ic_size_[index_md]; index_ic1++) {
+        for (index_ic2 = index_ic1; index_ic2 < ic_size_[index_md]; index_ic2++) {
 
-      for (index_md = 0; index_md < perturbations_module_->md_size_; index_md++) {
-        for (index_ic1 = 0; index_ic1 < ic_size_[index_md]; index_ic1++) {
-          for (index_ic2 = index_ic1; index_ic2 < ic_size_[index_md]; index_ic2++) {
+          index_ic1_ic2 = index_symmetric_matrix(index_ic1, index_ic2, ic_size_[index_md]);
 
-            index_ic1_ic2 = index_symmetric_matrix(index_ic1, index_ic2, ic_size_[index_md]);
+          if (is_non_zero_[index_md][index_ic1_ic2] == _TRUE_) {
+
+            if (index_ic1 == index_ic2) {
 
-            if (is_non_zero_[index_md][index_ic1_ic2] == _TRUE_) {
+              /* diagonal coefficients: ln[P(k)] */
 
-              class_call(primordial_analytic_spectrum(index_md,
+              class_call(primordial_analytic_lnpk_vec(index_md,
                                                       index_ic1_ic2,
-                                                      k,
-                                                      &pk),
+                                                      lnk_size_,
+                                                      lnk_,
+                                                      pk_vec),
                          error_message_,
                          error_message_);
 
-              if (index_ic1 == index_ic2) {
+              for (index_k = 0; index_k < lnk_size_; index_k++) {
+                lnpk_[index_md][index_k*ic_ic_size_[index_md] + index_ic1_ic2] = pk_vec[index_k];
+              }
+            }
+            else {
 
-                /* diagonal coefficients: ln[P(k)] */
+              class_call(primordial_analytic_spectrum_vec(index_md,
+                                                          index_ic1_ic2,
+                                                          lnk_size_,
+                                                          lnk_,
+                                                          pk_vec),
+                         error_message_,
+                         error_message_);
 
-                lnpk_[index_md][index_k*ic_ic_size_[index_md] + index_ic1_ic2] = log(pk);
-              }
-              else {
+              /* non-diagonal coefficients: cosDelta(k) = P(k)_12/sqrt[P(k)_1 P(k)_2] */
 
-                /* non-diagonal coefficients: cosDelta(k) = P(k)_12/sqrt[P(k)_1 P(k)_2] */
+              class_call(primordial_analytic_spectrum_vec(index_md,
+                                                          index_symmetric_matrix(index_ic1, index_ic1, ic_size_[index_md]),
+                                                          lnk_size_,
+                                                          lnk_,
+                                                          pk1_vec),
+                         error_message_,
+                         error_message_);
 
-                class_call(primordial_analytic_spectrum(index_md,
-                                                        index_symmetric_matrix(index_ic1, index_ic1, ic_size_[index_md]),
-                                                        k,
-                                                        &pk1),
-                           error_message_,
-                           error_message_);
+              class_call(primordial_analytic_spectrum_vec(index_md,
+                                                          index_symmetric_matrix(index_ic2, index_ic2, ic_size_[index_md]),
+                                                          lnk_size_,
+                                                          lnk_,
+                                                          pk2_vec),
+                         error_message_,
+                         error_message_);
 
-                class_call(primordial_analytic_spectrum(index_md,
-                                                        index_symmetric_matrix(index_ic2, index_ic2, ic_size_[index_md]),
-                                                        k,
-                                                        &pk2),
-                           error_message_,
-                           error_message_);
+              for (index_k = 0; index_k < lnk_size_; index_k++) {
+
+                pk = pk_vec[index_k];
+                pk1 = pk1_vec[index_k];
+                pk2 = pk2_vec[index_k];
 
                 /* either return an error if correlation is too large... */
                 /*
@@ -343,20 +407,24 @@ int PrimordialModule::primordial_init() {
                   lnpk_[index_md][index_k*ic_ic_size_[index_md] + index_ic1_ic2] = -1.;
                 else
                   lnpk_[index_md][index_k*ic_ic_size_[index_md] + index_ic1_ic2] = pk/sqrt(pk1*pk2);
-
-
               }
             }
-            else {
+          }
+          else {
 
-              /* non-diagonal coefficients when ic's are uncorrelated */
+            /* non-diagonal coefficients when ic's are uncorrelated */
 
+            for (index_k = 0; index_k < lnk_size_; index_k++) {
               lnpk_[index_md][index_k*ic_ic_size_[index_md] + index_ic1_ic2] = 0.;
             }
           }
         }
       }
     }
+
+    free(pk_vec);
+    free(pk1_vec);
+    free(pk2_vec);
   }
 
   /** - deal with case of inflation with given \f$V(\phi)\f$ or \f$H(\phi)\f$ */
@@ -564,9 +632,7 @@ int PrimordialModule::primordial_free() {
       free(tilt_);
       free(running_);
     }
-    else if (ppm->primordial_spec_type == external_Pk) {
-      free(ppm->command);
-    }
+    /* ppm->command belongs to the input module */
 
     for (index_md = 0; index_md < md_size_; index_md++) {
       free(lnpk_[index_md]);
@@ -930,6 +996,81 @@ int PrimordialModule::primordial_analytic_spectrum(int index_md, int index_ic1_i
 
 }
 
+/**
+ * Vectorised version of primordial_analytic_spectrum(), for a whole
+ * array of ln(k) values.
+ *
+ * @param index_md       Input: index of mode (scalar, tensor, ...)
+ * @param index_ic1_ic2  Input: pair of initial conditions (ic1, ic2)
+ * @param size           Input: number of wavenumbers
+ * @param lnk            Input: array of ln(k), with k in same units as pivot scale, i.e. in 1/Mpc
+ * @param pk             Output: array of primordial power spectra A (k/k_pivot)^(n+...)
+ * @return the error status
+ */
+
+int PrimordialModule::primordial_analytic_spectrum_vec(int index_md, int index_ic1_ic2, int size, const double * lnk, double * pk) const {
+
+  double lnk_pivot, dlnk;
+  int index_k;
+
+  if (is_non_zero_[index_md][index_ic1_ic2] == _TRUE_) {
+    lnk_pivot = log(ppm->k_pivot);
+    for (index_k = 0; index_k < size; index_k++) {
+      dlnk = lnk[index_k] - lnk_pivot;
+      pk[index_k] = (tilt_[index_md][index_ic1_ic2] - 1.)*dlnk
+        + 0.5*running_[index_md][index_ic1_ic2]*dlnk*dlnk;
+    }
+    class_call(vector_exp(size, pk, pk), error_message_, error_message_);
+    for (index_k = 0; index_k < size; index_k++) {
+      pk[index_k] *= amplitude_[index_md][index_ic1_ic2];
+    }
+  }
+  else {
+    for (index_k = 0; index_k < size; index_k++) {
+      pk[index_k] = 0.;
+    }
+  }
+
+  return _SUCCESS_;
+
+}
+
+/**
+ * Logarithm of primordial_analytic_spectrum() for a whole array of
+ * ln(k) values, for a diagonal pair of initial conditions (whose
+ * amplitude is positive).
+ *
+ * @param index_md       Input: index of mode (scalar, tensor, ...)
+ * @param index_ic1_ic2  Input: pair of initial conditions (ic, ic)
+ * @param size           Input: number of wavenumbers
+ * @param lnk            Input: array of ln(k), with k in same units as pivot scale, i.e. in 1/Mpc
+ * @param lnpk           Output: array of ln(A) + (n-1) ln(k/k_pivot) + ...
+ * @return the error status
+ */
+
+int PrimordialModule::primordial_analytic_lnpk_vec(int index_md, int index_ic1_ic2, int size, const double * lnk, double * lnpk) const {
+
+  double lnk_pivot, lnA, dlnk;
+  int index_k;
+
+  class_test(amplitude_[index_md][index_ic1_ic2] <= 0.,
+             error_message_,
+             "cannot take the logarithm of a primordial spectrum with amplitude %e",
+             amplitude_[index_md][index_ic1_ic2]);
+
+  lnk_pivot = log(ppm->k_pivot);
+  lnA = log(amplitude_[index_md][index_ic1_ic2]);
+  for (index_k = 0; index_k < size; index_k++) {
+    dlnk = lnk[index_k] - lnk_pivot;
+    lnpk[index_k] = lnA
+      + (tilt_[index_md][index_ic1_ic2] - 1.)*dlnk
+      + 0.5*running_[index_md][index_ic1_ic2]*dlnk*dlnk;
+  }
+
+  return _SUCCESS_;
+
+}
+
 /**
  * This routine encodes the inflaton scalar potential
  *
@@ -1524,7 +1665,9 @@ int PrimordialModule::primordial_inflation_analytic_spectra(double * y_ini) {
 
 int PrimordialModule::primordial_inflation_spectra(double * y_ini) {
   int index_k;
-  Tools::TaskSystem task_system(pba->number_of_threads);
+  /* each wavenumber integrates the inflaton and metric perturbations over thousands of steps */
+  Tools::ThreadLease thread_lease(number_of_workers(lnk_size_, 1.e5));
+  Tools::TaskSystem task_system(thread_lease.Count());
   std::vector<std::future<int>> future_output;
 
   /* loop over Fourier wavenumbers */
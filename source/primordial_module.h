@@ -11,6 +11,8 @@ public:
   ~PrimordialModule();
 
   int primordial_spectrum_at_k(int index_md, enum linear_or_logarithmic mode, double k, double* pk) const;
+  int primordial_spectrum_at_k(int index_md, enum linear_or_logarithmic mode, double k, double* pk, ErrorMsg error_message) const;
+  int primordial_spectrum_on_grid(int index_md, enum linear_or_logarithmic mode, const Tools::Grid* grid, double** table) const;
   int primordial_output_titles(char titles[_MAXTITLESTRINGLENGTH_]) const;
   int primordial_output_data(int number_of_titles, double* data) const;
 
@@ -48,6 +50,8 @@ private:
   int primordial_get_lnk_list(double kmin, double kmax, double k_per_decade);
   int primordial_analytic_spectrum_init();
   int primordial_analytic_spectrum(int index_md, int index_ic1_ic2, double k, double* pk) const;
+  int primordial_analytic_spectrum_vec(int index_md, int index_ic1_ic2, int size, const double* lnk, double* pk) const;
+  int primordial_analytic_lnpk_vec(int index_md, int index_ic1_ic2, int size, const double* lnk, double* lnpk) const;
   int primordial_inflation_potential(double phi, double* V, double* dV, double* ddV) const;
   int primordial_inflation_hubble(double phi, double* H, double* dH, double* ddH, double* dddH) const;
   int primordial_inflation_indices();
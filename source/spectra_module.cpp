@@ -211,13 +211,15 @@ std::map<std::string, std::vector<double>> SpectraModule::cl_output(int lmax) co
  * @param cl_tot     Output: total \f$C_l\f$'s for all types (TT, TE, EE, etc..)
  * @param cl_md      Output: \f$C_l\f$'s for all types (TT, TE, EE, etc..) decomposed mode by mode (scalar, tensor, ...) when relevant
  * @param cl_md_ic   Output: \f$C_l\f$'s for all types (TT, TE, EE, etc..) decomposed by pairs of initial conditions (adiabatic, isocurvatures) for each mode (usually, only for the scalar mode) when relevant
+ * @param error_message Output: error message, owned by the caller (see "Concurrent queries" in base_module.h)
  * @return the error status
  */
 
 int SpectraModule::spectra_cl_at_l(double l,
                     double * cl_tot,    /* array with argument cl_tot[index_ct] (must be already allocated) */
                     double * * cl_md,   /* array with argument cl_md[index_md][index_ct] (must be already allocated only if several modes) */
-                    double * * cl_md_ic /* array with argument cl_md_ic[index_md][index_ic1_ic2*ct_size_+index_ct] (must be already allocated for a given mode only if several ic's) */
+                    double * * cl_md_ic, /* array with argument cl_md_ic[index_md][index_ic1_ic2*ct_size_+index_ct] (must be already allocated for a given mode only if several ic's) */
+                    ErrorMsg error_message
                     ) const {
 
   /** Summary: */
@@ -246,9 +248,9 @@ int SpectraModule::spectra_cl_at_l(double l,
                                           &last_index,
                                           cl_tot,
                                           ct_size_,
-                                          error_message_),
-                 error_message_,
-                 error_message_);
+                                          error_message),
+                 error_message,
+                 error_message);
 
       /* set to zero for the types such that l<l_max */
       for (index_ct = 0; index_ct < ct_size_; index_ct++)
@@ -284,9 +286,9 @@ int SpectraModule::spectra_cl_at_l(double l,
                                               &last_index,
                                               cl_md_ic[index_md],
                                               ic_ic_size_[index_md]*ct_size_,
-                                              error_message_),
-                     error_message_,
-                     error_message_);
+                                              error_message),
+                     error_message,
+                     error_message);
 
           for (index_ct = 0; index_ct < ct_size_; index_ct++)
             if ((int)l > l_max_ct_[index_md][index_ct])
@@ -333,9 +335,9 @@ int SpectraModule::spectra_cl_at_l(double l,
                                               &last_index,
                                               cl_md[index_md],
                                               ct_size_,
-                                              error_message_),
-                     error_message_,
-                     error_message_);
+                                              error_message),
+                     error_message,
+                     error_message);
 
           for (index_ct = 0; index_ct < ct_size_; index_ct++)
             if ((int)l > l_max_ct_[index_md][index_ct])
@@ -365,9 +367,9 @@ int SpectraModule::spectra_cl_at_l(double l,
                                               &last_index,
                                               cl_md_ic[index_md],
                                               ic_ic_size_[index_md]*ct_size_,
-                                              error_message_),
-                     error_message_,
-                     error_message_);
+                                              error_message),
+                     error_message,
+                     error_message);
 
           /* set to zero some of the components */
           for (index_ic1 = 0; index_ic1 < ic_size_[index_md]; index_ic1++) {
@@ -423,6 +425,10 @@ int SpectraModule::spectra_cl_at_l(double l,
 
 }
 
+int SpectraModule::spectra_cl_at_l(double l, double * cl_tot, double * * cl_md, double * * cl_md_ic) const {
+  return spectra_cl_at_l(l, cl_tot, cl_md, cl_md_ic, error_message_);
+}
+
 /**
  * This routine initializes the spectra structure (in particular,
  * computes table of anisotropy and Fourier spectra \f$ C_l^{X}, P(k), ... \f$)
@@ -500,8 +506,8 @@ int SpectraModule::spectra_free() {
 
       for (index_md = 0; index_md < md_size_; index_md++) {
         free(l_max_ct_[index_md]);
-        free(cl_[index_md]);
-        free(ddcl_[index_md]);
+        class_free_table(cl_[index_md]);
+        class_free_table(ddcl_[index_md]);
       }
       free(l_);
       free(l_size_);
@@ -842,7 +848,20 @@ int SpectraModule::spectra_cls() {
     l_[index_l] = (double)transfer_module_->l_[index_l];
   }
 
-  Tools::TaskSystem task_system(pba->number_of_threads);
+  /** - take the workers for the pairs of initial conditions of all modes;
+        each of them integrates over q for every multipole and C_l type */
+  int ic_ic_task_count = 0;
+  double ic_ic_work = 0.;
+  for (index_md = 0; index_md < md_size_; index_md++) {
+    for (index_ic1_ic2 = 0; index_ic1_ic2 < ic_ic_size_[index_md]; index_ic1_ic2++) {
+      if (is_non_zero_[index_md][index_ic1_ic2] == _TRUE_) {
+        ic_ic_task_count++;
+        ic_ic_work += 10.*transfer_module_->l_size_[index_md]*transfer_module_->q_size_*ct_size_;
+      }
+    }
+  }
+  Tools::ThreadLease thread_lease(number_of_workers(ic_ic_task_count, ic_ic_work/MAX(ic_ic_task_count, 1)));
+  Tools::TaskSystem task_system(thread_lease.Count());
   std::vector<std::future<int>> future_output;
 
   /** - loop over modes (scalar, tensors, etc). For each mode: */
@@ -855,11 +874,18 @@ int SpectraModule::spectra_cls() {
 
     /** - --> (b) allocate arrays where results will be stored */
 
-    class_alloc(cl_[index_md],sizeof(double)*l_size_[index_md]*ct_size_*ic_ic_size_[index_md],error_message_);
-    class_alloc(ddcl_[index_md], sizeof(double)*l_size_[index_md]*ct_size_*ic_ic_size_[index_md], error_message_);
+    class_alloc_table(cl_[index_md],sizeof(double)*l_size_[index_md]*ct_size_*ic_ic_size_[index_md],error_message_);
+    class_alloc_table(ddcl_[index_md], sizeof(double)*l_size_[index_md]*ct_size_*ic_ic_size_[index_md], error_message_);
     cl_integrand_num_columns = 1 + ct_size_*2; /* one for k, ct_size_ for each type, ct_size_ for each second derivative of each type */
 
-    /** - --> (c) loop over initial conditions */
+    /** - --> (c) tabulate the primordial spectrum on the wavenumbers of the transfer functions, once for all multipoles and initial conditions */
+
+    double * primordial_pk_table; /* array with argument primordial_pk_table[index_q*ic_ic_size_[index_md] + index_ic1_ic2], owned by the grid service */
+    class_call(primordial_module_->primordial_spectrum_on_grid(index_md, linear, grid_service_->Find("transfer_k_" + std::to_string(index_md)), &primordial_pk_table),
+               primordial_module_->error_message_,
+               error_message_);
+
+    /** - --> (d) loop over initial conditions */
 
     for (index_ic1 = 0; index_ic1 < ic_size_[index_md]; index_ic1++) {
       for (index_ic2 = index_ic1; index_ic2 < ic_size_[index_md]; index_ic2++) {
@@ -868,15 +894,13 @@ int SpectraModule::spectra_cls() {
         /* non-diagonal coefficients should be computed only if non-zero correlation */
         if (is_non_zero_[index_md][index_ic1_ic2] == _TRUE_) {
 
-          future_output.push_back(task_system.AsyncTask([this, index_md, cl_integrand_num_columns, index_ic1, index_ic2] () {
+          future_output.push_back(task_system.AsyncTask([this, index_md, cl_integrand_num_columns, index_ic1, index_ic2, primordial_pk_table] () {
             double * cl_integrand; /* array with argument cl_integrand[index_k*cl_integrand_num_columns+1+psp->index_ct] */
             double * transfer_ic1; /* array with argument transfer_ic1[index_tt] */
             double * transfer_ic2; /* idem */
-            double * primordial_pk;  /* array with argument primordial_pk[index_ic_ic]*/
 
 
             class_alloc(cl_integrand, transfer_module_->q_size_*cl_integrand_num_columns*sizeof(double), error_message_);
-            class_alloc(primordial_pk, ic_ic_size_[index_md]*sizeof(double), error_message_);
             class_alloc(transfer_ic1, transfer_module_->tt_size_[index_md]*sizeof(double), error_message_);
             class_alloc(transfer_ic2, transfer_module_->tt_size_[index_md]*sizeof(double), error_message_);
 
@@ -896,7 +920,7 @@ int SpectraModule::spectra_cls() {
                                             index_l,
                                             cl_integrand_num_columns,
                                             cl_integrand,
-                                            primordial_pk,
+                                            primordial_pk_table,
                                             transfer_ic1,
                                             transfer_ic2),
                          error_message_,
@@ -906,8 +930,6 @@ int SpectraModule::spectra_cls() {
 
             free(cl_integrand);
 
-            free(primordial_pk);
-
             free(transfer_ic1);
 
             free(transfer_ic2);
@@ -929,12 +951,16 @@ int SpectraModule::spectra_cls() {
       }
     }
 
+    int status = _SUCCESS_;
     for (std::future<int>& future : future_output) {
-        if (future.get() != _SUCCESS_) return _FAILURE_;
+        if (future.get() != _SUCCESS_) status = _FAILURE_;
     }
     future_output.clear();
+    if (status == _FAILURE_) {
+      return _FAILURE_;
+    }
 
-    /** - --> (d) now that for a given mode, all possible \f$ C_l\f$'s have been computed,
+    /** - --> (e) now that for a given mode, all possible \f$ C_l\f$'s have been computed,
         compute second derivative of the array in which they are stored,
         in view of spline interpolation. */
 
@@ -969,7 +995,7 @@ int SpectraModule::spectra_cls() {
  * @param index_l       Input: index of multipole under consideration
  * @param cl_integrand_num_columns Input: number of columns in cl_integrand
  * @param cl_integrand  Input: an allocated workspace
- * @param primordial_pk Input: table of primordial spectrum values
+ * @param primordial_pk_table Input: primordial spectrum at the wavenumbers of the transfer functions, primordial_pk_table[index_q*ic_ic_size_[index_md] + index_ic1_ic2]
  * @param transfer_ic1  Input: table of transfer function values for first initial condition
  * @param transfer_ic2  Input: table of transfer function values for second initial condition
  * @return the error status
@@ -981,7 +1007,7 @@ int SpectraModule::spectra_compute_cl(int index_md,
                        int index_l,
                        int cl_integrand_num_columns,
                        double * cl_integrand,
-                       double * primordial_pk,
+                       const double * primordial_pk_table,
                        double * transfer_ic1,
                        double * transfer_ic2
                        ) {
@@ -999,6 +1025,7 @@ int SpectraModule::spectra_compute_cl(int index_md,
   double * transfer_ic2_nc=NULL;
   double factor;
   int index_q_spline=0;
+  const double * primordial_pk;
 
   index_ic1_ic2 = index_symmetric_matrix(index_ic1, index_ic2, ic_size_[index_md]);
 
@@ -1013,11 +1040,9 @@ int SpectraModule::spectra_compute_cl(int index_md,
 
     cl_integrand[index_q*cl_integrand_num_columns+0] = k;
 
-    class_call(primordial_module_->primordial_spectrum_at_k(index_md, linear, k, primordial_pk),
-               primordial_module_->error_message_,
-               error_message_);
+    primordial_pk = primordial_pk_table + index_q*ic_ic_size_[index_md];
 
-    /* above routine checks that k>0: no possible division by zero below */
+    /* the tabulation in spectra_cls() checks that k>0: no possible division by zero below */
 
     for (index_tt = 0; index_tt < transfer_module_->tt_size_[index_md]; index_tt++) {
 
@@ -13,6 +13,7 @@ public:
   SpectraModule(InputModulePtr input_module, PerturbationsModulePtr perturbations_module, PrimordialModulePtr primordial_module_, NonlinearModulePtr nonlinear_module, TransferModulePtr transfer_module);
   ~SpectraModule();
   int spectra_cl_at_l(double l, double * cl, double ** cl_md, double ** cl_md_ic) const;
+  int spectra_cl_at_l(double l, double * cl, double ** cl_md, double ** cl_md_ic, ErrorMsg error_message) const;
   std::map<std::string, int> cl_output_index_map() const;
   std::map<std::string, std::vector<double>> cl_output(int lmax) const;
   void cl_output_no_copy(int lmax, std::vector<double*>& output_pointers) const;
@@ -86,7 +87,7 @@ private:
   int spectra_free();
   int spectra_indices();
   int spectra_cls();
-  int spectra_compute_cl(int index_md, int index_ic1, int index_ic2, int index_l, int cl_integrand_num_columns, double * cl_integrand, double * primordial_pk, double * transfer_ic1, double * transfer_ic2);
+  int spectra_compute_cl(int index_md, int index_ic1, int index_ic2, int index_l, int cl_integrand_num_columns, double * cl_integrand, const double * primordial_pk_table, double * transfer_ic1, double * transfer_ic2);
   int spectra_k_and_tau();
   /* deprecated functions (since v2.8) */
   int spectra_pk_at_z(enum linear_or_logarithmic mode, double z, double * output_tot, double * output_ic, double * output_cb_tot, double * output_cb_ic);
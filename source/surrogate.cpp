@@ -0,0 +1,1418 @@
+/** @file surrogate.cpp Surrogate (emulator) mode
+ *
+ * A SurrogateModel is trained on a box in a few input parameters by
+ * running the full solver on a Latin hypercube design. The logarithm
+ * of the positive spectra (and the value of the others, e.g. TE) are
+ * standardised, compressed by a principal component analysis and each
+ * component is fitted by a total-degree Chebyshev expansion in the
+ * parameters rescaled to [-1, 1].
+ *
+ * A SurrogateCosmology evaluates the model at one point and serves the
+ * spectra with the accessors cl_output() and pk_at_k_and_z(). Outside
+ * the box, for parameters that were not varied during training, or when
+ * the error estimate exceeds the tolerance, it runs the full Cosmology
+ * instead and serves the spectra from its modules.
+ */
+
+#include "surrogate.h"
+#include "background_module.h"
+#include "thermodynamics_module.h"
+#include "nonlinear_module.h"
+#include "spectra_module.h"
+#include "lensing_module.h"
+
+#include <algorithm>
+#include <random>
+
+namespace {
+
+const char surrogate_file_tag[16] = "CLASS_SURROGATE";
+const int surrogate_file_version = 2;
+
+std::string trim(const char* string) {
+  std::string result(string);
+  size_t begin = result.find_first_not_of(" \t\n");
+  if (begin == std::string::npos) {
+    return "";
+  }
+  size_t end = result.find_last_not_of(" \t\n");
+  return result.substr(begin, end - begin + 1);
+}
+
+bool is_surrogate_parameter(const char* name) {
+  return strncmp(name, "surrogate_", 10) == 0;
+}
+
+/**
+ * Fill a FileContent with the given names and values. The read flags are
+ * all set to _FALSE_.
+ */
+int file_content_from_entries(const std::vector<std::string>& names, const std::vector<std::string>& values, FileContent& fc, ErrorMsg error_message) {
+  class_call(parser_init(&fc, names.size(), (char*)"surrogate", error_message),
+             error_message,
+             error_message);
+  int size = names.size();
+  for (int i = 0; i < size; i++) {
+    class_test((names[i].size() >= _ARGUMENT_LENGTH_MAX_) || (values[i].size() >= _ARGUMENT_LENGTH_MAX_),
+               error_message,
+               "parameter '%s' is too long", names[i].c_str());
+    strcpy(fc.name[i], names[i].c_str());
+    strcpy(fc.value[i], values[i].c_str());
+    fc.read[i] = _FALSE_;
+  }
+  return _SUCCESS_;
+}
+
+/**
+ * Least-squares solution of A X = B by Householder QR factorisation.
+ * A is stored as A[index_row*cols + index_col], B as B[index_row*rhs_size + index_rhs]
+ * and the solution as X[index_col*rhs_size + index_rhs]. A and B are overwritten.
+ */
+int least_squares(int rows, int cols, double* A, int rhs_size, double* B, double* X, ErrorMsg error_message) {
+  std::vector<double> v(rows);
+  double r_max = 0.;
+
+  for (int j = 0; j < cols; j++) {
+    double norm = 0.;
+    for (int i = j; i < rows; i++) {
+      norm += A[i*cols + j]*A[i*cols + j];
+    }
+    norm = sqrt(norm);
+    double alpha = (A[j*cols + j] > 0.) ? -norm : norm;
+    double v_norm2 = 0.;
+    for (int i = j; i < rows; i++) {
+      v[i] = A[i*cols + j];
+    }
+    v[j] -= alpha;
+    for (int i = j; i < rows; i++) {
+      v_norm2 += v[i]*v[i];
+    }
+    if (v_norm2 > 0.) {
+      for (int c = j; c < cols; c++) {
+        double s = 0.;
+        for (int i = j; i < rows; i++) {
+          s += v[i]*A[i*cols + c];
+        }
+        s *= 2./v_norm2;
+        for (int i = j; i < rows; i++) {
+          A[i*cols + c] -= s*v[i];
+        }
+      }
+      for (int c = 0; c < rhs_size; c++) {
+        double s = 0.;
+        for (int i = j; i < rows; i++) {
+          s += v[i]*B[i*rhs_size + c];
+        }
+        s *= 2./v_norm2;
+        for (int i = j; i < rows; i++) {
+          B[i*rhs_size + c] -= s*v[i];
+        }
+      }
+    }
+    r_max = std::max(r_max, fabs(A[j*cols + j]));
+  }
+
+  for (int j = cols - 1; j >= 0; j--) {
+    class_test(fabs(A[j*cols + j]) <= 1.e-12*r_max,
+               error_message,
+               "the design matrix is singular, increase surrogate_design_size or decrease surrogate_order");
+    for (int c = 0; c < rhs_size; c++) {
+      double sum = B[j*rhs_size + c];
+      for (int k = j + 1; k < cols; k++) {
+        sum -= A[j*cols + k]*X[k*rhs_size + c];
+      }
+      X[j*rhs_size + c] = sum/A[j*cols + j];
+    }
+  }
+  return _SUCCESS_;
+}
+
+/**
+ * Eigen-decomposition of the symmetric matrix G (size x size) by cyclic
+ * Jacobi rotations. On output the eigenvalues are in lambda and the
+ * eigenvectors in the columns of V, V[index_row*size + index_eigenvalue].
+ */
+void jacobi_eigen(int size, double* G, double* lambda, double* V) {
+  for (int i = 0; i < size; i++) {
+    for (int j = 0; j < size; j++) {
+      V[i*size + j] = (i == j) ? 1. : 0.;
+    }
+  }
+  for (int sweep = 0; sweep < 100; sweep++) {
+    double off = 0.;
+    double diagonal = 0.;
+    for (int i = 0; i < size; i++) {
+      diagonal += G[i*size + i]*G[i*size + i];
+      for (int j = i + 1; j < size; j++) {
+        off += G[i*size + j]*G[i*size + j];
+      }
+    }
+    if (off <= 1.e-30*diagonal) {
+      break;
+    }
+    for (int p = 0; p < size; p++) {
+      for (int q = p + 1; q < size; q++) {
+        double gpq = G[p*size + q];
+        if (gpq == 0.) {
+          continue;
+        }
+        double theta = (G[q*size + q] - G[p*size + p])/(2.*gpq);
+        double t = ((theta >= 0.) ? 1. : -1.)/(fabs(theta) + sqrt(theta*theta + 1.));
+        double c = 1./sqrt(t*t + 1.);
+        double s = t*c;
+        for (int k = 0; k < size; k++) {
+          double gkp = G[k*size + p];
+          double gkq = G[k*size + q];
+          G[k*size + p] = c*gkp - s*gkq;
+          G[k*size + q] = s*gkp + c*gkq;
+        }
+        for (int k = 0; k < size; k++) {
+          double gpk = G[p*size + k];
+          double gqk = G[q*size + k];
+          G[p*size + k] = c*gpk - s*gqk;
+          G[q*size + k] = s*gpk + c*gqk;
+        }
+        for (int k = 0; k < size; k++) {
+          double vkp = V[k*size + p];
+          double vkq = V[k*size + q];
+          V[k*size + p] = c*vkp - s*vkq;
+          V[k*size + q] = s*vkp + c*vkq;
+        }
+      }
+    }
+  }
+  for (int i = 0; i < size; i++) {
+    lambda[i] = G[i*size + i];
+  }
+}
+
+template <typename T>
+void write_vector(FILE* file, const std::vector<T>& vector) {
+  int size = vector.size();
+  fwrite(&size, sizeof(int), 1, file);
+  fwrite(vector.data(), sizeof(T), size, file);
+}
+
+template <typename T>
+bool read_vector(FILE* file, std::vector<T>& vector) {
+  int size;
+  if ((fread(&size, sizeof(int), 1, file) != 1) || (size < 0)) {
+    return false;
+  }
+  vector.resize(size);
+  return fread(vector.data(), sizeof(T), size, file) == (size_t)size;
+}
+
+void write_strings(FILE* file, const std::vector<std::string>& strings) {
+  int size = strings.size();
+  fwrite(&size, sizeof(int), 1, file);
+  for (const std::string& string : strings) {
+    int length = string.size();
+    fwrite(&length, sizeof(int), 1, file);
+    fwrite(string.data(), sizeof(char), length, file);
+  }
+}
+
+bool read_strings(FILE* file, std::vector<std::string>& strings) {
+  int size;
+  if ((fread(&size, sizeof(int), 1, file) != 1) || (size < 0)) {
+    return false;
+  }
+  strings.resize(size);
+  for (std::string& string : strings) {
+    int length;
+    if ((fread(&length, sizeof(int), 1, file) != 1) || (length < 0) || (length >= _ARGUMENT_LENGTH_MAX_)) {
+      return false;
+    }
+    string.resize(length);
+    if (fread(&string[0], sizeof(char), length, file) != (size_t)length) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}
+
+bool SurrogateModel::surrogate_training_requested(FileContent& fc) {
+  for (int i = 0; i < fc.size; i++) {
+    if (strcmp(fc.name[i], "surrogate_parameters") == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+SurrogateModel::SurrogateModel(FileContent& fc) {
+  if (surrogate_train(fc) != _SUCCESS_) {
+    throw std::runtime_error(error_message_);
+  }
+}
+
+SurrogateModel::SurrogateModel(const std::string& filename) {
+  if (surrogate_read(filename) != _SUCCESS_) {
+    throw std::runtime_error(error_message_);
+  }
+}
+
+/**
+ * Train the model: run the solver on the design and the validation
+ * points, and fit the principal components.
+ *
+ * @param fc  Input: all input parameters, including the surrogate_* settings
+ * @return the error status
+ */
+
+int SurrogateModel::surrogate_train(FileContent& fc) {
+
+  int design_size;
+  int validation_size;
+  int pca_size_max;
+  double pca_tolerance;
+  int seed;
+  int verbose;
+  FileArg filename;
+  int flag;
+
+  /** - read the settings and keep the fixed part of the input */
+  class_call(surrogate_read_settings(fc, &design_size, &validation_size, &pca_size_max, &pca_tolerance, &seed, &verbose),
+             error_message_,
+             error_message_);
+  class_call(parser_read_string(&fc, "surrogate_file", &filename, &flag, error_message_),
+             error_message_,
+             error_message_);
+  int parameter_size = parameter_names_.size();
+
+  if (verbose > 0) {
+    printf("Training surrogate in %d parameters: %d design points, %d validation points, %d terms of order <= %d\n",
+           parameter_size, design_size, validation_size, term_size_, order_);
+  }
+
+  /** - find the range of wavenumbers computed at every corner of the box, before running the solver */
+  double k_min = 0.;
+  double k_max = 0.;
+  class_call(surrogate_k_range(fc, &k_min, &k_max),
+             error_message_,
+             error_message_);
+
+  /** - the centre of the box fixes the l grid, and the k sampling within [k_min, k_max] */
+  std::vector<double> x_centre(parameter_size, 0.);
+  {
+    FileContent fc_point;
+    class_call(surrogate_file_content(x_centre.data(), fc_point),
+               error_message_,
+               error_message_);
+    try {
+      Cosmology cosmology{fc_point};
+      class_call(surrogate_set_grids(fc, cosmology, k_min, k_max),
+                 error_message_,
+                 error_message_);
+    }
+    catch (std::exception& e) {
+      class_stop(error_message_, "the run at the centre of the box failed: %s", e.what());
+    }
+  }
+
+  /** - run the solver on the design and the validation points */
+  std::vector<double> x_design;
+  std::vector<double> x_validation;
+  class_call(surrogate_latin_hypercube(design_size, seed, x_design),
+             error_message_,
+             error_message_);
+  class_call(surrogate_latin_hypercube(validation_size, seed + 1, x_validation),
+             error_message_,
+             error_message_);
+
+  std::vector<double> features_design;
+  std::vector<double> features_validation;
+  std::vector<double> features;
+  for (int index_run = 0; index_run < design_size + validation_size; index_run++) {
+    bool is_design = (index_run < design_size);
+    const double* x = is_design ? &x_design[index_run*parameter_size] : &x_validation[(index_run - design_size)*parameter_size];
+    if (verbose > 1) {
+      printf(" -> running %s point %d/%d\n",
+             is_design ? "design" : "validation",
+             is_design ? index_run + 1 : index_run - design_size + 1,
+             is_design ? design_size : validation_size);
+    }
+    class_call(surrogate_run(x, features),
+               error_message_,
+               error_message_);
+    std::vector<double>& destination = is_design ? features_design : features_validation;
+    destination.insert(destination.end(), features.begin(), features.end());
+  }
+
+  /** - choose the transformation of each type of spectrum from all the runs */
+  class_call(surrogate_set_transforms(features_design, features_validation),
+             error_message_,
+             error_message_);
+
+  /** - compress and fit */
+  class_call(surrogate_fit(design_size, x_design.data(), features_design, pca_size_max, pca_tolerance),
+             error_message_,
+             error_message_);
+
+  /** - compare the model with the validation runs to calibrate the error indicator */
+  std::vector<double> prediction(feature_size_);
+  std::vector<double> prediction_low(feature_size_);
+  std::vector<double> truth(feature_size_);
+  validation_error_ = 0.;
+  error_calibration_ = (validation_size > 0) ? 0. : 1.;
+  /* where the indicator vanishes (the two orders agree), the ratio says
+     nothing about the model: floor it well below the tolerance */
+  double indicator_floor = 1.e-2*error_tolerance_;
+  for (int index_v = 0; index_v < validation_size; index_v++) {
+    const double* x = &x_validation[index_v*parameter_size];
+    const double* raw = &features_validation[index_v*feature_size_];
+    class_call(surrogate_predict(x, order_, prediction.data()),
+               error_message_,
+               error_message_);
+    class_call(surrogate_predict(x, order_ - 1, prediction_low.data()),
+               error_message_,
+               error_message_);
+    /* is_log_ was chosen on the validation runs too, so that raw > 0 for all log features */
+    for (int index_f = 0; index_f < feature_size_; index_f++) {
+      truth[index_f] = (is_log_[index_f] == _TRUE_) ? log(raw[index_f]) : raw[index_f];
+    }
+    double error = surrogate_error(prediction.data(), truth.data());
+    double indicator = surrogate_error(prediction.data(), prediction_low.data());
+    validation_error_ = std::max(validation_error_, error);
+    error_calibration_ = std::max(error_calibration_, error/std::max(indicator, indicator_floor));
+  }
+
+  if (verbose > 0) {
+    printf(" -> kept %d principal components for %d values; largest validation error %g\n",
+           pca_size_, feature_size_, validation_error_);
+  }
+
+  if (flag == _TRUE_) {
+    class_call(surrogate_write(trim(filename)),
+               error_message_,
+               error_message_);
+    if (verbose > 0) {
+      printf(" -> surrogate written to '%s'\n", trim(filename).c_str());
+    }
+  }
+
+  return _SUCCESS_;
+}
+
+/**
+ * Read the surrogate_* settings and store all other input parameters as
+ * the fixed part of the model.
+ */
+
+int SurrogateModel::surrogate_read_settings(FileContent& fc, int* design_size, int* validation_size, int* pca_size_max, double* pca_tolerance, int* seed, int* verbose) {
+
+  int flag;
+  int size;
+  char* names = nullptr;
+  double* list = nullptr;
+
+  class_call(parser_read_list_of_strings(&fc, "surrogate_parameters", &size, &names, &flag, error_message_),
+             error_message_,
+             error_message_);
+  class_test(flag == _FALSE_,
+             error_message_,
+             "surrogate_parameters must list the input parameters to vary");
+  for (int i = 0; i < size; i++) {
+    parameter_names_.push_back(trim(names + i*_ARGUMENT_LENGTH_MAX_));
+  }
+  free(names);
+  int parameter_size = parameter_names_.size();
+
+  class_call(parser_read_list_of_doubles(&fc, "surrogate_parameters_min", &size, &list, &flag, error_message_),
+             error_message_,
+             error_message_);
+  class_test((flag == _FALSE_) || (size != parameter_size),
+             error_message_,
+             "surrogate_parameters_min must have one entry per surrogate parameter");
+  parameter_min_.assign(list, list + size);
+  free(list);
+  class_call(parser_read_list_of_doubles(&fc, "surrogate_parameters_max", &size, &list, &flag, error_message_),
+             error_message_,
+             error_message_);
+  class_test((flag == _FALSE_) || (size != parameter_size),
+             error_message_,
+             "surrogate_parameters_max must have one entry per surrogate parameter");
+  parameter_max_.assign(list, list + size);
+  free(list);
+  for (int index_p = 0; index_p < parameter_size; index_p++) {
+    class_test(parameter_max_[index_p] <= parameter_min_[index_p],
+               error_message_,
+               "empty range for surrogate parameter '%s'", parameter_names_[index_p].c_str());
+  }
+
+  order_ = 3;
+  class_call(parser_read_int(&fc, "surrogate_order", &order_, &flag, error_message_),
+             error_message_,
+             error_message_);
+  class_test(order_ < 1,
+             error_message_,
+             "surrogate_order must be at least 1, you asked for %d", order_);
+
+  /** - list the multi-indices of total degree <= order_, sorted by degree */
+  std::vector<int> degree(parameter_size, 0);
+  for (int total = 0; total <= order_; total++) {
+    if (total == order_) {
+      term_size_low_ = multi_index_.size()/parameter_size;
+    }
+    std::fill(degree.begin(), degree.end(), 0);
+    while (true) {
+      int sum = 0;
+      for (int d : degree) sum += d;
+      if (sum == total) {
+        multi_index_.insert(multi_index_.end(), degree.begin(), degree.end());
+      }
+      int index_p = 0;
+      while ((index_p < parameter_size) && (++degree[index_p] > total)) {
+        degree[index_p++] = 0;
+      }
+      if (index_p == parameter_size) {
+        break;
+      }
+    }
+  }
+  term_size_ = multi_index_.size()/parameter_size;
+
+  *design_size = 2*term_size_;
+  class_call(parser_read_int(&fc, "surrogate_design_size", design_size, &flag, error_message_),
+             error_message_,
+             error_message_);
+  class_test(*design_size < term_size_,
+             error_message_,
+             "surrogate_design_size = %d is smaller than the number of terms of the expansion (%d)", *design_size, term_size_);
+  *validation_size = std::max(1, *design_size/4);
+  class_call(parser_read_int(&fc, "surrogate_validation_size", validation_size, &flag, error_message_),
+             error_message_,
+             error_message_);
+  *pca_size_max = 40;
+  class_call(parser_read_int(&fc, "surrogate_pca_size_max", pca_size_max, &flag, error_message_),
+             error_message_,
+             error_message_);
+  *pca_tolerance = 1.e-10;
+  class_call(parser_read_double(&fc, "surrogate_pca_tolerance", pca_tolerance, &flag, error_message_),
+             error_message_,
+             error_message_);
+  error_tolerance_ = 1.e-2;
+  class_call(parser_read_double(&fc, "surrogate_error_tolerance", &error_tolerance_, &flag, error_message_),
+             error_message_,
+             error_message_);
+  class_test(error_tolerance_ <= 0.,
+             error_message_,
+             "surrogate_error_tolerance=%g should be positive", error_tolerance_);
+  *seed = 1;
+  class_call(parser_read_int(&fc, "surrogate_seed", seed, &flag, error_message_),
+             error_message_,
+             error_message_);
+  *verbose = 1;
+  class_call(parser_read_int(&fc, "surrogate_verbose", verbose, &flag, error_message_),
+             error_message_,
+             error_message_);
+
+  /** - keep all other parameters, except those we vary */
+  for (int i = 0; i < fc.size; i++) {
+    if (is_surrogate_parameter(fc.name[i])) {
+      continue;
+    }
+    if (std::find(parameter_names_.begin(), parameter_names_.end(), std::string(fc.name[i])) != parameter_names_.end()) {
+      fc.read[i] = _TRUE_;
+      continue;
+    }
+    base_names_.push_back(fc.name[i]);
+    base_values_.push_back(fc.value[i]);
+  }
+
+  return _SUCCESS_;
+}
+
+/**
+ * Range of wavenumbers (in 1/Mpc) in which P(k,z) can be read from the
+ * solver at every point of the box. The solver computes P(k) up to
+ * k_max_for_pk, which depends on the varied parameters (e.g. on h when
+ * P_k_max_h/Mpc is set), and from k_min_tau0/tau0 (or its curved
+ * generalisation, see perturb_get_k_list()). Both depend monotonically
+ * on the parameters of usual boxes, so the extremes over the corners of
+ * the box are used. surrogate_k_min and surrogate_k_max can narrow the
+ * range, but not extend it.
+ *
+ * Only the input and the background (plus the thermodynamics in open
+ * models) are computed at each corner. If the output has no P(k), k_min
+ * and k_max are set to zero.
+ *
+ * @param fc     Input: all input parameters, including the surrogate_* settings
+ * @param k_min  Output: smallest wavenumber of the model
+ * @param k_max  Output: largest wavenumber of the model
+ * @return the error status
+ */
+
+int SurrogateModel::surrogate_k_range(FileContent& fc, double* k_min, double* k_max) {
+
+  int flag;
+  int parameter_size = parameter_names_.size();
+  double k_min_box = 0.;
+  double k_max_box = _HUGE_;
+  std::vector<double> x(parameter_size);
+
+  *k_min = 0.;
+  *k_max = 0.;
+
+  for (int index_corner = 0; index_corner < (1 << parameter_size); index_corner++) {
+    for (int index_p = 0; index_p < parameter_size; index_p++) {
+      x[index_p] = ((index_corner >> index_p) & 1) ? 1. : -1.;
+    }
+    FileContent fc_point;
+    class_call(surrogate_file_content(x.data(), fc_point),
+               error_message_,
+               error_message_);
+    try {
+      Cosmology cosmology{fc_point};
+      const InputModulePtr& input_module = cosmology.GetInputModule();
+      if (input_module->perturbations_.has_pk_matter == _FALSE_) {
+        return _SUCCESS_;
+      }
+      double conformal_age = cosmology.GetBackgroundModule()->conformal_age_;
+      double k_min_corner;
+      if (input_module->background_.sgnK == 0) {
+        k_min_corner = input_module->precision_.k_min_tau0/conformal_age;
+      }
+      else if (input_module->background_.sgnK == -1) {
+        k_min_corner = sqrt(-input_module->background_.K
+                            + pow(input_module->precision_.k_min_tau0/conformal_age/cosmology.GetThermodynamicsModule()->angular_rescaling_, 2));
+      }
+      else {
+        k_min_corner = sqrt((8. - 1.e-4)*input_module->background_.K);
+      }
+      k_min_box = std::max(k_min_box, k_min_corner);
+      k_max_box = std::min(k_max_box, input_module->perturbations_.k_max_for_pk);
+    }
+    catch (std::exception& e) {
+      class_stop(error_message_, "the run at a corner of the box failed: %s", e.what());
+    }
+  }
+
+  /* a small margin above k_min, where the solver's spline starts */
+  *k_min = 1.05*k_min_box;
+  *k_max = k_max_box;
+  class_call(parser_read_double(&fc, "surrogate_k_min", k_min, &flag, error_message_),
+             error_message_,
+             error_message_);
+  class_test(*k_min < 1.05*k_min_box,
+             error_message_,
+             "surrogate_k_min = %g 1/Mpc is below the range computed at every corner of the box, k > %g 1/Mpc",
+             *k_min, 1.05*k_min_box);
+  class_call(parser_read_double(&fc, "surrogate_k_max", k_max, &flag, error_message_),
+             error_message_,
+             error_message_);
+  class_test(*k_max > k_max_box,
+             error_message_,
+             "surrogate_k_max = %g 1/Mpc is above the range computed at every corner of the box, k < %g 1/Mpc; increase P_k_max_1/Mpc or P_k_max_h/Mpc",
+             *k_max, k_max_box);
+  class_test((*k_min <= 0.) || (*k_max <= *k_min),
+             error_message_,
+             "invalid surrogate k range: k_min = %g, k_max = %g", *k_min, *k_max);
+
+  return _SUCCESS_;
+}
+
+/**
+ * Choose the multipoles, wavenumbers and redshifts of the model from the
+ * run at the centre of the box. The wavenumbers are taken in the range
+ * [k_min, k_max] found by surrogate_k_range().
+ */
+
+int SurrogateModel::surrogate_set_grids(FileContent& fc, Cosmology& cosmology, double k_min, double k_max) {
+
+  int flag;
+  const InputModulePtr& input_module = cosmology.GetInputModule();
+
+  l_max_ = 0;
+  has_lensed_cls_ = _FALSE_;
+  if (input_module->perturbations_.has_cls == _TRUE_) {
+    has_lensed_cls_ = input_module->lensing_.has_lensed_cls;
+    int l_max_computed = (has_lensed_cls_ == _TRUE_) ? cosmology.GetLensingModule()->l_lensed_max_ : cosmology.GetSpectraModule()->l_max_tot_;
+    l_max_ = l_max_computed;
+    class_call(parser_read_int(&fc, "surrogate_l_max", &l_max_, &flag, error_message_),
+               error_message_,
+               error_message_);
+    class_test((l_max_ < 2) || (l_max_ > l_max_computed),
+               error_message_,
+               "surrogate_l_max = %d is outside the computed range [2, %d]", l_max_, l_max_computed);
+    std::map<std::string, std::vector<double>> cls = (has_lensed_cls_ == _TRUE_) ? cosmology.GetLensingModule()->cl_output(2) : cosmology.GetSpectraModule()->cl_output(2);
+    for (const auto& element : cls) {
+      cl_names_.push_back(element.first);
+    }
+  }
+
+  pk_is_nonlinear_ = _FALSE_;
+  if (input_module->perturbations_.has_pk_matter == _TRUE_) {
+    NonlinearModulePtr& nonlinear_module = cosmology.GetNonlinearModule();
+    pk_is_nonlinear_ = (input_module->nonlinear_.method != nl_none);
+    int k_size = 0;
+    class_call(parser_read_int(&fc, "surrogate_k_size", &k_size, &flag, error_message_),
+               error_message_,
+               error_message_);
+    class_test((flag == _TRUE_) && (k_size < 4),
+               error_message_,
+               "surrogate_k_size must be at least 4, you asked for %d", k_size);
+
+    /** - by default, keep the k sampling of the solver, which resolves the BAO */
+    if (flag == _FALSE_) {
+      ln_k_.push_back(log(k_min));
+      for (int index_k = 0; index_k < nonlinear_module->k_size_; index_k++) {
+        if ((nonlinear_module->ln_k_[index_k] > log(k_min)) && (nonlinear_module->ln_k_[index_k] < log(k_max))) {
+          ln_k_.push_back(nonlinear_module->ln_k_[index_k]);
+        }
+      }
+      ln_k_.push_back(log(k_max));
+    }
+    else {
+      for (int index_k = 0; index_k < k_size; index_k++) {
+        ln_k_.push_back(log(k_min) + index_k*(log(k_max) - log(k_min))/(k_size - 1));
+      }
+    }
+
+    double z_max = input_module->perturbations_.z_max_pk;
+    int z_size = (z_max > 0.) ? 10 : 1;
+    class_call(parser_read_int(&fc, "surrogate_z_size", &z_size, &flag, error_message_),
+               error_message_,
+               error_message_);
+    class_test((z_size < 1) || ((z_size > 1) && (z_size < 4)),
+               error_message_,
+               "surrogate_z_size must be 1 or at least 4, you asked for %d", z_size);
+
+    for (int index_z = 0; index_z < z_size; index_z++) {
+      z_.push_back((z_size > 1) ? index_z*z_max/(z_size - 1) : 0.);
+    }
+  }
+
+  class_test((l_max_ == 0) && ln_k_.empty(),
+             error_message_,
+             "there is nothing to emulate: the surrogate needs Cl's and/or mPk in the output");
+
+  cl_feature_size_ = cl_names_.size()*(l_max_ > 0 ? l_max_ - 1 : 0);
+  feature_size_ = cl_feature_size_ + ln_k_.size()*z_.size();
+
+  return _SUCCESS_;
+}
+
+/**
+ * Input for a run at the rescaled point x in [-1, 1]^parameter_size.
+ */
+
+int SurrogateModel::surrogate_file_content(const double* x, FileContent& fc_point) const {
+
+  std::vector<std::string> names = base_names_;
+  std::vector<std::string> values = base_values_;
+  char value[_ARGUMENT_LENGTH_MAX_];
+
+  int parameter_size = parameter_names_.size();
+  for (int index_p = 0; index_p < parameter_size; index_p++) {
+    double centre = 0.5*(parameter_max_[index_p] + parameter_min_[index_p]);
+    double half_width = 0.5*(parameter_max_[index_p] - parameter_min_[index_p]);
+    sprintf(value, "%.17g", centre + half_width*x[index_p]);
+    names.push_back(parameter_names_[index_p]);
+    values.push_back(value);
+  }
+
+  class_call(file_content_from_entries(names, values, fc_point, error_message_),
+             error_message_,
+             error_message_);
+
+  return _SUCCESS_;
+}
+
+/**
+ * Run the solver at the rescaled point x and return the raw features.
+ */
+
+int SurrogateModel::surrogate_run(const double* x, std::vector<double>& features) {
+
+  FileContent fc_point;
+  class_call(surrogate_file_content(x, fc_point),
+             error_message_,
+             error_message_);
+
+  try {
+    Cosmology cosmology{fc_point};
+    class_call(surrogate_extract_features(cosmology, features),
+               error_message_,
+               error_message_);
+  }
+  catch (std::exception& e) {
+    class_stop(error_message_, "%s", e.what());
+  }
+
+  return _SUCCESS_;
+}
+
+/**
+ * Collect the Cl's and P(k,z) of a computed cosmology on the grids of the
+ * model: first all Cl's, type by type for l = 2..l_max_, then
+ * P(k_i, z_j) at index k_i*z_size + z_j.
+ */
+
+int SurrogateModel::surrogate_extract_features(Cosmology& cosmology, std::vector<double>& features) const {
+
+  features.resize(feature_size_);
+
+  if (l_max_ > 0) {
+    std::map<std::string, std::vector<double>> cls = (has_lensed_cls_ == _TRUE_) ? cosmology.GetLensingModule()->cl_output(l_max_) : cosmology.GetSpectraModule()->cl_output(l_max_);
+    int ct_size = cl_names_.size();
+    for (int index_ct = 0; index_ct < ct_size; index_ct++) {
+      auto it = cls.find(cl_names_[index_ct]);
+      class_test(it == cls.end(),
+                 error_message_,
+                 "Cl type '%s' was not computed", cl_names_[index_ct].c_str());
+      for (int l = 2; l <= l_max_; l++) {
+        features[index_ct*(l_max_ - 1) + l - 2] = it->second[l];
+      }
+    }
+  }
+
+  if (!ln_k_.empty()) {
+    NonlinearModulePtr& nonlinear_module = cosmology.GetNonlinearModule();
+    enum pk_outputs pk_output = (pk_is_nonlinear_ == _TRUE_) ? pk_nonlinear : pk_linear;
+    std::vector<double> workspace(nonlinear_module->nonlinear_pk_at_k_and_z_workspace_size());
+    int k_size = ln_k_.size();
+    int z_size = z_.size();
+    for (int index_k = 0; index_k < k_size; index_k++) {
+      for (int index_z = 0; index_z < z_size; index_z++) {
+        class_call(nonlinear_module->nonlinear_pk_at_k_and_z(pk_output, exp(ln_k_[index_k]), z_[index_z], nonlinear_module->index_pk_m_,
+                                                             &features[cl_feature_size_ + index_k*z_size + index_z], NULL,
+                                                             workspace.data(), error_message_),
+                   error_message_,
+                   error_message_);
+      }
+    }
+  }
+
+  return _SUCCESS_;
+}
+
+/**
+ * Latin hypercube of size points in [-1, 1]^parameter_size, stored as
+ * x[index_point*parameter_size + index_p].
+ */
+
+int SurrogateModel::surrogate_latin_hypercube(int size, int seed, std::vector<double>& x) const {
+
+  int parameter_size = parameter_names_.size();
+  std::mt19937 generator(seed);
+  std::uniform_real_distribution<double> uniform(0., 1.);
+  std::vector<int> permutation(size);
+
+  x.resize(size*parameter_size);
+  for (int index_p = 0; index_p < parameter_size; index_p++) {
+    for (int i = 0; i < size; i++) {
+      permutation[i] = i;
+    }
+    std::shuffle(permutation.begin(), permutation.end(), generator);
+    for (int i = 0; i < size; i++) {
+      x[i*parameter_size + index_p] = -1. + 2.*(permutation[i] + uniform(generator))/size;
+    }
+  }
+
+  return _SUCCESS_;
+}
+
+/**
+ * Choose the transformation of each block of features (one block per Cl
+ * type, and one for P(k,z)) from the raw features of all the runs, design
+ * and validation. A block is fitted in log if it is positive in all the
+ * runs, and linearly otherwise.
+ *
+ * The errors of the Cl's are measured relative to the largest absolute
+ * value of their block, as usual for Cl's: relative to each multipole,
+ * they would blow up near the zero crossings of e.g. TE, and where a
+ * spectrum is small compared to its peak. The errors of P(k,z) are
+ * relative to each value (or to the largest one if P(k,z) is not
+ * positive everywhere).
+ *
+ * @param features_design      Input: raw features of the design points
+ * @param features_validation  Input: raw features of the validation points
+ * @return the error status
+ */
+
+int SurrogateModel::surrogate_set_transforms(const std::vector<double>& features_design, const std::vector<double>& features_validation) {
+
+  is_log_.assign(feature_size_, _TRUE_);
+  norm_.assign(feature_size_, 1.);
+  int block_size = (l_max_ > 0) ? l_max_ - 1 : 0;
+  int ct_size = cl_names_.size();
+  int block_number = ct_size + (ln_k_.empty() ? 0 : 1);
+
+  for (int index_block = 0; index_block < block_number; index_block++) {
+    int first = index_block*block_size;
+    int last = (index_block < ct_size) ? first + block_size : feature_size_;
+    short is_positive = _TRUE_;
+    double largest = 0.;
+    for (const std::vector<double>* features : {&features_design, &features_validation}) {
+      int size = features->size()/feature_size_;
+      for (int i = 0; i < size; i++) {
+        for (int index_f = first; index_f < last; index_f++) {
+          double y = (*features)[i*feature_size_ + index_f];
+          if (y <= 0.) {
+            is_positive = _FALSE_;
+          }
+          largest = std::max(largest, fabs(y));
+        }
+      }
+    }
+    bool is_cl = (index_block < ct_size);
+    for (int index_f = first; index_f < last; index_f++) {
+      is_log_[index_f] = is_positive;
+      if ((is_cl || (is_positive == _FALSE_)) && (largest > 0.)) {
+        norm_[index_f] = largest;
+      }
+    }
+  }
+
+  return _SUCCESS_;
+}
+
+/**
+ * Transform and standardise the features, find their principal
+ * components and fit the Chebyshev coefficients of each component.
+ *
+ * @param size           Input: number of design points
+ * @param x              Input: design points in [-1, 1]^parameter_size
+ * @param features       Input: raw features of the design points, overwritten
+ * @param pca_size_max   Input: largest number of principal components
+ * @param pca_tolerance  Input: largest fraction of the variance left out
+ * @return the error status
+ */
+
+int SurrogateModel::surrogate_fit(int size, const double* x, std::vector<double>& features, int pca_size_max, double pca_tolerance) {
+
+  int parameter_size = parameter_names_.size();
+
+  /** - standardise the transformed features (see surrogate_set_transforms()) */
+  mean_.assign(feature_size_, 0.);
+  scale_.assign(feature_size_, 0.);
+
+  for (int index_f = 0; index_f < feature_size_; index_f++) {
+    for (int i = 0; i < size; i++) {
+      double& y = features[i*feature_size_ + index_f];
+      if (is_log_[index_f] == _TRUE_) {
+        y = log(y);
+      }
+      mean_[index_f] += y/size;
+    }
+    for (int i = 0; i < size; i++) {
+      double dy = features[i*feature_size_ + index_f] - mean_[index_f];
+      scale_[index_f] += dy*dy/size;
+    }
+    scale_[index_f] = sqrt(scale_[index_f]);
+    if (scale_[index_f] <= 1.e-14*std::max(1., fabs(mean_[index_f]))) {
+      scale_[index_f] = 1.;
+    }
+    for (int i = 0; i < size; i++) {
+      double& y = features[i*feature_size_ + index_f];
+      y = (y - mean_[index_f])/scale_[index_f];
+    }
+  }
+
+  /** - principal components from the eigenvectors of the (size x size) Gram matrix */
+  std::vector<double> gram(size*size, 0.);
+  for (int i = 0; i < size; i++) {
+    for (int j = i; j < size; j++) {
+      double sum = 0.;
+      for (int index_f = 0; index_f < feature_size_; index_f++) {
+        sum += features[i*feature_size_ + index_f]*features[j*feature_size_ + index_f];
+      }
+      gram[i*size + j] = sum;
+      gram[j*size + i] = sum;
+    }
+  }
+  std::vector<double> lambda(size);
+  std::vector<double> eigenvectors(size*size);
+  jacobi_eigen(size, gram.data(), lambda.data(), eigenvectors.data());
+
+  std::vector<int> order(size);
+  for (int i = 0; i < size; i++) {
+    order[i] = i;
+  }
+  std::sort(order.begin(), order.end(), [&lambda](int a, int b) {return lambda[a] > lambda[b];});
+  double total = 0.;
+  for (int i = 0; i < size; i++) {
+    total += std::max(lambda[i], 0.);
+  }
+  pca_size_ = 0;
+  double remaining = total;
+  while ((pca_size_ < std::min(pca_size_max, size)) && (remaining > pca_tolerance*total) && (lambda[order[pca_size_]] > 1.e-14*lambda[order[0]])) {
+    remaining -= lambda[order[pca_size_]];
+    pca_size_++;
+  }
+  class_test(pca_size_ == 0,
+             error_message_,
+             "the spectra do not vary in the surrogate box");
+
+  /** - basis vectors in feature space and the coefficients of each design point */
+  pca_basis_.assign(pca_size_*feature_size_, 0.);
+  std::vector<double> pca_coefficients(size*pca_size_);
+  for (int index_pca = 0; index_pca < pca_size_; index_pca++) {
+    int index_eigen = order[index_pca];
+    double sqrt_lambda = sqrt(lambda[index_eigen]);
+    for (int i = 0; i < size; i++) {
+      double v = eigenvectors[i*size + index_eigen];
+      pca_coefficients[i*pca_size_ + index_pca] = sqrt_lambda*v;
+      for (int index_f = 0; index_f < feature_size_; index_f++) {
+        pca_basis_[index_pca*feature_size_ + index_f] += v*features[i*feature_size_ + index_f]/sqrt_lambda;
+      }
+    }
+  }
+
+  /** - least-squares fit of the coefficients for the expansions of order order_ and order_ - 1 */
+  for (int index_order = 0; index_order < 2; index_order++) {
+    int terms = (index_order == 0) ? term_size_ : term_size_low_;
+    std::vector<double> design_matrix(size*terms);
+    std::vector<double> basis(term_size_);
+    for (int i = 0; i < size; i++) {
+      surrogate_chebyshev_basis(x + i*parameter_size, basis.data());
+      std::copy(basis.begin(), basis.begin() + terms, design_matrix.begin() + i*terms);
+    }
+    std::vector<double> rhs = pca_coefficients;
+    std::vector<double> solution(terms*pca_size_);
+    class_call(least_squares(size, terms, design_matrix.data(), pca_size_, rhs.data(), solution.data(), error_message_),
+               error_message_,
+               error_message_);
+    std::vector<double>& coefficients = (index_order == 0) ? coefficients_ : coefficients_low_;
+    coefficients.resize(pca_size_*terms);
+    for (int index_pca = 0; index_pca < pca_size_; index_pca++) {
+      for (int index_term = 0; index_term < terms; index_term++) {
+        coefficients[index_pca*terms + index_term] = solution[index_term*pca_size_ + index_pca];
+      }
+    }
+  }
+
+  return _SUCCESS_;
+}
+
+/**
+ * Products of Chebyshev polynomials for all terms of the expansion.
+ */
+
+void SurrogateModel::surrogate_chebyshev_basis(const double* x, double* basis) const {
+
+  int parameter_size = parameter_names_.size();
+  std::vector<double> chebyshev(parameter_size*(order_ + 1));
+
+  for (int index_p = 0; index_p < parameter_size; index_p++) {
+    double* T = &chebyshev[index_p*(order_ + 1)];
+    T[0] = 1.;
+    if (order_ > 0) {
+      T[1] = x[index_p];
+    }
+    for (int n = 2; n <= order_; n++) {
+      T[n] = 2.*x[index_p]*T[n - 1] - T[n - 2];
+    }
+  }
+  for (int index_term = 0; index_term < term_size_; index_term++) {
+    basis[index_term] = 1.;
+    for (int index_p = 0; index_p < parameter_size; index_p++) {
+      basis[index_term] *= chebyshev[index_p*(order_ + 1) + multi_index_[index_term*parameter_size + index_p]];
+    }
+  }
+}
+
+/**
+ * Transformed features (logarithm where is_log_) predicted at the
+ * rescaled point x by the expansion of the given order (order_ or order_ - 1).
+ */
+
+int SurrogateModel::surrogate_predict(const double* x, int order, double* features) const {
+
+  class_test((order != order_) && (order != order_ - 1),
+             error_message_,
+             "the surrogate only has expansions of order %d and %d", order_, order_ - 1);
+
+  int terms = (order == order_) ? term_size_ : term_size_low_;
+  const std::vector<double>& coefficients = (order == order_) ? coefficients_ : coefficients_low_;
+  std::vector<double> basis(term_size_);
+  std::vector<double> amplitude(pca_size_, 0.);
+
+  surrogate_chebyshev_basis(x, basis.data());
+  for (int index_pca = 0; index_pca < pca_size_; index_pca++) {
+    for (int index_term = 0; index_term < terms; index_term++) {
+      amplitude[index_pca] += coefficients[index_pca*terms + index_term]*basis[index_term];
+    }
+  }
+  for (int index_f = 0; index_f < feature_size_; index_f++) {
+    double sum = 0.;
+    for (int index_pca = 0; index_pca < pca_size_; index_pca++) {
+      sum += amplitude[index_pca]*pca_basis_[index_pca*feature_size_ + index_f];
+    }
+    features[index_f] = mean_[index_f] + scale_[index_f]*sum;
+  }
+
+  return _SUCCESS_;
+}
+
+/**
+ * Largest difference between two sets of transformed features (see
+ * surrogate_set_transforms()). For the Cl's it is the difference of the
+ * spectra relative to the largest value of their block in the training
+ * runs. For P(k,z) fitted in log it is the relative difference.
+ */
+
+double SurrogateModel::surrogate_error(const double* features1, const double* features2) const {
+  double error = 0.;
+  for (int index_f = 0; index_f < feature_size_; index_f++) {
+    double difference;
+    if ((index_f < cl_feature_size_) && (is_log_[index_f] == _TRUE_)) {
+      difference = fabs(exp(features1[index_f]) - exp(features2[index_f]));
+    }
+    else {
+      difference = fabs(features1[index_f] - features2[index_f]);
+    }
+    error = std::max(error, difference/norm_[index_f]);
+  }
+  return error;
+}
+
+int SurrogateModel::surrogate_write(const std::string& filename) const {
+
+  FILE* file = fopen(filename.c_str(), "wb");
+  class_test(file == NULL,
+             error_message_,
+             "could not open '%s' for writing", filename.c_str());
+
+  fwrite(surrogate_file_tag, sizeof(char), 16, file);
+  fwrite(&surrogate_file_version, sizeof(int), 1, file);
+  write_strings(file, parameter_names_);
+  write_vector(file, parameter_min_);
+  write_vector(file, parameter_max_);
+  write_strings(file, base_names_);
+  write_strings(file, base_values_);
+
+  int integers[] = {order_, term_size_, term_size_low_, l_max_, has_lensed_cls_, pk_is_nonlinear_, feature_size_, cl_feature_size_, pca_size_};
+  double doubles[] = {error_tolerance_, error_calibration_, validation_error_};
+  fwrite(integers, sizeof(int), sizeof(integers)/sizeof(int), file);
+  fwrite(doubles, sizeof(double), sizeof(doubles)/sizeof(double), file);
+
+  write_vector(file, multi_index_);
+  write_strings(file, cl_names_);
+  write_vector(file, ln_k_);
+  write_vector(file, z_);
+  write_vector(file, is_log_);
+  write_vector(file, mean_);
+  write_vector(file, scale_);
+  write_vector(file, norm_);
+  write_vector(file, pca_basis_);
+  write_vector(file, coefficients_);
+  write_vector(file, coefficients_low_);
+
+  int write_error = ferror(file);
+  if (fclose(file) != 0) {
+    write_error = 1;
+  }
+  class_test(write_error != 0,
+             error_message_,
+             "could not write surrogate to '%s'", filename.c_str());
+
+  return _SUCCESS_;
+}
+
+int SurrogateModel::surrogate_read(const std::string& filename) {
+
+  char tag[16];
+  int version;
+  int integers[9];
+  double doubles[3];
+
+  FILE* file = fopen(filename.c_str(), "rb");
+  class_test(file == NULL,
+             error_message_,
+             "could not open surrogate file '%s'", filename.c_str());
+
+  bool ok = (fread(tag, sizeof(char), 16, file) == 16) && (memcmp(tag, surrogate_file_tag, 16) == 0);
+  ok = ok && (fread(&version, sizeof(int), 1, file) == 1) && (version == surrogate_file_version);
+  ok = ok && read_strings(file, parameter_names_);
+  ok = ok && read_vector(file, parameter_min_);
+  ok = ok && read_vector(file, parameter_max_);
+  ok = ok && read_strings(file, base_names_);
+  ok = ok && read_strings(file, base_values_);
+  ok = ok && (fread(integers, sizeof(int), 9, file) == 9);
+  ok = ok && (fread(doubles, sizeof(double), 3, file) == 3);
+  ok = ok && read_vector(file, multi_index_);
+  ok = ok && read_strings(file, cl_names_);
+  ok = ok && read_vector(file, ln_k_);
+  ok = ok && read_vector(file, z_);
+  ok = ok && read_vector(file, is_log_);
+  ok = ok && read_vector(file, mean_);
+  ok = ok && read_vector(file, scale_);
+  ok = ok && read_vector(file, norm_);
+  ok = ok && read_vector(file, pca_basis_);
+  ok = ok && read_vector(file, coefficients_);
+  ok = ok && read_vector(file, coefficients_low_);
+  fclose(file);
+  class_test(!ok,
+             error_message_,
+             "'%s' is not a valid surrogate file (version %d)", filename.c_str(), surrogate_file_version);
+
+  order_ = integers[0];
+  term_size_ = integers[1];
+  term_size_low_ = integers[2];
+  l_max_ = integers[3];
+  has_lensed_cls_ = integers[4];
+  pk_is_nonlinear_ = integers[5];
+  feature_size_ = integers[6];
+  cl_feature_size_ = integers[7];
+  pca_size_ = integers[8];
+  error_tolerance_ = doubles[0];
+  error_calibration_ = doubles[1];
+  validation_error_ = doubles[2];
+
+  class_test((parameter_min_.size() != parameter_names_.size()) ||
+             (parameter_max_.size() != parameter_names_.size()) ||
+             (base_values_.size() != base_names_.size()) ||
+             ((int)multi_index_.size() != term_size_*(int)parameter_names_.size()) ||
+             ((int)pca_basis_.size() != pca_size_*feature_size_) ||
+             ((int)coefficients_.size() != pca_size_*term_size_) ||
+             ((int)coefficients_low_.size() != pca_size_*term_size_low_) ||
+             (feature_size_ != cl_feature_size_ + (int)(ln_k_.size()*z_.size())),
+             error_message_,
+             "inconsistent sizes in surrogate file '%s'", filename.c_str());
+
+  return _SUCCESS_;
+}
+
+/**
+ * Evaluate the model at the point given in fc, or run the full solver if
+ * the model does not cover it.
+ *
+ * The varied parameters default to the centre of the box. Any other
+ * parameter must be absent from fc or have the value used in training,
+ * otherwise the point is not covered. surrogate_error_tolerance overrides
+ * the tolerance stored in the model.
+ */
+
+SurrogateCosmology::SurrogateCosmology(SurrogateModelPtr model, FileContent& fc)
+: is_emulated_(false)
+, error_estimate_(0.)
+, l_max_(model->l_max_)
+, model_(std::move(model)) {
+  if (surrogate_init(fc) != _SUCCESS_) {
+    throw std::runtime_error(error_message_);
+  }
+}
+
+int SurrogateCosmology::surrogate_init(FileContent& fc) {
+
+  int flag;
+  int parameter_size = model_->parameter_names_.size();
+  double tolerance = model_->error_tolerance_;
+  std::vector<double> x(parameter_size);
+  bool is_covered = true;
+
+  class_call(parser_read_double(&fc, "surrogate_error_tolerance", &tolerance, &flag, error_message_),
+             error_message_,
+             error_message_);
+
+  /** - rescale the varied parameters to the box */
+  for (int index_p = 0; index_p < parameter_size; index_p++) {
+    double value = 0.5*(model_->parameter_min_[index_p] + model_->parameter_max_[index_p]);
+    class_call(parser_read_double(&fc, (char*)model_->parameter_names_[index_p].c_str(), &value, &flag, error_message_),
+               error_message_,
+               error_message_);
+    x[index_p] = (2.*value - model_->parameter_min_[index_p] - model_->parameter_max_[index_p])/(model_->parameter_max_[index_p] - model_->parameter_min_[index_p]);
+    if (fabs(x[index_p]) > 1.) {
+      is_covered = false;
+    }
+  }
+
+  /** - any other parameter must have its training value */
+  for (int i = 0; i < fc.size; i++) {
+    if (fc.read[i] == _TRUE_) {
+      continue;
+    }
+    if (is_surrogate_parameter(fc.name[i])) {
+      fc.read[i] = _TRUE_;
+      continue;
+    }
+    auto it = std::find(model_->base_names_.begin(), model_->base_names_.end(), std::string(fc.name[i]));
+    if ((it != model_->base_names_.end()) && (model_->base_values_[it - model_->base_names_.begin()] == trim(fc.value[i]))) {
+      fc.read[i] = _TRUE_;
+    }
+    else {
+      is_covered = false;
+    }
+  }
+
+  /** - evaluate the model and its error estimate */
+  if (is_covered) {
+    features_.resize(model_->feature_size_);
+    std::vector<double> features_low(model_->feature_size_);
+    class_call(model_->surrogate_predict(x.data(), model_->order_, features_.data()),
+               model_->error_message_,
+               error_message_);
+    class_call(model_->surrogate_predict(x.data(), model_->order_ - 1, features_low.data()),
+               model_->error_message_,
+               error_message_);
+    error_estimate_ = model_->error_calibration_*model_->surrogate_error(features_.data(), features_low.data());
+    is_emulated_ = (error_estimate_ <= tolerance);
+  }
+
+  if (is_emulated_) {
+    /** - spline ln(P) in ln(k) for all redshifts */
+    int k_size = model_->ln_k_.size();
+    int z_size = model_->z_.size();
+    if (k_size > 0) {
+      ln_pk_.resize(k_size*z_size);
+      ddln_pk_.resize(k_size*z_size);
+      for (int index = 0; index < k_size*z_size; index++) {
+        int index_f = model_->cl_feature_size_ + index;
+        ln_pk_[index] = (model_->is_log_[index_f] == _TRUE_) ? features_[index_f] : log(std::max(features_[index_f], 1.e-300));
+      }
+      class_call(array_spline_table_lines(const_cast<double*>(model_->ln_k_.data()), k_size, ln_pk_.data(), z_size, ddln_pk_.data(), _SPLINE_EST_DERIV_, error_message_),
+                 error_message_,
+                 error_message_);
+    }
+    return _SUCCESS_;
+  }
+
+  /** - otherwise run the solver on the fixed parameters overridden by fc */
+  std::vector<std::string> names;
+  std::vector<std::string> values;
+  std::vector<int> index_in_fc;
+  for (int i = 0; i < fc.size; i++) {
+    if (!is_surrogate_parameter(fc.name[i])) {
+      names.push_back(fc.name[i]);
+      values.push_back(fc.value[i]);
+      index_in_fc.push_back(i);
+    }
+  }
+  for (int index_p = 0; index_p < parameter_size; index_p++) {
+    if (std::find(names.begin(), names.end(), model_->parameter_names_[index_p]) == names.end()) {
+      char value[_ARGUMENT_LENGTH_MAX_];
+      sprintf(value, "%.17g", 0.5*(model_->parameter_min_[index_p] + model_->parameter_max_[index_p]));
+      names.push_back(model_->parameter_names_[index_p]);
+      values.push_back(value);
+    }
+  }
+  int base_size = model_->base_names_.size();
+  for (int index_b = 0; index_b < base_size; index_b++) {
+    if (std::find(names.begin(), names.end(), model_->base_names_[index_b]) == names.end()) {
+      names.push_back(model_->base_names_[index_b]);
+      values.push_back(model_->base_values_[index_b]);
+    }
+  }
+
+  FileContent fc_full;
+  class_call(file_content_from_entries(names, values, fc_full, error_message_),
+             error_message_,
+             error_message_);
+  try {
+    cosmology_.reset(new Cosmology(fc_full));
+    if (model_->l_max_ > 0) {
+      l_max_ = (model_->has_lensed_cls_ == _TRUE_) ? cosmology_->GetLensingModule()->l_lensed_max_ : cosmology_->GetSpectraModule()->l_max_tot_;
+    }
+    if (!model_->ln_k_.empty()) {
+      cosmology_->GetNonlinearModule();
+    }
+  }
+  catch (std::exception& e) {
+    class_stop(error_message_, "%s", e.what());
+  }
+
+  /** - report the parameters understood by the full run as read */
+  int index_size = index_in_fc.size();
+  for (int index = 0; index < index_size; index++) {
+    fc.read[index_in_fc[index]] = fc_full.read[index];
+  }
+
+  return _SUCCESS_;
+}
+
+std::map<std::string, std::vector<double>> SurrogateCosmology::cl_output(int lmax) const {
+
+  ThrowRuntimeErrorIf(model_->l_max_ == 0, "Error: the surrogate has no Cl's\n");
+  ThrowRuntimeErrorIf((lmax > l_max_) || (lmax < 0), "Error: lmax = %d is outside the allowed range [0, %d]\n", lmax, l_max_);
+
+  if (!is_emulated_) {
+    if (model_->has_lensed_cls_ == _TRUE_) {
+      return cosmology_->GetLensingModule()->cl_output(lmax);
+    }
+    return cosmology_->GetSpectraModule()->cl_output(lmax);
+  }
+
+  std::map<std::string, std::vector<double>> output;
+  int ct_size = model_->cl_names_.size();
+  for (int index_ct = 0; index_ct < ct_size; index_ct++) {
+    std::vector<double>& cl = output[model_->cl_names_[index_ct]];
+    cl.assign(lmax + 1, 0.);
+    for (int l = 2; l <= lmax; l++) {
+      int index_f = index_ct*(model_->l_max_ - 1) + l - 2;
+      cl[l] = (model_->is_log_[index_f] == _TRUE_) ? exp(features_[index_f]) : features_[index_f];
+    }
+  }
+  return output;
+}
+
+int SurrogateCosmology::pk_at_k_and_z(double k, double z, double* pk) const {
+  return pk_at_k_and_z(k, z, pk, error_message_);
+}
+
+/**
+ * Total matter power spectrum (non-linear if the model was trained with a
+ * non-linear method) at wavenumber k in 1/Mpc and redshift z, in Mpc^3.
+ *
+ * @param k              Input: wavenumber in 1/Mpc
+ * @param z              Input: redshift
+ * @param pk             Output: P(k,z)
+ * @param error_message  Output: error message, see "Concurrent queries" in base_module.h
+ * @return the error status
+ */
+
+int SurrogateCosmology::pk_at_k_and_z(double k, double z, double* pk, ErrorMsg error_message) const {
+
+  class_test(model_->ln_k_.empty(),
+             error_message,
+             "the surrogate has no matter power spectrum");
+
+  if (!is_emulated_) {
+    NonlinearModulePtr& nonlinear_module = cosmology_->GetNonlinearModule();
+    std::vector<double> workspace(nonlinear_module->nonlinear_pk_at_k_and_z_workspace_size());
+    enum pk_outputs pk_output = (model_->pk_is_nonlinear_ == _TRUE_) ? pk_nonlinear : pk_linear;
+    class_call(nonlinear_module->nonlinear_pk_at_k_and_z(pk_output, k, z, nonlinear_module->index_pk_m_, pk, NULL, workspace.data(), error_message),
+               error_message,
+               error_message);
+    return _SUCCESS_;
+  }
+
+  int k_size = model_->ln_k_.size();
+  int z_size = model_->z_.size();
+  double ln_k = log(k);
+  class_test((k <= 0.) || (ln_k < model_->ln_k_[0]) || (ln_k > model_->ln_k_[k_size - 1]),
+             error_message,
+             "k = %e is outside the surrogate range [%e, %e]", k, exp(model_->ln_k_[0]), exp(model_->ln_k_[k_size - 1]));
+  class_test((z < model_->z_[0]) || (z > model_->z_[z_size - 1]),
+             error_message,
+             "z = %e is outside the surrogate range [%e, %e]", z, model_->z_[0], model_->z_[z_size - 1]);
+
+  std::vector<double> ln_pk_at_z(z_size);
+  int last_index;
+  class_call(array_interpolate_spline(const_cast<double*>(model_->ln_k_.data()), k_size, const_cast<double*>(ln_pk_.data()), const_cast<double*>(ddln_pk_.data()), z_size,
+                                      ln_k, &last_index, ln_pk_at_z.data(), z_size, error_message),
+             error_message,
+             error_message);
+
+  if (z_size == 1) {
+    *pk = exp(ln_pk_at_z[0]);
+    return _SUCCESS_;
+  }
+
+  std::vector<double> ddln_pk_at_z(z_size);
+  double ln_pk;
+  class_call(array_spline_table_lines(const_cast<double*>(model_->z_.data()), z_size, ln_pk_at_z.data(), 1, ddln_pk_at_z.data(), _SPLINE_EST_DERIV_, error_message),
+             error_message,
+             error_message);
+  class_call(array_interpolate_spline(const_cast<double*>(model_->z_.data()), z_size, ln_pk_at_z.data(), ddln_pk_at_z.data(), 1,
+                                      z, &last_index, &ln_pk, 1, error_message),
+             error_message,
+             error_message);
+  *pk = exp(ln_pk);
+
+  return _SUCCESS_;
+}
@@ -0,0 +1,126 @@
+#ifndef SURROGATE_H
+#define SURROGATE_H
+
+#include "cosmology.h"
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * Surrogate (emulator) mode:
+ *
+ * A SurrogateModel is trained once on a box in a few input parameters. The
+ * solver is run through the usual Cosmology pipeline on a Latin hypercube
+ * design; the resulting \f$ \ln C_l \f$'s and \f$ \ln P(k,z) \f$ are
+ * compressed by a principal component analysis, and each principal
+ * component is fitted by a total-degree Chebyshev expansion in the
+ * rescaled parameters. The model is stored in a binary file.
+ *
+ * A SurrogateCosmology evaluates the model at one point of parameter space
+ * and serves the spectra through the same accessors as the SpectraModule
+ * (cl_output()) and the NonlinearModule (pk_at_k_and_z()). It falls back
+ * to a full Cosmology run when the point lies outside the trained box, when
+ * it changes a parameter that was held fixed during training, or when the
+ * estimated error is above surrogate_error_tolerance.
+ *
+ * The error estimate is the difference between the expansions of order
+ * surrogate_order and surrogate_order - 1, calibrated against a set of
+ * validation runs that were not used in the fit.
+ */
+
+class SurrogateModel;
+typedef std::shared_ptr<const SurrogateModel> SurrogateModelPtr;
+
+class SurrogateModel {
+public:
+  /* train from the parameters in fc (see explanatory.ini, surrogate_*) */
+  SurrogateModel(FileContent& fc);
+  /* read a model written by surrogate_write() */
+  SurrogateModel(const std::string& filename);
+
+  int surrogate_write(const std::string& filename) const;
+  static bool surrogate_training_requested(FileContent& fc);
+
+  std::vector<std::string> parameter_names_;  /**< names of the varied input parameters */
+  std::vector<double> parameter_min_;         /**< lower edge of the trained box */
+  std::vector<double> parameter_max_;         /**< upper edge of the trained box */
+
+  std::vector<std::string> base_names_;       /**< names of all other input parameters, held fixed */
+  std::vector<std::string> base_values_;      /**< their values */
+
+  int l_max_;                                 /**< largest multipole in the model (0 if no Cl's) */
+  std::vector<std::string> cl_names_;         /**< Cl types, as returned by SpectraModule::cl_output() */
+  short has_lensed_cls_;                      /**< are the Cl's lensed? */
+
+  std::vector<double> ln_k_;                  /**< ln(k) grid of the power spectrum (1/Mpc) */
+  std::vector<double> z_;                     /**< redshift grid of the power spectrum */
+  short pk_is_nonlinear_;                     /**< is P(k,z) the non-linear spectrum? */
+
+  double error_tolerance_;                    /**< default tolerance on the error estimate */
+  double error_calibration_;                  /**< ratio of true error to error indicator on the validation set */
+  double validation_error_;                   /**< largest error found on the validation set */
+
+private:
+  friend class SurrogateCosmology;
+
+  int surrogate_train(FileContent& fc);
+  int surrogate_read(const std::string& filename);
+  int surrogate_read_settings(FileContent& fc, int* design_size, int* validation_size, int* pca_size_max, double* pca_tolerance, int* seed, int* verbose);
+  int surrogate_k_range(FileContent& fc, double* k_min, double* k_max);
+  int surrogate_set_grids(FileContent& fc, Cosmology& cosmology, double k_min, double k_max);
+  int surrogate_file_content(const double* x, FileContent& fc_point) const;
+  int surrogate_run(const double* x, std::vector<double>& features);
+  int surrogate_extract_features(Cosmology& cosmology, std::vector<double>& features) const;
+  int surrogate_latin_hypercube(int size, int seed, std::vector<double>& x) const;
+  int surrogate_set_transforms(const std::vector<double>& features_design, const std::vector<double>& features_validation);
+  int surrogate_fit(int size, const double* x, std::vector<double>& features, int pca_size_max, double pca_tolerance);
+  int surrogate_predict(const double* x, int order, double* features) const;
+  double surrogate_error(const double* features1, const double* features2) const;
+  void surrogate_chebyshev_basis(const double* x, double* basis) const;
+
+  int order_;                                 /**< total degree of the Chebyshev expansion */
+  std::vector<int> multi_index_;              /**< multi_index_[index_term*parameter_size + index_p] = degree in parameter index_p */
+  int term_size_;                             /**< number of terms of total degree <= order_ */
+  int term_size_low_;                         /**< number of terms of total degree <= order_ - 1 */
+
+  int feature_size_;                          /**< number of fitted values (Cl's, then P(k,z)) */
+  int cl_feature_size_;                       /**< number of Cl values among them */
+  std::vector<short> is_log_;                 /**< is the feature fitted in log? */
+  std::vector<double> mean_;                  /**< mean of each transformed feature */
+  std::vector<double> scale_;                 /**< standard deviation of each transformed feature */
+  std::vector<double> norm_;                  /**< normalisation of differences in the error estimate (largest absolute value of the block, for linear features) */
+
+  int pca_size_;                              /**< number of principal components kept */
+  std::vector<double> pca_basis_;             /**< pca_basis_[index_pca*feature_size_ + index_f] */
+  std::vector<double> coefficients_;          /**< coefficients_[index_pca*term_size_ + index_term] */
+  std::vector<double> coefficients_low_;      /**< same for the expansion of order order_ - 1 */
+
+  mutable ErrorMsg error_message_;
+};
+
+class SurrogateCosmology {
+public:
+  SurrogateCosmology(SurrogateModelPtr model, FileContent& fc);
+
+  std::map<std::string, std::vector<double>> cl_output(int lmax) const;
+  int pk_at_k_and_z(double k, double z, double* pk) const;
+  int pk_at_k_and_z(double k, double z, double* pk, ErrorMsg error_message) const;
+
+  bool is_emulated_;                          /**< true if the spectra come from the model, false after a fallback run */
+  double error_estimate_;                     /**< estimated error of the model at this point */
+  int l_max_;                                 /**< largest multipole available from cl_output() */
+  mutable ErrorMsg error_message_;
+
+private:
+  int surrogate_init(FileContent& fc);
+
+  SurrogateModelPtr model_;
+  std::unique_ptr<Cosmology> cosmology_;      /**< full run, only in case of fallback */
+  std::vector<double> features_;              /**< predicted features */
+  std::vector<double> ln_pk_;                 /**< ln_pk_[index_k*z_size + index_z] */
+  std::vector<double> ddln_pk_;               /**< second derivative of ln_pk_ with respect to ln(k) */
+};
+
+#endif //SURROGATE_H
@@ -110,10 +110,11 @@ int ThermodynamicsModule::thermodynamics_derivs_with_recfast(double z, double* y
  * @param last_index Input/Output: index of the previous/current point in the interpolation array (input only for closeby mode, output for both)
  * @param pvecback   Input: vector of background quantities (used only in case z>z_initial for getting ddkappa and dddkappa; in that case, should be already allocated and filled, with format short_info or larger; in other cases, will be ignored)
  * @param pvecthermo Output: vector of thermodynamics quantities (assumed to be already allocated)
+ * @param error_message Output: error message, owned by the caller (see "Concurrent queries" in base_module.h)
  * @return the error status
  */
 
-int ThermodynamicsModule::thermodynamics_at_z(double z, short inter_mode, int* last_index, double* pvecback, double* pvecthermo) const {
+int ThermodynamicsModule::thermodynamics_at_z(double z, short inter_mode, int* last_index, double* pvecback, double* pvecthermo, ErrorMsg error_message) const {
 
   /** Summary: */
 
@@ -239,9 +240,9 @@ int ThermodynamicsModule::thermodynamics_at_z(double z, short inter_mode, int* l
                                           last_index,
                                           pvecthermo,
                                           th_size_,
-                                          error_message_),
-                 error_message_,
-                 error_message_);
+                                          error_message),
+                 error_message,
+                 error_message);
     }
 
     /* in the "normal" case, use spline interpolation */
@@ -259,9 +260,9 @@ int ThermodynamicsModule::thermodynamics_at_z(double z, short inter_mode, int* l
                                             last_index,
                                             pvecthermo,
                                             th_size_,
-                                            error_message_),
-                   error_message_,
-                   error_message_);
+                                            error_message),
+                   error_message,
+                   error_message);
       }
 
       if (inter_mode == inter_closeby_) {
@@ -276,9 +277,9 @@ int ThermodynamicsModule::thermodynamics_at_z(double z, short inter_mode, int* l
                                                             last_index,
                                                             pvecthermo,
                                                             th_size_,
-                                                            error_message_),
-                   error_message_,
-                   error_message_);
+                                                            error_message),
+                   error_message,
+                   error_message);
 
       }
     }
@@ -286,6 +287,10 @@ int ThermodynamicsModule::thermodynamics_at_z(double z, short inter_mode, int* l
   return _SUCCESS_;
 }
 
+int ThermodynamicsModule::thermodynamics_at_z(double z, short inter_mode, int* last_index, double* pvecback, double* pvecthermo) const {
+  return thermodynamics_at_z(z, inter_mode, last_index, pvecback, pvecthermo, error_message_);
+}
+
 /**
  * Initialize the thermo structure, and in particular the
  * thermodynamics interpolation table.
@@ -327,6 +332,8 @@ int ThermodynamicsModule::thermodynamics_init() {
   double tau,tau_ini;
   double g_max;
   int index_tau_max;
+  /* spacing and variation of g around its maximum */
+  double dz_below, dz_above, dg_below, dg_above;
   double dkappa_ini;
 
   double z_idm_dr, z_idr, tau_idm_dr, tau_idr, Gamma_heat_idm_dr, dTdz_idm_dr, T_idm_dr, z, T_idr, dz, T_adia, z_adia;
@@ -1022,11 +1029,14 @@ int ThermodynamicsModule::thermodynamics_init() {
   g_max = thermodynamics_table_[index_tau*th_size_ + index_th_g_];
   index_tau_max = index_tau;
 
-  /* approximation for maximum of g, using cubic interpolation, assuming equally spaced z's */
-  z_rec_ = z_table_[index_tau + 1] + 0.5*(z_table_[index_tau + 1] - z_table_[index_tau])
-    *(thermodynamics_table_[(index_tau)*th_size_ + index_th_g_] - 1.*thermodynamics_table_[(index_tau + 2)*th_size_ + index_th_g_])
-    /(thermodynamics_table_[(index_tau)*th_size_ + index_th_g_] - 2.*thermodynamics_table_[(index_tau + 1)*th_size_ + index_th_g_]
-      + thermodynamics_table_[(index_tau + 2)*th_size_ + index_th_g_]);
+  /* approximation for maximum of g, using quadratic interpolation
+     through three lines (not necessarily equally spaced in z, since
+     the recombination table can be sampled adaptively) */
+  dz_below = z_table_[index_tau + 1] - z_table_[index_tau];
+  dz_above = z_table_[index_tau + 2] - z_table_[index_tau + 1];
+  dg_below = thermodynamics_table_[(index_tau)*th_size_ + index_th_g_] - thermodynamics_table_[(index_tau + 1)*th_size_ + index_th_g_];
+  dg_above = thermodynamics_table_[(index_tau + 2)*th_size_ + index_th_g_] - thermodynamics_table_[(index_tau + 1)*th_size_ + index_th_g_];
+  z_rec_ = z_table_[index_tau + 1] + 0.5*(dg_below*dz_above*dz_above - dg_above*dz_below*dz_below)/(dg_below*dz_above + dg_above*dz_below);
 
   class_test(z_rec_ + ppr->smallest_allowed_variation >= _Z_REC_MAX_,
              error_message_,
@@ -2735,7 +2745,7 @@ int ThermodynamicsModule::thermodynamics_reionization_sample(recombination* prec
   i=0;
   while (preco->recombination_table[i*preco->re_size+preco->index_re_z] < preio->reionization_parameters[preio->index_reio_start]) {
     i++;
-    class_test(i == ppr->recfast_Nz0,
+    class_test(i == preco->rt_size,
                error_message_,
                "reionization_z_start_max = %e > largest redshift in thermodynamics table",ppr->reionization_z_start_max);
   }
@@ -2798,9 +2808,10 @@ int ThermodynamicsModule::thermodynamics_reionization_sample(recombination* prec
 
   number_of_redshifts=1;
 
-  /** - (d) set the maximum step value (equal to the step in thermodynamics table) */
-  dz_max=preco->recombination_table[i*preco->re_size+preco->index_re_z]
-    -preco->recombination_table[(i-1)*preco->re_size+preco->index_re_z];
+  /** - (d) set the maximum step value (equal to the step of the grid of
+        the recombination table, whose lines may be further apart when
+        it is sampled adaptively) */
+  dz_max=ppr->recfast_z_initial/ppr->recfast_Nz0;
 
   /** - (e) loop over redshift values in order to find values of z, x_e, kappa' (Tb and cb2 found later by integration). The sampling in z space is found here. */
 
@@ -3065,6 +3076,9 @@ int ThermodynamicsModule::thermodynamics_recombination_with_hyrec(recombination*
   double *xe_output, *Tm_output;
   int i,j,l,Nz,b;
   double z, xe, Tm, Hz;
+  /* adaptive sampling, see thermodynamics_recombination_with_recfast() */
+  int steps=1,steps_next=1,number_of_lines=0,index_z;
+  double dkappadz,dkappadz_previous=0.,xe_previous=0.;
   FILE *fA;
   FILE *fR;
   double L2s1s_current;
@@ -3224,11 +3238,14 @@ int ThermodynamicsModule::thermodynamics_recombination_with_hyrec(recombination*
 
   class_alloc(preco->recombination_table, preco->re_size*preco->rt_size*sizeof(double), error_message_);
 
-  for(i=0; i <Nz; i++) {
+  for(i=0; i <Nz; i+=steps) {
+
+    steps = MIN(steps_next, Nz-i);
+    index_z = Nz-number_of_lines-1;
 
     /** - --> get redshift, corresponding results from hyrec, and background quantities */
 
-    z = param.zstart * (1. - (double)(i+1) / (double)Nz);
+    z = param.zstart * (1. - (double)(i+steps) / (double)Nz);
 
     /* get (xe,Tm) by interpolating in pre-computed tables */
 
@@ -3279,30 +3296,54 @@ int ThermodynamicsModule::thermodynamics_recombination_with_hyrec(recombination*
     /* results are obtained in order of decreasing z, and stored in order of growing z */
 
     /* redshift */
-    *(preco->recombination_table+(Nz-i-1)*preco->re_size+preco->index_re_z)=z;
+    *(preco->recombination_table+index_z*preco->re_size+preco->index_re_z)=z;
 
     /* ionization fraction */
-    *(preco->recombination_table+(Nz-i-1)*preco->re_size+preco->index_re_xe)=xe;
+    *(preco->recombination_table+index_z*preco->re_size+preco->index_re_xe)=xe;
 
     /* Tb */
-    *(preco->recombination_table+(Nz-i-1)*preco->re_size+preco->index_re_Tb)=Tm;
+    *(preco->recombination_table+index_z*preco->re_size+preco->index_re_Tb)=Tm;
 
     /* wb = (k_B/mu) Tb */
-    *(preco->recombination_table+(Nz-i-1)*preco->re_size+preco->index_re_wb)
+    *(preco->recombination_table+index_z*preco->re_size+preco->index_re_wb)
       = _k_B_/(_c_*_c_*_m_H_)*(1. + (1./_not4_ - 1.)*YHe_ + xe*(1. - YHe_))*Tm;
 
     /* cb2 = (k_B/mu) Tb (1-1/3 dlnTb/dlna) = (k_B/mu) Tb (1+1/3 (1+z) dlnTb/dz)
        with (1+z)dlnTb/dz= - [dlnTb/dlna] */
-    *(preco->recombination_table+(Nz-i-1)*preco->re_size+preco->index_re_cb2)
-      = *(preco->recombination_table+(Nz-i-1)*preco->re_size+preco->index_re_wb)
+    *(preco->recombination_table+index_z*preco->re_size+preco->index_re_cb2)
+      = *(preco->recombination_table+index_z*preco->re_size+preco->index_re_wb)
       * (1. - rec_dTmdlna(xe, Tm, pba->T_cmb*(1.+z), Hz, param.fHe, param.nH0*pow((1+z),3)*1e-6, energy_injection_rate(&param,z)) / Tm / 3.);
 
     /* dkappa/dtau = a n_e x_e sigma_T = a^{-2} n_e(today) x_e sigma_T (in units of 1/Mpc) */
-    *(preco->recombination_table+(Nz-i-1)*preco->re_size+preco->index_re_dkappadtau)
+    *(preco->recombination_table+index_z*preco->re_size+preco->index_re_dkappadtau)
       = (1.+z) * (1.+z) * preco->Nnow * xe * _sigma_ * _Mpc_over_m_;
 
+    /** - --> choose the number of steps covered by the next line */
+    dkappadz = *(preco->recombination_table+index_z*preco->re_size+preco->index_re_dkappadtau)
+      / pvecback[background_module_->index_bg_H_];
+
+    if (number_of_lines > 0) {
+      class_call(thermodynamics_recombination_sampling(param.zstart/(double)Nz,
+                                                       xe_previous,
+                                                       xe,
+                                                       dkappadz_previous,
+                                                       dkappadz,
+                                                       steps,
+                                                       &steps_next),
+                 error_message_,
+                 error_message_);
+    }
+
+    xe_previous = xe;
+    dkappadz_previous = dkappadz;
+    number_of_lines++;
   }
 
+  /** - move the lines to the beginning of the table */
+  class_call(thermodynamics_recombination_shrink_table(preco, number_of_lines),
+             error_message_,
+             error_message_);
+
   /* Cleanup */
 
   free(buffer);
@@ -3317,6 +3358,86 @@ int ThermodynamicsModule::thermodynamics_recombination_with_hyrec(recombination*
   return _SUCCESS_;
 }
 
+/**
+ * Number of steps of the grid of recombination redshifts to be covered
+ * by the next line of the recombination table, given the variation of
+ * x_e and of the opacity dkappa/dz over the current line, which covered
+ * 'steps' steps (see recfast_adaptive_sampling in precisions.h). The
+ * number of steps is scaled by the ratio of the tolerance to the largest
+ * relative variation, with a safety factor, and can at most double from
+ * one line to the next.
+ *
+ * @param dz_grid           Input: redshift step of the grid
+ * @param xe_previous       Input: x_e on the previous line
+ * @param xe                Input: x_e on the current line
+ * @param dkappadz_previous Input: dkappa/dz on the previous line
+ * @param dkappadz          Input: dkappa/dz on the current line
+ * @param steps             Input: number of steps covered by the current line
+ * @param steps_next        Output: number of steps to be covered by the next line
+ * @return the error status
+ */
+
+int ThermodynamicsModule::thermodynamics_recombination_sampling(double dz_grid,
+                                                                double xe_previous,
+                                                                double xe,
+                                                                double dkappadz_previous,
+                                                                double dkappadz,
+                                                                int steps,
+                                                                int* steps_next) {
+
+  double variation;
+  double ratio;
+  int steps_max;
+
+  if (ppr->recfast_adaptive_sampling == _FALSE_) {
+    *steps_next = 1;
+    return _SUCCESS_;
+  }
+
+  class_test((xe_previous == 0.) || (dkappadz_previous == 0.),
+             error_message_,
+             "stop to avoid division by zero");
+
+  /* largest relative variation over the current line, in units of the tolerances */
+  variation = MAX(fabs(xe - xe_previous)/xe_previous/ppr->recfast_sampling_tol_xe,
+                  fabs(dkappadz - dkappadz_previous)/dkappadz_previous/ppr->recfast_sampling_tol_g);
+
+  if (variation > 0.) {
+    ratio = MIN(0.9/variation, 2.);
+  }
+  else {
+    ratio = 2.;
+  }
+
+  steps_max = MAX(1, (int)(ppr->recfast_dz_max/dz_grid));
+
+  *steps_next = MAX(1, MIN(steps_max, (int)(ratio*steps)));
+
+  return _SUCCESS_;
+}
+
+/**
+ * Move the lines of the recombination table, which are filled from the
+ * end in order of decreasing redshift, to the beginning of the table
+ * when the adaptive sampling has left some of them unused.
+ *
+ * @param preco           Input/Output: pointer to recombination structure
+ * @param number_of_lines Input: number of lines filled at the end of the table
+ * @return the error status
+ */
+
+int ThermodynamicsModule::thermodynamics_recombination_shrink_table(recombination* preco, int number_of_lines) {
+
+  if (number_of_lines < preco->rt_size) {
+    memmove(preco->recombination_table,
+            preco->recombination_table + (preco->rt_size - number_of_lines)*preco->re_size,
+            number_of_lines*preco->re_size*sizeof(double));
+    preco->rt_size = number_of_lines;
+  }
+
+  return _SUCCESS_;
+}
+
 /**
  * Integrate thermodynamics with RECFAST.
  *
@@ -3378,6 +3499,12 @@ int ThermodynamicsModule::thermodynamics_recombination_with_recfast(recombinatio
   double zstart,zend,rhs;
   int i,Nz;
 
+  /* adaptive sampling: number of steps of the redshift grid covered by
+     the current line, number of lines, index of the current line in
+     the table, and values on the previous line */
+  int steps=1,steps_next=1,number_of_lines=0,index_z;
+  double dkappadz,dkappadz_previous=0.,x0_line_previous=0.;
+
   /* introduced by JL for smoothing the various steps */
   double x0_previous,x0_new,s,weight;
 
@@ -3487,14 +3614,18 @@ int ThermodynamicsModule::thermodynamics_recombination_with_recfast(recombinatio
   x0 = 1.+2.*preco->fHe;
   y[2] = preco->Tnow*(1.+z);
 
-  /** - loop over redshift steps Nz; integrate over each step with
-      generic_integrator(), store the results in the table using
+  /** - loop over redshift steps Nz, grouped into lines of the table
+      with thermodynamics_recombination_sampling(); integrate over each
+      line with generic_integrator(), store the results in the table using
       thermodynamics_derivs_with_recfast()*/
 
-  for(i=0; i <Nz; i++) {
+  for(i=0; i <Nz; i+=steps) {
+
+    steps = MIN(steps_next, Nz-i);
+    index_z = Nz-number_of_lines-1;
 
     zstart = zinitial * (double)(Nz-i) / (double)Nz;
-    zend   = zinitial * (double)(Nz-i-1) / (double)Nz;
+    zend   = zinitial * (double)(Nz-i-steps) / (double)Nz;
 
     z = zend;
 
@@ -3680,13 +3811,13 @@ int ThermodynamicsModule::thermodynamics_recombination_with_recfast(recombinatio
     /* results are obtained in order of decreasing z, and stored in order of growing z */
 
     /* redshift */
-    *(preco->recombination_table+(Nz-i-1)*preco->re_size+preco->index_re_z)=zend;
+    *(preco->recombination_table+index_z*preco->re_size+preco->index_re_z)=zend;
 
     /* ionization fraction */
-    *(preco->recombination_table+(Nz-i-1)*preco->re_size+preco->index_re_xe)=x0;
+    *(preco->recombination_table+index_z*preco->re_size+preco->index_re_xe)=x0;
 
     /* Tb */
-    *(preco->recombination_table+(Nz-i-1)*preco->re_size+preco->index_re_Tb)=y[2];
+    *(preco->recombination_table+index_z*preco->re_size+preco->index_re_Tb)=y[2];
 
     /* get dTb/dz=dy[2] */
     class_call(thermodynamics_derivs_with_recfast(zend, y, dy, &tpaw, error_message_),
@@ -3694,29 +3825,57 @@ int ThermodynamicsModule::thermodynamics_recombination_with_recfast(recombinatio
                error_message_);
 
     /* wb = (k_B/mu) Tb  = (k_B/mu) Tb */
-    *(preco->recombination_table+(Nz-i-1)*preco->re_size+preco->index_re_wb)
+    *(preco->recombination_table+index_z*preco->re_size+preco->index_re_wb)
       = _k_B_ / ( _c_ * _c_ * _m_H_ ) * (1. + (1./_not4_ - 1.) * preco->YHe + x0 * (1.-preco->YHe)) * y[2];
 
     /* cb2 = (k_B/mu) Tb (1-1/3 dlnTb/dlna) = (k_B/mu) Tb (1+1/3 (1+z) dlnTb/dz) */
-    *(preco->recombination_table+(Nz-i-1)*preco->re_size+preco->index_re_cb2)
-      = *(preco->recombination_table+(Nz-i-1)*preco->re_size+preco->index_re_wb)
+    *(preco->recombination_table+index_z*preco->re_size+preco->index_re_cb2)
+      = *(preco->recombination_table+index_z*preco->re_size+preco->index_re_wb)
       * (1. + (1.+zend) * dy[2] / y[2] / 3.);
 
     /* dkappa/dtau = a n_e x_e sigma_T = a^{-2} n_e(today) x_e sigma_T (in units of 1/Mpc) */
-    *(preco->recombination_table+(Nz-i-1)*preco->re_size+preco->index_re_dkappadtau)
+    *(preco->recombination_table+index_z*preco->re_size+preco->index_re_dkappadtau)
       = (1.+zend) * (1.+zend) * preco->Nnow * x0 * _sigma_ * _Mpc_over_m_;
 
+    /** - --> choose the number of steps covered by the next line, from
+        the variation of x_e and of dkappa/dz = (dkappa/dtau)/H over
+        this one (pvecback has been evaluated at zend by
+        thermodynamics_derivs_with_recfast()) */
+    dkappadz = *(preco->recombination_table+index_z*preco->re_size+preco->index_re_dkappadtau)
+      / pvecback[background_module_->index_bg_H_];
+
+    if (number_of_lines > 0) {
+      class_call(thermodynamics_recombination_sampling(zinitial/(double)Nz,
+                                                       x0_line_previous,
+                                                       x0,
+                                                       dkappadz_previous,
+                                                       dkappadz,
+                                                       steps,
+                                                       &steps_next),
+                 error_message_,
+                 error_message_);
+    }
+
+    x0_line_previous = x0;
+    dkappadz_previous = dkappadz;
+    number_of_lines++;
+
     /* fprintf(stdout,"%e %e %e %e %e %e\n", */
-    /* 	    *(preco->recombination_table+(Nz-i-1)*preco->re_size+preco->index_re_z), */
-    /* 	    *(preco->recombination_table+(Nz-i-1)*preco->re_size+preco->index_re_xe), */
-    /* 	    *(preco->recombination_table+(Nz-i-1)*preco->re_size+preco->index_re_Tb), */
+    /* 	    *(preco->recombination_table+index_z*preco->re_size+preco->index_re_z), */
+    /* 	    *(preco->recombination_table+index_z*preco->re_size+preco->index_re_xe), */
+    /* 	    *(preco->recombination_table+index_z*preco->re_size+preco->index_re_Tb), */
     /* 	    (1.+zend) * dy[2], */
-    /* 	    *(preco->recombination_table+(Nz-i-1)*preco->re_size+preco->index_re_cb2), */
-    /* 	    *(preco->recombination_table+(Nz-i-1)*preco->re_size+preco->index_re_dkappadtau) */
+    /* 	    *(preco->recombination_table+index_z*preco->re_size+preco->index_re_cb2), */
+    /* 	    *(preco->recombination_table+index_z*preco->re_size+preco->index_re_dkappadtau) */
     /* 	    ); */
 
   }
 
+  /** - move the lines to the beginning of the table */
+  class_call(thermodynamics_recombination_shrink_table(preco, number_of_lines),
+             error_message_,
+             error_message_);
+
   /** - cleanup generic integrator with cleanup_generic_integrator() */
 
   class_call(cleanup_generic_integrator(&gi),
@@ -4025,7 +4184,7 @@ int ThermodynamicsModule::thermodynamics_merge_reco_and_reio(recombination* prec
 
   /** - find number of redshift in full table = number in reco + number in reio - overlap */
 
-  tt_size_ = ppr->recfast_Nz0 + preio->rt_size - preio->index_reco_when_reio_start - 1;
+  tt_size_ = preco->rt_size + preio->rt_size - preio->index_reco_when_reio_start - 1;
 
   /** - add  more points to start earlier in presence of interacting DM */
 
@@ -4053,7 +4212,7 @@ int ThermodynamicsModule::thermodynamics_merge_reco_and_reio(recombination* prec
     thermodynamics_table_[i*th_size_ + index_th_cb2_] =
       preio->reionization_table[i*preio->re_size+preio->index_re_cb2];
   }
-  for (i=0; i < ppr->recfast_Nz0 - preio->index_reco_when_reio_start - 1; i++) {
+  for (i=0; i < preco->rt_size - preio->index_reco_when_reio_start - 1; i++) {
     index_th=i+preio->rt_size;
     index_re=i+preio->index_reco_when_reio_start+1;
     z_table_[index_th] =
@@ -4082,17 +4241,17 @@ int ThermodynamicsModule::thermodynamics_merge_reco_and_reio(recombination* prec
 
         /* with an intermediate step Delta z = (thermo_z_initial_idm_dr-recfast_z_initial)/thermo_Nz1_idm_dr/thermo_Nz1_idm_dr */
         if (i < ppr->thermo_Nz2_idm_dr - 1) {
-          index_th = i + preio->rt_size + ppr->recfast_Nz0 - preio->index_reco_when_reio_start - 1;
+          index_th = i + preio->rt_size + preco->rt_size - preio->index_reco_when_reio_start - 1;
           z_table_[index_th] = ppr->recfast_z_initial + ((double)i + 1.)*(ppr->thermo_z_initial_idm_dr - ppr->recfast_z_initial)/(double)ppr->thermo_Nz1_idm_dr/(double)ppr->thermo_Nz2_idm_dr;
         }
         /* with a large step Delta z  = (thermo_z_initial_idm_dr-recfast_z_initial)/thermo_Nz1_idm_dr */
         else {
-          index_th = (i - ppr->thermo_Nz2_idm_dr + 1) + preio->rt_size + ppr->recfast_Nz0 - preio->index_reco_when_reio_start - 1 + ppr->thermo_Nz2_idm_dr - 1;
+          index_th = (i - ppr->thermo_Nz2_idm_dr + 1) + preio->rt_size + preco->rt_size - preio->index_reco_when_reio_start - 1 + ppr->thermo_Nz2_idm_dr - 1;
           z_table_[index_th] = ppr->recfast_z_initial + ((double)(i - ppr->thermo_Nz2_idm_dr + 1) + 1.)*
           (ppr->thermo_z_initial_idm_dr - ppr->recfast_z_initial)/(double)ppr->thermo_Nz1_idm_dr;
         }
         /* same extrapolation formulas as in thermodynamics_at_z() */
-        x0 = thermodynamics_table_[(preio->rt_size + ppr->recfast_Nz0 - preio->index_reco_when_reio_start - 2)*th_size_ + index_th_xe_];
+        x0 = thermodynamics_table_[(preio->rt_size + preco->rt_size - preio->index_reco_when_reio_start - 2)*th_size_ + index_th_xe_];
         thermodynamics_table_[index_th*th_size_ + index_th_xe_] = x0;
         thermodynamics_table_[index_th*th_size_ + index_th_dkappa_] = (1. + z_table_[index_th])*(1. + z_table_[index_th])*n_e_*x0*_sigma_*_Mpc_over_m_;
         thermodynamics_table_[index_th*th_size_ + index_th_Tb_] = pba->T_cmb*(1. + z_table_[index_th]);
@@ -11,6 +11,7 @@ public:
   int thermodynamics_output_titles(char titles[_MAXTITLESTRINGLENGTH_]) const;
   int thermodynamics_output_data(int number_of_titles, double* data) const;
   int thermodynamics_at_z(double z, short inter_mode, int* last_index, double* pvecback, double* pvecthermo) const;
+  int thermodynamics_at_z(double z, short inter_mode, int* last_index, double* pvecback, double* pvecthermo, ErrorMsg error_message) const;
 
   double tau_ini_; /**< initial conformal time at which thermodynamical variables have been be integrated */
   double YHe_;
@@ -109,6 +110,8 @@ private:
   int thermodynamics_recombination(recombination* preco, double* pvecback);
   int thermodynamics_recombination_with_hyrec(recombination* prec, double* pvecback);
   int thermodynamics_recombination_with_recfast(recombination* prec, double* pvecback);
+  int thermodynamics_recombination_sampling(double dz_grid, double xe_previous, double xe, double dkappadz_previous, double dkappadz, int steps, int* steps_next);
+  int thermodynamics_recombination_shrink_table(recombination* preco, int number_of_lines);
   int thermodynamics_derivs_with_recfast_member(double z, double* y, double* dy, void* fixed_parameters, ErrorMsg error_message);
   static int thermodynamics_derivs_with_recfast(double z, double* y, double* dy, void* fixed_parameters, ErrorMsg error_message);
   int thermodynamics_merge_reco_and_reio(recombination* preco, reionization* preio);
@@ -195,6 +195,29 @@ typedef enum {SCALAR_TEMPERATURE_0,
               TENSOR_POLARISATION_B,
               NC_RSD} radial_function_type;
 
+/**
+ * Transfer sources of all modes, initial conditions and types at one
+ * wavenumber. They are computed once by transfer_prepare_q() and then
+ * only read by the subtasks computing blocks of multipoles at this
+ * wavenumber.
+ */
+
+struct transfer_q_sources {
+
+  int index_q;                         /**< index of the wavenumber */
+
+  struct transfer_workspace * ptw;     /**< workspace used for the preparation; in the non-flat case, it owns the
+                                          hyperspherical Bessel functions of this wavenumber */
+
+  short * has_mode;                    /**< has_mode[index_md]: is the wavenumber below q_max for this mode? */
+
+  struct transfer_workspace ** view;   /**< view[index_md][index_ic*tt_size+index_tt]: copy of ptw whose arrays
+                                          point to the transfer sources, times and radial coordinates of this
+                                          type (one allocated block starting at sources) */
+
+  radial_function_type ** radial_type; /**< radial_type[index_md][index_tt]: radial function of each type */
+};
+
 enum Hermite_Interpolation_Order {HERMITE3, HERMITE4, HERMITE6};
 
 #endif
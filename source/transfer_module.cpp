@@ -291,39 +291,63 @@ int TransferModule::transfer_init() {
                error_message_,
                error_message_);
   }
-  Tools::TaskSystem task_system(pba->number_of_threads);
-  std::vector<std::future<int>> future_output;
-    /** - loop over all wavenumbers (parallelized).*/
-    /* For each wavenumber: */
-    for (index_q = 0; index_q < q_size_; index_q++) {
-    future_output.push_back(task_system.AsyncTask([this, tau_size_max, tp_of_tt, tau_rec, sources_spline, &BIS, tau0, index_q, sources, window] () {
-      struct transfer_workspace* ptw = NULL;
-      class_call(transfer_workspace_init(&ptw, perturbations_module_->tau_size_, tau_size_max, pba->K, pba->sgnK, tau0 - thermodynamics_module_->tau_cut_, &BIS),
-        error_message_,
-        error_message_);
-
-      if (ptr->transfer_verbose > 2)
-        printf("Compute transfer for wavenumber [%d/%zu]\n", index_q, q_size_ - 1);
-
-      /* Update interpolation structure: */
-      class_call(transfer_update_HIS(ptw, index_q, tau0),
-                          error_message_,
-                          error_message_);
-
-      class_call(transfer_compute_for_each_q(tp_of_tt, index_q, tau_size_max, tau_rec, sources, sources_spline, window, ptw),
-                          error_message_,
-                          error_message_);
-      /* free workspace allocated inside parallel zone */
-      class_call(transfer_workspace_free(ptw),
-                           error_message_,
-                           error_message_);
-      return _SUCCESS_;
-    }));
-  } /* end of loop over wavenumber */
-  for (std::future<int>& future : future_output) {
-      if (future.get() != _SUCCESS_) return _FAILURE_;
+  /** - choose the number of multipoles per task: with several threads,
+        split each wavenumber in a few blocks of l, so that the expensive
+        large-q tasks do not leave the other threads idle at the end. The
+        choice depends on the workers wanted for single multipoles, not
+        on a count capped by the number of wavenumbers. */
+  int l_block_size = ppr->transfer_l_block_size;
+  if (l_block_size <= 0) {
+    l_block_size = (number_of_workers(q_size_*l_size_max_, 10.*tau_size_max) > 1) ? (l_size_max_ + 3)/4 : l_size_max_;
+  }
+  l_block_size = MAX(1, MIN(l_block_size, l_size_max_));
+  int l_block_number = (l_size_max_ + l_block_size - 1)/l_block_size;
+
+  /** - take the workers for the loop over wavenumbers and blocks of
+        multipoles: each task costs a time integral for each multipole of
+        the block and each transfer type */
+  Tools::ThreadLease thread_lease(number_of_workers(q_size_*l_block_number, 10.*l_block_size*tau_size_max));
+
+  if (l_block_size < l_size_max_) {
+    class_call(transfer_compute_in_l_blocks(tp_of_tt, tau_size_max, tau_rec, sources, sources_spline, window, &BIS, tau0, l_block_size, thread_lease.Count()),
+               error_message_,
+               error_message_);
+  }
+  else {
+    Tools::TaskSystem task_system(thread_lease.Count());
+    std::vector<std::future<int>> future_output;
+      /** - loop over all wavenumbers (parallelized).*/
+      /* For each wavenumber: */
+      for (index_q = 0; index_q < q_size_; index_q++) {
+      future_output.push_back(task_system.AsyncTask([this, tau_size_max, tp_of_tt, tau_rec, sources_spline, &BIS, tau0, index_q, sources, window] () {
+        struct transfer_workspace* ptw = NULL;
+        class_call(transfer_workspace_init(&ptw, perturbations_module_->tau_size_, tau_size_max, pba->K, pba->sgnK, tau0 - thermodynamics_module_->tau_cut_, &BIS),
+          error_message_,
+          error_message_);
+
+        if (ptr->transfer_verbose > 2)
+          printf("Compute transfer for wavenumber [%d/%zu]\n", index_q, q_size_ - 1);
+
+        /* Update interpolation structure: */
+        class_call(transfer_update_HIS(ptw, index_q, tau0),
+                            error_message_,
+                            error_message_);
+
+        class_call(transfer_compute_for_each_q(tp_of_tt, index_q, tau_size_max, tau_rec, sources, sources_spline, window, ptw),
+                            error_message_,
+                            error_message_);
+        /* free workspace allocated inside parallel zone */
+        class_call(transfer_workspace_free(ptw),
+                             error_message_,
+                             error_message_);
+        return _SUCCESS_;
+      }));
+    } /* end of loop over wavenumber */
+    for (std::future<int>& future : future_output) {
+        if (future.get() != _SUCCESS_) return _FAILURE_;
+    }
+    future_output.clear();
   }
-  future_output.clear();
   /** - finally, free arrays allocated outside parallel zone */
   free(window);
 
@@ -363,8 +387,7 @@ int TransferModule::transfer_free() {
 
     for (index_md = 0; index_md < md_size_; index_md++) {
       free(l_size_tt_[index_md]);
-      free(transfer_[index_md]);
-      free(k_[index_md]);
+      class_free_table(transfer_[index_md]);
     }
 
     free(tt_size_);
@@ -372,6 +395,7 @@ int TransferModule::transfer_free() {
     free(l_size_);
     free(l_);
     free(q_);
+    /* k_[index_md] belong to the grid service */
     free(k_);
     free(transfer_);
 
@@ -540,9 +564,9 @@ int TransferModule::transfer_indices_of_transfers(double q_period, double K, int
   for (index_md = 0; index_md < md_size_; index_md++) {
 
     /** - allocate arrays of transfer functions, (transfer_[index_md])[index_ic][index_tt][index_l][index_k] */
-    class_alloc(transfer_[index_md],
-                perturbations_module_->ic_size_[index_md]*tt_size_[index_md]*l_size_[index_md]*q_size_*sizeof(double),
-                error_message_);
+    class_alloc_table(transfer_[index_md],
+                      perturbations_module_->ic_size_[index_md]*tt_size_[index_md]*l_size_[index_md]*q_size_*sizeof(double),
+                      error_message_);
 
   }
 
@@ -557,6 +581,16 @@ int TransferModule::transfer_perturbation_copy_sources_and_nl_corrections(double
   int index_k;
   int index_tau;
 
+  /* the non-linear corrections are multiplied into the sources node by
+     node, without interpolation: the non-linear module samples them on
+     the grids "tau_sampling" and "k_<index_md>" of the perturbation
+     module in the grid service */
+  if (pnl->method != nl_none) {
+    class_test(nonlinear_module_->k_size_ != perturbations_module_->k_size_[perturbations_module_->index_md_scalars_],
+               error_message_,
+               "the non-linear corrections are not sampled on the nodes of the source functions");
+  }
+
   for (index_md = 0; index_md < md_size_; index_md++) {
 
     class_alloc(sources[index_md],
@@ -1178,6 +1212,10 @@ int TransferModule::transfer_get_k_list(double K) {
                index_md,
                k_[index_md][q_size_ - 1]);
 
+    /* publish the list, so that the spectra module can tabulate the primordial spectrum on it */
+    class_call(share_grid("transfer_k_" + std::to_string(index_md), q_size_, &(k_[index_md])),
+               error_message_,
+               error_message_);
 
   }
 
@@ -1545,17 +1583,9 @@ int TransferModule::transfer_compute_for_each_q(int ** tp_of_tt, int index_q, in
      sources[index_tau] */
   double * sources;
 
-  /** - for a given l, maximum value of k such that we can convolve
-      the source with Bessel functions j_l(x) without reaching x_max */
-  double q_max_bessel;
-
   /* a value of index_type */
   int previous_type;
 
-  double l;
-
-  short neglect;
-
   radial_function_type radial_type;
 
   /** - store the sources in the workspace and define all
@@ -1642,75 +1672,17 @@ int TransferModule::transfer_compute_for_each_q(int ** tp_of_tt, int index_q, in
                      error_message_,
                      error_message_);
 
-          for (index_l = 0; index_l < l_size_[index_md]; index_l++) {
-
-            l = (double)l_[index_l];
-
-            /* neglect transfer function when l is much smaller than k*tau0 */
-            class_call(transfer_can_be_neglected(index_md,
-                                                 index_ic,
-                                                 index_tt,
-                                                 (background_module_->conformal_age_ - tau_rec)*thermodynamics_module_->angular_rescaling_,
-                                                 q_[index_q],
-                                                 l,
-                                                 &neglect),
-                       error_message_,
-                       error_message_);
-
-            /* for K>0 (closed), transfer functions only defined for l<nu */
-            if ((ptw->sgnK == 1) && (l_[index_l] >= (int)(q_[index_q]/sqrt(ptw->K) + 0.2))) {
-              neglect = _TRUE_;
-            }
-            /* This would maybe go into transfer_can_be_neglected later: */
-            if ((ptw->sgnK != 0) && (index_l >= ptw->HIS.l_size) && (index_q < index_q_flat_approximation_)) {
-              neglect = _TRUE_;
-            }
-            if (neglect == _TRUE_) {
-
-              transfer_[index_md][
-                + ((index_ic*tt_size_[index_md] + index_tt)*l_size_[index_md] + index_l)*q_size_
-                + index_q
-              ] = 0.;
-            }
-            else {
-
-              /* for a given l, maximum value of k such that we can
-                 convolve the source with Bessel functions j_l(x)
-                 without reaching x_max (this is relevant in the flat
-                 case when the bessels are computed with the old bessel
-                 module. otherwise this condition is guaranteed by the
-                 choice of proper xmax when computing bessels) */
-              if (ptw->sgnK == 0) {
-                q_max_bessel = ptw->pBIS->x[ptw->pBIS->x_size-1]/tau0_minus_tau[0];
-              }
-              else {
-                q_max_bessel = q_[q_size_ - 1];
-              }
-
-              /* neglect late time CMB sources when l is above threshold */
-              class_call(transfer_late_source_can_be_neglected(index_md,
-                                                               index_tt,
-                                                               l,
-                                                               &(ptw->neglect_late_source)),
-                         error_message_,
-                         error_message_);
-
-              /* compute the transfer function for this l */
-              class_call(transfer_compute_for_each_l(ptw,
-                                                     index_q,
-                                                     index_md,
-                                                     index_ic,
-                                                     index_tt,
-                                                     index_l,
-                                                     l,
-                                                     q_max_bessel,
-                                                     radial_type
-                                                     ),
-                         error_message_,
-                         error_message_);
-            }
-
-          } /* end of loop over l */
+          class_call(transfer_compute_for_l_range(ptw,
+                                                  index_q,
+                                                  index_md,
+                                                  index_ic,
+                                                  index_tt,
+                                                  0,
+                                                  l_size_[index_md],
+                                                  tau_rec,
+                                                  radial_type),
+                     error_message_,
+                     error_message_);
 
         } /* end of loop over type */
 
@@ -1739,6 +1711,478 @@ int TransferModule::transfer_compute_for_each_q(int ** tp_of_tt, int index_q, in
 
 }
 
+/**
+ * Compute all transfer functions with tasks smaller than one
+ * wavenumber. For each q, transfer_prepare_q() computes once the
+ * transfer sources of all types, which are then shared read-only by
+ * the tasks computing blocks of l_block_size multipoles.
+ *
+ * The wavenumbers are processed in batches of a few q per thread, to
+ * bound the memory taken by the prepared sources. The preparation of
+ * the next batch is queued behind the multipole blocks of the current
+ * one, so that the threads do not wait at the end of each batch.
+ *
+ * @param tp_of_tt        Input: correspondence between transfer types and source types
+ * @param tau_size_max    Input: maximum number of sampled times
+ * @param tau_rec         Input: recombination time
+ * @param sources         Input: perturbation sources
+ * @param sources_spline  Input: second derivatives of the perturbation sources with respect to k
+ * @param window          Input: precomputed selection functions
+ * @param pBIS            Input: flat spherical Bessel functions
+ * @param tau0            Input: conformal age
+ * @param l_block_size    Input: number of multipoles per task
+ * @param workers         Input: number of worker threads
+ * @return the error status
+ */
+
+int TransferModule::transfer_compute_in_l_blocks(int ** tp_of_tt, int tau_size_max, double tau_rec, double *** sources, double *** sources_spline, double * window, HyperInterpStruct * pBIS, double tau0, int l_block_size, int workers) {
+
+  int q_size = q_size_;
+  int q_batch_size = 2*workers;
+  int batch_size = (q_size + q_batch_size - 1)/q_batch_size;
+  int index_batch;
+
+  std::vector<struct transfer_q_sources*> q_sources(q_size, nullptr);
+  /* releases the sources still allocated when returning early on an error */
+  struct QSourcesRelease {
+    TransferModule* module;
+    std::vector<struct transfer_q_sources*>& q_sources;
+    ~QSourcesRelease() {
+      for (struct transfer_q_sources* pqs : q_sources)
+        module->transfer_q_sources_free(pqs);
+    }
+  } q_sources_release{this, q_sources};
+  std::vector<std::future<int>> prepare_output;
+  std::vector<std::future<int>> block_output;
+  std::vector<std::future<int>> previous_block_output;
+  /* declared last, so that it waits for all tasks before the arrays above are released */
+  Tools::TaskSystem task_system(workers);
+
+  auto prepare_batch = [&] (int index_batch) {
+    for (int index_q = index_batch*q_batch_size; index_q < MIN((index_batch + 1)*q_batch_size, q_size); index_q++) {
+      prepare_output.push_back(task_system.AsyncTask([this, tp_of_tt, tau_size_max, tau_rec, sources, sources_spline, window, pBIS, tau0, index_q, &q_sources] () {
+        if (ptr->transfer_verbose > 2)
+          printf("Compute transfer for wavenumber [%d/%zu]\n", index_q, q_size_ - 1);
+        class_call(transfer_q_sources_init(&(q_sources[index_q]), index_q, tau_size_max, tau0, pBIS),
+                   error_message_,
+                   error_message_);
+        class_call(transfer_prepare_q(tp_of_tt, tau_size_max, tau_rec, sources, sources_spline, window, q_sources[index_q]),
+                   error_message_,
+                   error_message_);
+        return _SUCCESS_;
+      }));
+    }
+  };
+
+  auto compute_batch = [&] (int index_batch) {
+    for (int index_q = index_batch*q_batch_size; index_q < MIN((index_batch + 1)*q_batch_size, q_size); index_q++) {
+      const struct transfer_q_sources* pqs = q_sources[index_q];
+      for (int index_l_min = 0; index_l_min < l_size_max_; index_l_min += l_block_size) {
+        block_output.push_back(task_system.AsyncTask([this, pqs, index_l_min, l_block_size, tau_rec] () {
+          class_call(transfer_compute_for_l_block(pqs, index_l_min, MIN(index_l_min + l_block_size, l_size_max_), tau_rec),
+                     error_message_,
+                     error_message_);
+          return _SUCCESS_;
+        }));
+      }
+    }
+  };
+
+  auto free_batch = [&] (int index_batch) {
+    for (int index_q = index_batch*q_batch_size; index_q < MIN((index_batch + 1)*q_batch_size, q_size); index_q++) {
+      struct transfer_q_sources* pqs = q_sources[index_q];
+      q_sources[index_q] = nullptr;
+      class_call(transfer_q_sources_free(pqs),
+                 error_message_,
+                 error_message_);
+    }
+    return _SUCCESS_;
+  };
+
+  prepare_batch(0);
+
+  for (index_batch = 0; index_batch < batch_size; index_batch++) {
+
+    for (std::future<int>& future : prepare_output) {
+      if (future.get() != _SUCCESS_) return _FAILURE_;
+    }
+    prepare_output.clear();
+
+    /** - queue the multipole blocks of this batch */
+    compute_batch(index_batch);
+
+    /** - while they run, release the sources of the previous batch and prepare the next one */
+    for (std::future<int>& future : previous_block_output) {
+      if (future.get() != _SUCCESS_) return _FAILURE_;
+    }
+    previous_block_output.clear();
+    if (index_batch > 0) {
+      class_call(free_batch(index_batch - 1), error_message_, error_message_);
+    }
+    if (index_batch + 1 < batch_size) {
+      prepare_batch(index_batch + 1);
+    }
+    std::swap(block_output, previous_block_output);
+  }
+
+  for (std::future<int>& future : previous_block_output) {
+    if (future.get() != _SUCCESS_) return _FAILURE_;
+  }
+  class_call(free_batch(batch_size - 1), error_message_, error_message_);
+
+  return _SUCCESS_;
+}
+
+/**
+ * Allocate the shared sources of one wavenumber, together with the
+ * workspace used to prepare them, and compute the Bessel functions of
+ * this wavenumber if needed (non-flat case).
+ *
+ * @param pqs           Output: pointer to the allocated structure
+ * @param index_q       Input: index of wavenumber
+ * @param tau_size_max  Input: maximum number of sampled times
+ * @param tau0          Input: conformal age
+ * @param pBIS          Input: flat spherical Bessel functions
+ * @return the error status
+ */
+
+int TransferModule::transfer_q_sources_init(struct transfer_q_sources ** pqs, int index_q, int tau_size_max, double tau0, HyperInterpStruct * pBIS) {
+
+  int index_md;
+
+  class_calloc(*pqs, 1, sizeof(struct transfer_q_sources), error_message_);
+  (*pqs)->index_q = index_q;
+
+  class_call(transfer_workspace_init(&((*pqs)->ptw), perturbations_module_->tau_size_, tau_size_max, pba->K, pba->sgnK, tau0 - thermodynamics_module_->tau_cut_, pBIS),
+             error_message_,
+             error_message_);
+
+  class_call(transfer_update_HIS((*pqs)->ptw, index_q, tau0),
+             error_message_,
+             error_message_);
+
+  class_calloc((*pqs)->has_mode, md_size_, sizeof(short), error_message_);
+  class_calloc((*pqs)->view, md_size_, sizeof(struct transfer_workspace*), error_message_);
+  class_calloc((*pqs)->radial_type, md_size_, sizeof(radial_function_type*), error_message_);
+
+  for (index_md = 0; index_md < md_size_; index_md++) {
+    class_calloc((*pqs)->view[index_md], perturbations_module_->ic_size_[index_md]*tt_size_[index_md], sizeof(struct transfer_workspace), error_message_);
+    class_calloc((*pqs)->radial_type[index_md], tt_size_[index_md], sizeof(radial_function_type), error_message_);
+  }
+
+  return _SUCCESS_;
+}
+
+int TransferModule::transfer_q_sources_free(struct transfer_q_sources * pqs) {
+
+  int index_md, index;
+
+  if (pqs == NULL)
+    return _SUCCESS_;
+
+  /* the structure may be partially allocated if transfer_q_sources_init() failed */
+  for (index_md = 0; index_md < md_size_; index_md++) {
+    if ((pqs->view != NULL) && (pqs->view[index_md] != NULL)) {
+      for (index = 0; index < perturbations_module_->ic_size_[index_md]*tt_size_[index_md]; index++) {
+        free(pqs->view[index_md][index].sources);
+      }
+      free(pqs->view[index_md]);
+    }
+    if (pqs->radial_type != NULL) {
+      free(pqs->radial_type[index_md]);
+    }
+  }
+  free(pqs->view);
+  free(pqs->radial_type);
+  free(pqs->has_mode);
+
+  if (pqs->ptw != NULL) {
+    class_call(transfer_workspace_free(pqs->ptw),
+               error_message_,
+               error_message_);
+  }
+
+  free(pqs);
+
+  return _SUCCESS_;
+}
+
+/**
+ * Compute the transfer sources of all modes, initial conditions and
+ * types at one wavenumber, in the same way as
+ * transfer_compute_for_each_q(), and keep a copy of each of them (with
+ * the corresponding times and radial coordinates) in the structure
+ * shared by the multipole blocks.
+ *
+ * @param tp_of_tt             Input: correspondence between transfer types and source types
+ * @param tau_size_max         Input: maximum number of sampled times
+ * @param tau_rec              Input: recombination time
+ * @param pert_sources         Input: perturbation sources
+ * @param pert_sources_spline  Input: second derivatives of the perturbation sources with respect to k
+ * @param window               Input: precomputed selection functions
+ * @param pqs                  Input/Output: shared sources of this wavenumber
+ * @return the error status
+ */
+
+int TransferModule::transfer_prepare_q(int ** tp_of_tt, int tau_size_max, double tau_rec, double *** pert_sources, double *** pert_sources_spline, double * window, struct transfer_q_sources * pqs) {
+
+  int index_md;
+  int index_ic;
+  int index_tt;
+  int index_q = pqs->index_q;
+  int previous_type;
+  int tau_size;
+  struct transfer_workspace * ptw = pqs->ptw;
+  struct transfer_workspace * pview;
+  double * block;
+
+  for (index_md = 0; index_md < md_size_; index_md++) {
+
+    /* if we reached q_max for this mode, the multipole blocks just set the transfer functions to zero */
+
+    if (k_[index_md][index_q] > perturbations_module_->k_[index_md][perturbations_module_->k_size_cl_[index_md] - 1]) {
+      pqs->has_mode[index_md] = _FALSE_;
+      continue;
+    }
+    pqs->has_mode[index_md] = _TRUE_;
+
+    for (index_tt = 0; index_tt < tt_size_[index_md]; index_tt++) {
+      class_call(transfer_select_radial_function(index_md, index_tt, &(pqs->radial_type[index_md][index_tt])),
+                 error_message_,
+                 error_message_);
+    }
+
+    for (index_ic = 0; index_ic < perturbations_module_->ic_size_[index_md]; index_ic++) {
+
+      previous_type = -1;
+
+      for (index_tt = 0; index_tt < tt_size_[index_md]; index_tt++) {
+
+        if (tp_of_tt[index_md][index_tt] != previous_type) {
+
+          class_call(transfer_interpolate_sources(index_q,
+                                                  index_md,
+                                                  index_ic,
+                                                  tp_of_tt[index_md][index_tt],
+                                                  pert_sources[index_md][index_ic*perturbations_module_->tp_size_[index_md] + tp_of_tt[index_md][index_tt]],
+                                                  pert_sources_spline[index_md][index_ic*perturbations_module_->tp_size_[index_md] + tp_of_tt[index_md][index_tt]],
+                                                  ptw->interpolated_sources),
+                     error_message_,
+                     error_message_);
+        }
+
+        previous_type = tp_of_tt[index_md][index_tt];
+
+        class_call(transfer_sources(ptw->interpolated_sources,
+                                    tau_rec,
+                                    index_q,
+                                    index_md,
+                                    index_tt,
+                                    ptw->sources,
+                                    window,
+                                    tau_size_max,
+                                    ptw->tau0_minus_tau,
+                                    ptw->w_trapz,
+                                    &(ptw->tau_size)),
+                   error_message_,
+                   error_message_);
+
+        class_call(transfer_radial_coordinates(ptw, index_md, index_q),
+                   error_message_,
+                   error_message_);
+
+        /** - store a copy of the workspace pointing to its own copy of the arrays */
+
+        tau_size = ptw->tau_size;
+        pview = &(pqs->view[index_md][index_ic*tt_size_[index_md] + index_tt]);
+        class_alloc(block, 6*tau_size*sizeof(double), error_message_);
+
+        *pview = *ptw;
+        pview->HIS_allocated = _FALSE_;
+        pview->interpolated_sources = NULL;
+        pview->sources = block;
+        pview->tau0_minus_tau = block + tau_size;
+        pview->w_trapz = block + 2*tau_size;
+        pview->chi = block + 3*tau_size;
+        pview->cscKgen = block + 4*tau_size;
+        pview->cotKgen = block + 5*tau_size;
+
+        memcpy(pview->sources, ptw->sources, tau_size*sizeof(double));
+        memcpy(pview->tau0_minus_tau, ptw->tau0_minus_tau, tau_size*sizeof(double));
+        memcpy(pview->w_trapz, ptw->w_trapz, tau_size*sizeof(double));
+        memcpy(pview->chi, ptw->chi, tau_size*sizeof(double));
+        memcpy(pview->cscKgen, ptw->cscKgen, tau_size*sizeof(double));
+        memcpy(pview->cotKgen, ptw->cotKgen, tau_size*sizeof(double));
+      }
+    }
+  }
+
+  return _SUCCESS_;
+}
+
+/**
+ * Compute the transfer functions of one wavenumber for all modes,
+ * initial conditions and types, and for the multipoles index_l_min <=
+ * index_l < index_l_max, from the sources prepared by
+ * transfer_prepare_q(). Several blocks of the same wavenumber may run
+ * at the same time: each works on its own copy of the workspace.
+ *
+ * @param pqs          Input: shared sources of this wavenumber
+ * @param index_l_min  Input: first multipole index
+ * @param index_l_max  Input: one past the last multipole index
+ * @param tau_rec      Input: recombination time
+ * @return the error status
+ */
+
+int TransferModule::transfer_compute_for_l_block(const struct transfer_q_sources * pqs, int index_l_min, int index_l_max, double tau_rec) {
+
+  int index_md;
+  int index_ic;
+  int index_tt;
+  int index_l;
+  int index_q = pqs->index_q;
+  int l_max_md;
+  struct transfer_workspace view;
+
+  for (index_md = 0; index_md < md_size_; index_md++) {
+
+    l_max_md = MIN(index_l_max, l_size_[index_md]);
+
+    for (index_ic = 0; index_ic < perturbations_module_->ic_size_[index_md]; index_ic++) {
+      for (index_tt = 0; index_tt < tt_size_[index_md]; index_tt++) {
+
+        if (pqs->has_mode[index_md] == _TRUE_) {
+
+          view = pqs->view[index_md][index_ic*tt_size_[index_md] + index_tt];
+
+          class_call(transfer_compute_for_l_range(&view,
+                                                  index_q,
+                                                  index_md,
+                                                  index_ic,
+                                                  index_tt,
+                                                  index_l_min,
+                                                  l_max_md,
+                                                  tau_rec,
+                                                  pqs->radial_type[index_md][index_tt]),
+                     error_message_,
+                     error_message_);
+        }
+        else {
+          for (index_l = index_l_min; index_l < l_max_md; index_l++) {
+            transfer_[index_md][
+              + ((index_ic*tt_size_[index_md] + index_tt)*l_size_[index_md] + index_l)*q_size_
+              + index_q
+            ] = 0.;
+          }
+        }
+      }
+    }
+  }
+
+  return _SUCCESS_;
+}
+
+/**
+ * Compute the transfer functions of one wavenumber, mode, initial
+ * condition and type for the multipoles index_l_min <= index_l <
+ * index_l_max. The transfer sources, time sampling and radial
+ * coordinates must already be stored in the workspace.
+ *
+ * @param ptw          Input: workspace with the sources of this type (only neglect_late_source is modified)
+ * @param index_q      Input: index of wavenumber
+ * @param index_md     Input: index of mode
+ * @param index_ic     Input: index of initial condition
+ * @param index_tt     Input: index of transfer type
+ * @param index_l_min  Input: first multipole index
+ * @param index_l_max  Input: one past the last multipole index
+ * @param tau_rec      Input: recombination time
+ * @param radial_type  Input: type of radial (Bessel) function for this type
+ * @return the error status
+ */
+
+int TransferModule::transfer_compute_for_l_range(struct transfer_workspace * ptw, int index_q, int index_md, int index_ic, int index_tt, int index_l_min, int index_l_max, double tau_rec, radial_function_type radial_type) {
+
+  int index_l;
+  double l;
+  short neglect;
+
+  /** - for a given l, maximum value of k such that we can convolve
+      the source with Bessel functions j_l(x) without reaching x_max */
+  double q_max_bessel;
+
+  for (index_l = index_l_min; index_l < index_l_max; index_l++) {
+
+    l = (double)l_[index_l];
+
+    /* neglect transfer function when l is much smaller than k*tau0 */
+    class_call(transfer_can_be_neglected(index_md,
+                                         index_ic,
+                                         index_tt,
+                                         (background_module_->conformal_age_ - tau_rec)*thermodynamics_module_->angular_rescaling_,
+                                         q_[index_q],
+                                         l,
+                                         &neglect),
+               error_message_,
+               error_message_);
+
+    /* for K>0 (closed), transfer functions only defined for l<nu */
+    if ((ptw->sgnK == 1) && (l_[index_l] >= (int)(q_[index_q]/sqrt(ptw->K) + 0.2))) {
+      neglect = _TRUE_;
+    }
+    /* This would maybe go into transfer_can_be_neglected later: */
+    if ((ptw->sgnK != 0) && (index_l >= ptw->HIS.l_size) && (index_q < index_q_flat_approximation_)) {
+      neglect = _TRUE_;
+    }
+    if (neglect == _TRUE_) {
+
+      transfer_[index_md][
+        + ((index_ic*tt_size_[index_md] + index_tt)*l_size_[index_md] + index_l)*q_size_
+        + index_q
+      ] = 0.;
+    }
+    else {
+
+      /* for a given l, maximum value of k such that we can
+         convolve the source with Bessel functions j_l(x)
+         without reaching x_max (this is relevant in the flat
+         case when the bessels are computed with the old bessel
+         module. otherwise this condition is guaranteed by the
+         choice of proper xmax when computing bessels) */
+      if (ptw->sgnK == 0) {
+        q_max_bessel = ptw->pBIS->x[ptw->pBIS->x_size-1]/ptw->tau0_minus_tau[0];
+      }
+      else {
+        q_max_bessel = q_[q_size_ - 1];
+      }
+
+      /* neglect late time CMB sources when l is above threshold */
+      class_call(transfer_late_source_can_be_neglected(index_md,
+                                                       index_tt,
+                                                       l,
+                                                       &(ptw->neglect_late_source)),
+                 error_message_,
+                 error_message_);
+
+      /* compute the transfer function for this l */
+      class_call(transfer_compute_for_each_l(ptw,
+                                             index_q,
+                                             index_md,
+                                             index_ic,
+                                             index_tt,
+                                             index_l,
+                                             l,
+                                             q_max_bessel,
+                                             radial_type
+                                             ),
+                 error_message_,
+                 error_message_);
+    }
+
+  } /* end of loop over l */
+
+  return _SUCCESS_;
+}
+
 int TransferModule::transfer_radial_coordinates(struct transfer_workspace * ptw, int index_md, int index_q) {
 
   int index_tau;
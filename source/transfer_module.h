@@ -46,7 +46,7 @@ public:
   //@{
   size_t q_size_; /**< number of wavenumber values */
   double * q_;  /**< list of wavenumber values, q[index_q] */
-  double ** k_; /**< list of wavenumber values for each requested mode, k[index_md][index_q]. In flat universes k=q. In non-flat universes q and k differ through q2 = k2 + K(1+m), where m=0,1,2 for scalar, vector, tensor. q should be used throughout the transfer module, excepted when interpolating or manipulating the source functions S(k,tau): for a given value of q this should be done in k(q). */
+  double ** k_; /**< list of wavenumber values for each requested mode, k[index_md][index_q]. In flat universes k=q. In non-flat universes q and k differ through q2 = k2 + K(1+m), where m=0,1,2 for scalar, vector, tensor. q should be used throughout the transfer module, excepted when interpolating or manipulating the source functions S(k,tau): for a given value of q this should be done in k(q). Nodes of the grid "transfer_k_<index_md>" of the grid service. */
   int index_q_flat_approximation_; /**< index of the first q value using the flat rescaling approximation */
   //@}
   /** @name - transfer functions */
@@ -74,6 +74,12 @@ private:
   int transfer_source_tau_size_max(double tau_rec, double tau0, int * tau_size_max);
   int transfer_source_tau_size(double tau_rec, double tau0, int index_md, int index_tt, int * tau_size);
   int transfer_compute_for_each_q(int ** tp_of_tt, int index_q, int tau_size_max, double tau_rec, double *** sources, double *** sources_spline, double * window, struct transfer_workspace * ptw);
+  int transfer_compute_for_l_range(struct transfer_workspace * ptw, int index_q, int index_md, int index_ic, int index_tt, int index_l_min, int index_l_max, double tau_rec, radial_function_type radial_type);
+  int transfer_compute_in_l_blocks(int ** tp_of_tt, int tau_size_max, double tau_rec, double *** sources, double *** sources_spline, double * window, HyperInterpStruct * pBIS, double tau0, int l_block_size, int workers);
+  int transfer_q_sources_init(struct transfer_q_sources ** pqs, int index_q, int tau_size_max, double tau0, HyperInterpStruct * pBIS);
+  int transfer_q_sources_free(struct transfer_q_sources * pqs);
+  int transfer_prepare_q(int ** tp_of_tt, int tau_size_max, double tau_rec, double *** sources, double *** sources_spline, double * window, struct transfer_q_sources * pqs);
+  int transfer_compute_for_l_block(const struct transfer_q_sources * pqs, int index_l_min, int index_l_max, double tau_rec);
   int transfer_radial_coordinates(struct transfer_workspace * ptw, int index_md, int index_q);
   int transfer_interpolate_sources(int index_q, int index_md, int index_ic, int index_type, double * sources, double * source_spline, double * interpolated_sources);
   int transfer_sources(double * interpolated_sources, double tau_rec, int index_q, int index_md, int index_tt, double * sources, double * window, int tau_size_max, double * tau0_minus_tau, double * delta_tau, int * tau_size_out);
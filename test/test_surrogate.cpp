@@ -0,0 +1,115 @@
+/** @file test_surrogate.cpp
+ *
+ * Regression test of the surrogate mode (source/surrogate.h).
+ *
+ * Usage: ./test_surrogate
+ *
+ * A Cl-only model of order 2 is trained on a small box in (omega_cdm, h).
+ * At an interior point, the surrogate must emulate the spectra (no
+ * fallback to a full run), and the emulated TT, TE and EE spectra must
+ * agree with a full run within the error tolerance, relative to the
+ * largest value of each spectrum. TE changes sign, so this also checks
+ * that its zero crossings do not inflate the error estimate.
+ */
+
+#include "cosmology.h"
+#include "spectra_module.h"
+#include "surrogate.h"
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace {
+
+int FileContentFromEntries(const std::vector<std::pair<std::string, std::string>>& entries, FileContent& fc, ErrorMsg error_message) {
+  class_call(parser_init(&fc, entries.size(), (char*)"test_surrogate", error_message),
+             error_message,
+             error_message);
+  for (int i = 0; i < entries.size(); i++) {
+    strcpy(fc.name[i], entries[i].first.c_str());
+    strcpy(fc.value[i], entries[i].second.c_str());
+    fc.read[i] = _FALSE_;
+  }
+  return _SUCCESS_;
+}
+
+}
+
+int main(int argc, char **argv) {
+
+  ErrorMsg error_message;
+  const double tolerance = 1.e-2;
+
+  std::vector<std::pair<std::string, std::string>> base = {
+    {"output", "tCl,pCl"},
+    {"l_max_scalars", "1500"},
+  };
+  std::vector<std::pair<std::string, std::string>> point = {
+    {"omega_cdm", "0.1215"},
+    {"h", "0.675"},
+  };
+
+  /** - train on the box */
+  std::vector<std::pair<std::string, std::string>> training = base;
+  training.insert(training.end(), {
+    {"surrogate_parameters", "omega_cdm, h"},
+    {"surrogate_parameters_min", "0.11, 0.64"},
+    {"surrogate_parameters_max", "0.13, 0.72"},
+    {"surrogate_order", "2"},
+    {"surrogate_error_tolerance", "1.e-2"},
+    {"surrogate_verbose", "0"},
+  });
+  FileContent fc_training;
+  if (FileContentFromEntries(training, fc_training, error_message) == _FAILURE_) {
+    printf("\n\nError in test_surrogate \n=>%s\n", error_message);
+    return _FAILURE_;
+  }
+  SurrogateModelPtr model = std::make_shared<const SurrogateModel>(fc_training);
+  printf("Trained surrogate: validation error %g\n", model->validation_error_);
+
+  /** - evaluate it at an interior point */
+  FileContent fc_point;
+  if (FileContentFromEntries(point, fc_point, error_message) == _FAILURE_) {
+    printf("\n\nError in test_surrogate \n=>%s\n", error_message);
+    return _FAILURE_;
+  }
+  SurrogateCosmology surrogate{model, fc_point};
+  printf("Interior point: error estimate %g, %s\n", surrogate.error_estimate_, surrogate.is_emulated_ ? "emulated" : "full run");
+
+  /** - compare with a full run */
+  std::vector<std::pair<std::string, std::string>> full = base;
+  full.insert(full.end(), point.begin(), point.end());
+  FileContent fc_full;
+  if (FileContentFromEntries(full, fc_full, error_message) == _FAILURE_) {
+    printf("\n\nError in test_surrogate \n=>%s\n", error_message);
+    return _FAILURE_;
+  }
+  Cosmology cosmology{fc_full};
+  int l_max = model->l_max_;
+  std::map<std::string, std::vector<double>> cl_full = cosmology.GetSpectraModule()->cl_output(l_max);
+  std::map<std::string, std::vector<double>> cl_surrogate = surrogate.cl_output(l_max);
+
+  double largest_error = 0.;
+  for (const std::string& name : {"tt", "te", "ee"}) {
+    const std::vector<double>& truth = cl_full.at(name);
+    const std::vector<double>& prediction = cl_surrogate.at(name);
+    double largest = 0.;
+    double error = 0.;
+    for (int l = 2; l <= l_max; l++) {
+      largest = std::max(largest, fabs(truth[l]));
+      error = std::max(error, fabs(prediction[l] - truth[l]));
+    }
+    printf(" -> %s: largest difference %g of the largest value\n", name.c_str(), error/largest);
+    largest_error = std::max(largest_error, error/largest);
+  }
+
+  if ((surrogate.is_emulated_ == false) || (largest_error > tolerance)) {
+    printf("FAILED: the interior point should be emulated within %g\n", tolerance);
+    return _FAILURE_;
+  }
+  printf("PASSED\n");
+
+  return _SUCCESS_;
+}
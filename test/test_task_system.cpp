@@ -0,0 +1,339 @@
+/** @file test_task_system.cpp
+ *
+ * Benchmark of the task scheduler Tools::TaskSystem (tools/thread_pool.h).
+ *
+ * Usage: ./test_task_system [max_threads] [input.ini [input.pre]]
+ *
+ * Three synthetic workloads, shaped like the real ones, are run for
+ * 1, 2, 4, ... max_threads threads:
+ *
+ * - k-tasks:      a few hundred tasks of uneven cost, growing with the
+ *                 index of the task like the wavenumbers in perturb_init()
+ * - spline tasks: a large number of tiny tasks, as in the splines of the
+ *                 primordial and spectra modules
+ * - q-tasks:      tasks each working on a large private workspace, as the
+ *                 transfer integrals in transfer_init()
+ *
+ * For each of them we report the wall time (including the construction
+ * and destruction of the TaskSystem, as in the modules), the throughput,
+ * the speedup and efficiency with respect to one thread, the fraction of
+ * time the workers were idle, and the part of it spent waiting at the end
+ * (when the queues are empty but the last tasks are still running). The
+ * spline tasks are also run through Async() without futures, in order to
+ * isolate the cost of the futures, and the latency of a task submitted to
+ * an idle pool is measured by ping-pong.
+ *
+ * If an input file is passed, the real modules are then computed for the
+ * same thread counts (from one parsed InputModule, copied with a different
+ * number_of_threads), and their strong-scaling curves are reported. The
+ * thread budget is set to max_threads, so that the modules get the
+ * workers they ask for whatever the environment says.
+ */
+
+#include "cosmology.h"
+#include "thread_budget.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+double SecondsSince(Clock::time_point start) {
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+/* Compute-bound work of a given number of units, which the compiler cannot remove */
+double BusyWork(long units, double seed) {
+  double x = seed;
+  for (long i = 0; i < units; ++i) {
+    x = x*0.9999999 + 1.e-7*sqrt(x + 1.);
+  }
+  return x;
+}
+
+struct TaskRecord {
+  double start;
+  double finish;
+  std::thread::id thread;
+  double result;
+};
+
+struct Measurement {
+  double wall;
+  double idle_fraction;
+  double tail_fraction;
+};
+
+/* Run a workload through AsyncTask(), one future per task as in the modules */
+template <typename Work>
+Measurement RunTasks(unsigned int threads, int task_size, Work work) {
+  std::vector<TaskRecord> records(task_size);
+  Clock::time_point start = Clock::now();
+  {
+    Tools::TaskSystem task_system(threads);
+    std::vector<std::future<int>> future_output;
+    for (int index_task = 0; index_task < task_size; ++index_task) {
+      future_output.push_back(task_system.AsyncTask([&records, &work, &start, index_task] () {
+        TaskRecord& record = records[index_task];
+        record.start = SecondsSince(start);
+        record.result = work(index_task);
+        record.finish = SecondsSince(start);
+        record.thread = std::this_thread::get_id();
+        return _SUCCESS_;
+      }));
+    }
+    for (std::future<int>& future : future_output) {
+      future.get();
+    }
+  }
+  Measurement measurement;
+  measurement.wall = SecondsSince(start);
+
+  /* busy time and time of the last completed task of each worker */
+  double busy = 0.;
+  std::map<std::thread::id, double> last_finish;
+  for (const TaskRecord& record : records) {
+    busy += record.finish - record.start;
+    double& finish = last_finish[record.thread];
+    finish = std::max(finish, record.finish);
+  }
+  double tail = 0.;
+  for (const auto& entry : last_finish) {
+    tail += measurement.wall - entry.second;
+  }
+  /* workers that never got a task were idle all the time */
+  tail += (threads - last_finish.size())*measurement.wall;
+  measurement.idle_fraction = 1. - busy/(threads*measurement.wall);
+  measurement.tail_fraction = tail/(threads*measurement.wall);
+  return measurement;
+}
+
+/* Same as RunTasks(), but through Async() and an atomic counter instead of futures */
+template <typename Work>
+double RunTasksWithoutFutures(unsigned int threads, int task_size, Work work) {
+  std::atomic<int> remaining(task_size);
+  std::vector<double> results(task_size);
+  std::mutex mutex;
+  std::condition_variable done;
+  Clock::time_point start = Clock::now();
+  {
+    Tools::TaskSystem task_system(threads);
+    for (int index_task = 0; index_task < task_size; ++index_task) {
+      task_system.Async([&, index_task] () {
+        results[index_task] = work(index_task);
+        if (--remaining == 0) {
+          std::unique_lock<std::mutex> lock(mutex);
+          done.notify_one();
+        }
+      });
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    while (remaining > 0) {
+      done.wait(lock);
+    }
+  }
+  return SecondsSince(start);
+}
+
+/* Median and 99th percentile of the round trip of an empty task through an idle pool */
+void MeasureLatency(unsigned int threads, int trial_size, double* median, double* p99) {
+  Tools::TaskSystem task_system(threads);
+  std::vector<double> latency(trial_size);
+  for (int index_trial = 0; index_trial < trial_size; ++index_trial) {
+    Clock::time_point start = Clock::now();
+    task_system.AsyncTask([] () { return _SUCCESS_; }).get();
+    latency[index_trial] = SecondsSince(start);
+  }
+  std::sort(latency.begin(), latency.end());
+  *median = latency[trial_size/2];
+  *p99 = latency[(99*trial_size)/100];
+}
+
+void PrintHeader(const char* title, const char* columns) {
+  printf("\n%s\n", title);
+  printf("%8s %10s %12s %8s %8s %s\n", "threads", "wall [s]", "tasks/s", "speedup", "effic.", columns);
+}
+
+}
+
+int main(int argc, char **argv) {
+
+  unsigned int max_threads = std::thread::hardware_concurrency();
+  if (argc > 1) {
+    max_threads = std::max(1, atoi(argv[1]));
+  }
+  std::vector<unsigned int> thread_counts;
+  for (unsigned int threads = 1; threads < max_threads; threads *= 2) {
+    thread_counts.push_back(threads);
+  }
+  thread_counts.push_back(max_threads);
+
+  /** - calibrate the work unit */
+  const long calibration_units = 20000000;
+  Clock::time_point start = Clock::now();
+  volatile double sink = BusyWork(calibration_units, 1.);
+  double unit_time = SecondsSince(start)/calibration_units;
+  printf("Task scheduler benchmark with up to %u threads (one work unit = %.2f ns)\n", max_threads, 1.e9*unit_time);
+
+  /** - k-tasks: cost growing like k^1.5 from 0.1 to 3 ms */
+  const int k_size = 400;
+  auto k_task = [unit_time] (int index_k) {
+    double x = (double)index_k/(k_size - 1);
+    long units = (long)(1.e-4*(1. + 29.*pow(x, 1.5))/unit_time);
+    return BusyWork(units, 1. + x);
+  };
+
+  /** - spline tasks: about one microsecond each */
+  const int spline_size = 200000;
+  const long spline_units = std::max(1L, (long)(1.e-6/unit_time));
+  auto spline_task = [spline_units] (int index_spline) {
+    return BusyWork(spline_units, 1. + 1.e-6*index_spline);
+  };
+
+  /** - q-tasks: a workspace of 4 MB, swept ten times */
+  const int q_size = 200;
+  const int workspace_size = 512*1024;
+  auto q_task = [workspace_size] (int index_q) {
+    std::vector<double> workspace(workspace_size);
+    for (int index = 0; index < workspace_size; ++index) {
+      workspace[index] = 1. + 1.e-3*index_q + 1.e-9*index;
+    }
+    double sum = 0.;
+    for (int sweep = 0; sweep < 10; ++sweep) {
+      for (int index = 1; index < workspace_size; ++index) {
+        workspace[index] = 0.5*(workspace[index] + workspace[index - 1]);
+      }
+      sum += workspace[workspace_size - 1];
+    }
+    return sum;
+  };
+
+  struct Workload {
+    const char* title;
+    int task_size;
+    std::function<Measurement(unsigned int)> run;
+  };
+  std::vector<Workload> workloads = {
+    {"k-tasks (uneven, 0.1-3 ms)", k_size, [&] (unsigned int threads) { return RunTasks(threads, k_size, k_task); }},
+    {"spline tasks (~1 us)", spline_size, [&] (unsigned int threads) { return RunTasks(threads, spline_size, spline_task); }},
+    {"q-tasks (4 MB workspace)", q_size, [&] (unsigned int threads) { return RunTasks(threads, q_size, q_task); }}
+  };
+
+  for (const Workload& workload : workloads) {
+    PrintHeader(workload.title, "   idle     tail");
+    double wall_1 = 0.;
+    for (unsigned int threads : thread_counts) {
+      Measurement measurement = workload.run(threads);
+      if (threads == 1) {
+        wall_1 = measurement.wall;
+      }
+      printf("%8u %10.4f %12.4g %8.2f %8.2f %6.1f%% %7.1f%%\n",
+             threads,
+             measurement.wall,
+             workload.task_size/measurement.wall,
+             wall_1/measurement.wall,
+             wall_1/measurement.wall/threads,
+             100.*measurement.idle_fraction,
+             100.*measurement.tail_fraction);
+    }
+  }
+
+  PrintHeader("spline tasks without futures (Async)", "  vs. futures");
+  double wall_1 = 0.;
+  for (unsigned int threads : thread_counts) {
+    double wall = RunTasksWithoutFutures(threads, spline_size, spline_task);
+    double wall_futures = RunTasks(threads, spline_size, spline_task).wall;
+    if (threads == 1) {
+      wall_1 = wall;
+    }
+    printf("%8u %10.4f %12.4g %8.2f %8.2f %10.2f\n",
+           threads, wall, spline_size/wall, wall_1/wall, wall_1/wall/threads, wall_futures/wall);
+  }
+
+  printf("\nlatency of one task submitted to an idle pool\n");
+  printf("%8s %12s %12s\n", "threads", "median [us]", "p99 [us]");
+  for (unsigned int threads : thread_counts) {
+    double median, p99;
+    MeasureLatency(threads, 2000, &median, &p99);
+    printf("%8u %12.2f %12.2f\n", threads, 1.e6*median, 1.e6*p99);
+  }
+
+  if (argc <= 2) {
+    return _SUCCESS_;
+  }
+
+  /** - strong scaling of the real modules */
+  FileContent fc;
+  ErrorMsg error_message;
+  char* input_argv[3] = {argv[0], argv[2], (argc > 3) ? argv[3] : nullptr};
+  if (InputModule::file_content_from_arguments((argc > 3) ? 3 : 2, input_argv, fc, error_message) == _FAILURE_) {
+    printf("\n\nError running input_init_from_arguments \n=>%s\n", error_message);
+    return _FAILURE_;
+  }
+  InputModule input_module(fc);
+  Tools::ThreadBudget::SetLimit(max_threads);
+
+  const std::vector<std::string> module_names = {"background", "thermodynamics", "perturbations", "primordial", "nonlinear", "transfer", "spectra", "lensing"};
+  std::vector<std::vector<double>> module_time(thread_counts.size(), std::vector<double>(module_names.size() + 1, 0.));
+
+  for (size_t index_threads = 0; index_threads < thread_counts.size(); ++index_threads) {
+    std::unique_ptr<InputModule> input{new InputModule(input_module)};
+    input->SetNumberOfThreads(thread_counts[index_threads]);
+    input->SetVerbose(0);
+    Cosmology cosmology{std::move(input)};
+
+    std::vector<double>& time = module_time[index_threads];
+    Clock::time_point module_start = Clock::now();
+    cosmology.GetBackgroundModule();
+    time[0] = SecondsSince(module_start);
+    module_start = Clock::now();
+    cosmology.GetThermodynamicsModule();
+    time[1] = SecondsSince(module_start);
+    module_start = Clock::now();
+    cosmology.GetPerturbationsModule();
+    time[2] = SecondsSince(module_start);
+    module_start = Clock::now();
+    cosmology.GetPrimordialModule();
+    time[3] = SecondsSince(module_start);
+    module_start = Clock::now();
+    cosmology.GetNonlinearModule();
+    time[4] = SecondsSince(module_start);
+    module_start = Clock::now();
+    cosmology.GetTransferModule();
+    time[5] = SecondsSince(module_start);
+    module_start = Clock::now();
+    cosmology.GetSpectraModule();
+    time[6] = SecondsSince(module_start);
+    module_start = Clock::now();
+    cosmology.GetLensingModule();
+    time[7] = SecondsSince(module_start);
+    for (size_t index_module = 0; index_module < module_names.size(); ++index_module) {
+      time.back() += time[index_module];
+    }
+  }
+
+  printf("\nstrong scaling of the modules for %s: wall time [s] (efficiency)\n", argv[2]);
+  printf("%-16s", "threads");
+  for (unsigned int threads : thread_counts) {
+    printf(" %16u", threads);
+  }
+  printf("\n");
+  for (size_t index_module = 0; index_module <= module_names.size(); ++index_module) {
+    printf("%-16s", (index_module < module_names.size()) ? module_names[index_module].c_str() : "total");
+    for (size_t index_threads = 0; index_threads < thread_counts.size(); ++index_threads) {
+      double time = module_time[index_threads][index_module];
+      double efficiency = module_time[0][index_module]/time/thread_counts[index_threads];
+      printf(" %9.4f (%4.2f)", time, efficiency);
+    }
+    printf("\n");
+  }
+
+  (void)sink;
+  return _SUCCESS_;
+}
@@ -0,0 +1,110 @@
+#include "arena.h"
+#include <cstdlib>
+
+namespace Tools {
+
+constexpr std::size_t Arena::kAlignment;
+constexpr std::size_t Arena::kPageSize;
+constexpr std::size_t Arena::kChunkSize;
+constexpr std::size_t Arena::kPoolSize;
+
+std::mutex Arena::pool_mutex_;
+std::vector<Arena*> Arena::pool_;
+
+/**
+ * Get an empty arena, recycled from the pool if possible. The most
+ * recently released arena is returned first, since its pages are the most
+ * likely to still be resident.
+ */
+std::shared_ptr<Arena> Arena::Acquire() {
+  Arena* arena = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(pool_mutex_);
+    if (!pool_.empty()) {
+      arena = pool_.back();
+      pool_.pop_back();
+    }
+  }
+  if (arena == nullptr) {
+    arena = new Arena();
+  }
+  return std::shared_ptr<Arena>(arena, &Arena::Release);
+}
+
+void Arena::Release(Arena* arena) {
+  arena->Reset();
+  {
+    std::lock_guard<std::mutex> lock(pool_mutex_);
+    if (pool_.size() < kPoolSize) {
+      pool_.push_back(arena);
+      return;
+    }
+  }
+  delete arena;
+}
+
+Arena::~Arena() {
+  for (const Chunk& chunk : chunks_) {
+    free(chunk.data);
+  }
+}
+
+/**
+ * Return a block of at least size bytes, aligned to kAlignment, or
+ * nullptr if the system is out of memory. The chunks are tried in the
+ * order in which they were created, so that a cosmology requesting the
+ * same sequence of tables as the previous user of the arena gets exactly
+ * the same layout and no new chunk.
+ */
+void* Arena::Allocate(std::size_t size) {
+  size = (size + kAlignment - 1)/kAlignment*kAlignment;
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (; current_chunk_ < chunks_.size(); ++current_chunk_) {
+    Chunk& chunk = chunks_[current_chunk_];
+    if (chunk.size - chunk.used >= size) {
+      void* block = chunk.data + chunk.used;
+      chunk.used += size;
+      return block;
+    }
+  }
+  Chunk chunk;
+  chunk.size = (size > kChunkSize) ? (size + kPageSize - 1)/kPageSize*kPageSize : kChunkSize;
+  void* data = nullptr;
+  if (posix_memalign(&data, kPageSize, chunk.size) != 0) {
+    return nullptr;
+  }
+  chunk.data = static_cast<char*>(data);
+  chunk.used = size;
+  chunks_.push_back(chunk);
+  current_chunk_ = chunks_.size() - 1;
+  return chunk.data;
+}
+
+std::size_t Arena::BytesAllocated() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::size_t bytes = 0;
+  for (const Chunk& chunk : chunks_) {
+    bytes += chunk.used;
+  }
+  return bytes;
+}
+
+std::size_t Arena::BytesReserved() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::size_t bytes = 0;
+  for (const Chunk& chunk : chunks_) {
+    bytes += chunk.size;
+  }
+  return bytes;
+}
+
+/** Forget all tables at once; the chunks are kept for the next user. */
+void Arena::Reset() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (Chunk& chunk : chunks_) {
+    chunk.used = 0;
+  }
+  current_chunk_ = 0;
+}
+
+}
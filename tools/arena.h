@@ -0,0 +1,58 @@
+#ifndef ARENA_H
+#define ARENA_H
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Tools {
+
+/**
+ * Bump allocator for the long-lived tables of one cosmology.
+ *
+ * Memory is taken from the system in large page-aligned chunks and handed
+ * out by advancing a pointer; individual tables are never freed. When the
+ * last owner of the arena goes away, the arena is reset and parked in a
+ * small process-wide pool instead of returning its chunks to the system,
+ * so that the next cosmology computed with the same grid sizes finds the
+ * same chunks, already mapped, in the same order.
+ *
+ * Allocate() may be called from several threads at once.
+ */
+class Arena {
+public:
+  static std::shared_ptr<Arena> Acquire();
+  ~Arena();
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  void* Allocate(std::size_t size);
+  std::size_t BytesAllocated() const;
+  std::size_t BytesReserved() const;
+
+  static constexpr std::size_t kAlignment = 64;              /**< alignment of each table (one cache line) */
+  static constexpr std::size_t kPageSize = 4096;             /**< alignment and granularity of the chunks */
+  static constexpr std::size_t kChunkSize = 16*1024*1024;    /**< default chunk size; larger tables get a chunk of their own */
+  static constexpr std::size_t kPoolSize = 4;                /**< largest number of idle arenas kept for recycling */
+
+private:
+  struct Chunk {
+    char* data;
+    std::size_t size;
+    std::size_t used;
+  };
+
+  Arena() = default;
+  void Reset();
+  static void Release(Arena* arena);
+
+  std::vector<Chunk> chunks_;
+  std::size_t current_chunk_ = 0;
+  mutable std::mutex mutex_;
+
+  static std::mutex pool_mutex_;
+  static std::vector<Arena*> pool_;
+};
+
+}
+#endif //ARENA_H
@@ -708,6 +708,165 @@ int array_spline_table_lines(
   return _SUCCESS_;
  }
 
+/**
+ * Line-by-line version of array_spline_table_lines(), for tables that are
+ * filled and splined in the same sweep. Calling
+ * array_spline_table_line_forward() for index_x = 0, ..., x_size-2 and then
+ * array_spline_table_lines_backward() gives exactly the same ddy_array as
+ * array_spline_table_lines().
+ *
+ * array_spline_table_line_forward() performs the elimination step of line
+ * index_x, which only reads the lines up to index_x+1 (up to line 2 for
+ * index_x = 0) of x and y_array. The workspace u has x_size*y_size elements
+ * and must be passed unchanged to array_spline_table_lines_backward().
+ */
+int array_spline_table_line_forward(
+				    double * x, /* vector of size x_size */
+				    int x_size,
+				    double * y_array, /* array of size x_size*y_size with elements
+							 y_array[index_x*y_size+index_y] */
+				    int y_size,
+				    double * ddy_array, /* array of size x_size*y_size */
+				    double * u, /* workspace of size x_size*y_size */
+				    int index_x,
+				    short spline_mode,
+				    ErrorMsg errmsg
+				    ) {
+
+  double p;
+  double sig;
+  int index_y;
+  double dy_first;
+
+  if (x_size==2) spline_mode = _SPLINE_NATURAL_;
+
+  if (index_x == 0) {
+    if (spline_mode == _SPLINE_NATURAL_) {
+      for (index_y=0; index_y < y_size; index_y++) {
+	ddy_array[index_y] = u[index_y] = 0.0;
+      }
+    }
+    else if (spline_mode == _SPLINE_EST_DERIV_) {
+      for (index_y=0; index_y < y_size; index_y++) {
+
+	dy_first =
+	  ((x[2]-x[0])*(x[2]-x[0])*
+	   (y_array[1*y_size+index_y]-y_array[0*y_size+index_y])-
+	   (x[1]-x[0])*(x[1]-x[0])*
+	   (y_array[2*y_size+index_y]-y_array[0*y_size+index_y]))/
+	  ((x[2]-x[0])*(x[1]-x[0])*(x[2]-x[1]));
+
+	ddy_array[index_y] = -0.5;
+
+	u[index_y] =
+	  (3./(x[1] -  x[0]))*
+	  ((y_array[1*y_size+index_y]-y_array[0*y_size+index_y])/
+	   (x[1] - x[0])-dy_first);
+      }
+    }
+    else {
+      sprintf(errmsg,"%s(L:%d) Spline mode not identified: %d",__func__,__LINE__,spline_mode);
+      return _FAILURE_;
+    }
+    return _SUCCESS_;
+  }
+
+  if ((index_x < 0) || (index_x > x_size-2)) {
+    sprintf(errmsg,"%s(L:%d) Line %d out of range [0, %d]",__func__,__LINE__,index_x,x_size-2);
+    return _FAILURE_;
+  }
+
+  sig = (x[index_x] - x[index_x-1])/(x[index_x+1] - x[index_x-1]);
+
+  for (index_y=0; index_y < y_size; index_y++) {
+
+    p = sig * ddy_array[(index_x-1)*y_size+index_y] + 2.0;
+
+    ddy_array[index_x*y_size+index_y] = (sig-1.0)/p;
+
+    u[index_x*y_size+index_y] =
+      (y_array[(index_x+1)*y_size+index_y] - y_array[index_x*y_size+index_y])
+      / (x[index_x+1] - x[index_x])
+      - (y_array[index_x*y_size+index_y] - y_array[(index_x-1)*y_size+index_y])
+      / (x[index_x] - x[index_x-1]);
+
+    u[index_x*y_size+index_y] = (6.0 * u[index_x*y_size+index_y] /
+				 (x[index_x+1] - x[index_x-1])
+				 - sig * u[(index_x-1)*y_size+index_y]) / p;
+  }
+
+  return _SUCCESS_;
+}
+
+/**
+ * End condition and back substitution of array_spline_table_lines(), once
+ * array_spline_table_line_forward() has been called on lines 0 to x_size-2.
+ */
+int array_spline_table_lines_backward(
+				      double * x, /* vector of size x_size */
+				      int x_size,
+				      double * y_array, /* array of size x_size*y_size */
+				      int y_size,
+				      double * ddy_array, /* array of size x_size*y_size */
+				      double * u, /* workspace filled by array_spline_table_line_forward() */
+				      short spline_mode,
+				      ErrorMsg errmsg
+				      ) {
+
+  double qn;
+  double un;
+  int index_x;
+  int index_y;
+  double dy_last;
+
+  if (x_size==2) spline_mode = _SPLINE_NATURAL_;
+
+  if ((spline_mode != _SPLINE_NATURAL_) && (spline_mode != _SPLINE_EST_DERIV_)) {
+    sprintf(errmsg,"%s(L:%d) Spline mode not identified: %d",__func__,__LINE__,spline_mode);
+    return _FAILURE_;
+  }
+
+  index_x=x_size-1;
+
+  for (index_y=0; index_y < y_size; index_y++) {
+
+    if (spline_mode == _SPLINE_NATURAL_) {
+      qn=un=0.0;
+    }
+    else {
+
+      dy_last =
+	((x[x_size-3]-x[x_size-1])*(x[x_size-3]-x[x_size-1])*
+	 (y_array[(x_size-2)*y_size+index_y]-y_array[(x_size-1)*y_size+index_y])-
+	 (x[x_size-2]-x[x_size-1])*(x[x_size-2]-x[x_size-1])*
+	 (y_array[(x_size-3)*y_size+index_y]-y_array[(x_size-1)*y_size+index_y]))/
+	((x[x_size-3]-x[x_size-1])*(x[x_size-2]-x[x_size-1])*(x[x_size-3]-x[x_size-2]));
+
+      qn=0.5;
+
+      un=
+	(3./(x[x_size-1] - x[x_size-2]))*
+	(dy_last-(y_array[(x_size-1)*y_size+index_y] - y_array[(x_size-2)*y_size+index_y])/
+	 (x[x_size-1] - x[x_size-2]));
+    }
+
+    ddy_array[index_x*y_size+index_y] =
+      (un - qn * u[(index_x-1)*y_size+index_y]) /
+      (qn * ddy_array[(index_x-1)*y_size+index_y] + 1.0);
+  }
+
+  for (index_x=x_size-2; index_x >= 0; index_x--) {
+    for (index_y=0; index_y < y_size; index_y++) {
+
+      ddy_array[index_x*y_size+index_y] = ddy_array[index_x*y_size+index_y] *
+	ddy_array[(index_x+1)*y_size+index_y] + u[index_x*y_size+index_y];
+
+    }
+  }
+
+  return _SUCCESS_;
+}
+
 int array_logspline_table_lines(
 			     double * x, /* vector of size x_size */
 			     int x_size,
@@ -53,12 +53,35 @@
 	structure of the equations are nearly optimal for the LU decomposition, so we don't
 	want to mess it up by too many row permutations if we can avoid it. This is also why
 	do not use any column permutation to pre-order the matrix.
+
+	Warm restart:
+	When a solution is continued on the next interval with a different vector
+	of unknowns (e.g. after an approximation switch in the perturbation module),
+	evolver_ndf15_warm() can be called with a struct ndf15_warm_start, which
+	stores the order, the step size, the backward differences and the Jacobian
+	at the end of each call. The caller passes index_map[i-1], the index (from 0)
+	of component i in the previous vector, or -1 for a new component. The next
+	call then keeps the order and step size, takes the differences of all mapped
+	components from the previous interval and starts new components with the
+	first-order difference only. If every component is mapped, the previous
+	Jacobian is reused and recomputed only when the Newton iteration needs it.
+	The error control rejects and shrinks the first steps if the restart was
+	too optimistic.
+
+	Block output:
+	When the sampling t_vec[] is dense compared to the steps, several output
+	points fall inside each accepted step. If evolver_ndf15_warm() is given an
+	(*output_block) routine, it is called instead of (*output) with all these
+	points at once (up to NDF15_OUTPUT_BLOCK per call), interpolated together
+	by interp_from_dif_block(), so that the caller can process them as a block.
 */
 #include "common.h"
 #include "evolver_ndf15.h"
 //#include "perturbations.h"
 #include "sparse.h"
 
+static int numjac_sparse_pattern(struct jacobian *jac, int neq);
+
 int evolver_ndf15(
 		  int (*derivs)(double x,double * y,double * dy,
 				void * parameters_and_workspace, ErrorMsg error_message),
@@ -83,6 +106,40 @@ int evolver_ndf15(
 					 ErrorMsg error_message),
 		  ErrorMsg error_message){
 
+  return evolver_ndf15_warm(derivs,x_ini,x_final,y_inout,used_in_output,neq,
+			    parameters_and_workspace_for_derivs,rtol,minimum_variation,
+			    timescale_and_approximation,timestep_over_timescale,t_vec,tres,
+			    output,NULL,print_variables,NULL,NULL,error_message);
+}
+
+int evolver_ndf15_warm(
+		  int (*derivs)(double x,double * y,double * dy,
+				void * parameters_and_workspace, ErrorMsg error_message),
+		  double x_ini,
+		  double x_final,
+		  double * y_inout,
+		  int * used_in_output,
+		  int neq,
+		  void * parameters_and_workspace_for_derivs,
+		  double rtol,
+		  double minimum_variation,
+		  int (*timescale_and_approximation)(double x,
+						     void * parameters_and_workspace,
+						     double * timescales,
+						     ErrorMsg error_message),
+		  double timestep_over_timescale,
+		  double * t_vec,
+		  int tres,
+		  int (*output)(double x,double y[],double dy[],int index_x,void * parameters_and_workspace,
+				ErrorMsg error_message),
+		  int (*output_block)(double x[],double y[],double dy[],int index_x,int x_size,int y_stride,
+				      void * parameters_and_workspace,ErrorMsg error_message),
+		  int (*print_variables)(double x, double y[], double dy[], void *parameters_and_workspace,
+					 ErrorMsg error_message),
+		  struct ndf15_warm_start * warm_start,
+		  int * index_map,
+		  ErrorMsg error_message){
+
   /* Constants: */
   double G[5]={1.0,3.0/2.0,11.0/6.0,25.0/12.0,137.0/60.0};
   double alpha[5]={-37.0/200,-1.0/9.0,-8.23e-2,-4.15e-2, 0};
@@ -92,23 +149,25 @@ int evolver_ndf15(
 
   /* Logicals: */
   int Jcurrent,havrate,done,at_hmin,nofailed,gotynew,tooslow,*interpidx;
+  int warm,warm_jacobian;
 
   /* Storage: */
   double *f0,*y,*wt,*ddfddt,*pred,*ynew,*invwt,*rhs,*psi,*difkp1,*del,*yinterp;
   double *tempvec1,*tempvec2,*ypinterp,*yppinterp;
+  double *yblock=NULL,*dyblock=NULL;
   double **dif;
   struct jacobian jac;
   struct numjac_workspace nj_ws;
 
   /* Method variables: */
   double t,t0,tfinal,tnew=0;
-  double rh,htspan,absh,hmin,hmax,h,tdel;
+  double rh,htspan,absh,hmin,hmax,h,tdel,abshnext;
   double abshlast,hinvGak,minnrm,oldnrm=0.,newnrm;
   double err,hopt,errkm1,hkm1,errit,rate=0.,temp,errkp1,hkp1,maxtmp;
   int k,klast,nconhk,iter,next,kopt,tdir;
 
   /* Misc: */
-  int stepstat[6],nfenj,j,ii,jj, numidx, neqp=neq+1;
+  int stepstat[6],nfenj,j,ii,jj,im,jm,numidx,nblock,neqp=neq+1;
   int verbose=0;
 
   /** Allocate memory . */
@@ -172,6 +231,11 @@ int evolver_ndf15(
 
   class_alloc(interpidx, sizeof(int)*neqp, error_message);
 
+  if (output_block != NULL){
+    class_calloc(yblock, 2*NDF15_OUTPUT_BLOCK*neq, sizeof(double), error_message);
+    dyblock = yblock+NDF15_OUTPUT_BLOCK*neq;
+  }
+
   /* Allocate vector of pointers to rows of dif:*/
   /* 	class_alloc(dif,sizeof(double*)*neqp,error_message);  */
   /* 	class_calloc(dif[1],(7*neq+1),sizeof(double),error_message); */
@@ -233,61 +297,118 @@ int evolver_ndf15(
   hmax = (tfinal-t0)/10.0;
   t = t0;
 
+  /* Can we continue from the state left by the previous call? */
+  warm = ((warm_start != NULL) && (index_map != NULL) && (warm_start->has_state == _TRUE_));
+  warm_jacobian = warm;
+  if (warm == _TRUE_){
+    for(ii=1;ii<=neq;ii++){
+      class_test(index_map[ii-1] >= warm_start->neq, error_message,
+		 "index_map[%d]=%d out of range, previous vector has %d components",
+		 ii-1,index_map[ii-1],warm_start->neq);
+      if (index_map[ii-1] < 0){
+	warm_jacobian = _FALSE_;
+      }
+      else{
+	jac.jacvec[ii] = warm_start->jacvec[index_map[ii-1]];
+      }
+    }
+  }
 
-  nfenj=0;
-  class_call(numjac((*derivs),t,y,f0,&jac,&nj_ws,abstol,neq,
-		    &nfenj,parameters_and_workspace_for_derivs,error_message),
-	     error_message,error_message);
-  stepstat[3] += 1;
-  stepstat[2] += nfenj;
-  Jcurrent = _TRUE_; /* True */
+  if (warm_jacobian == _TRUE_){
+    /* Every component existed before: map the previous Jacobian. */
+    for(ii=1;ii<=neq;ii++){
+      im = index_map[ii-1];
+      for(jj=1;jj<=neq;jj++){
+	jm = index_map[jj-1];
+	jac.dfdy[ii][jj] = warm_start->dfdy[im*warm_start->neq+jm];
+      }
+    }
+    jac.new_jacobian = _TRUE_;
+    if (jac.use_sparse){
+      numjac_sparse_pattern(&jac,neq);
+    }
+    Jcurrent = _FALSE_;
+  }
+  else{
+    nfenj=0;
+    class_call(numjac((*derivs),t,y,f0,&jac,&nj_ws,abstol,neq,
+		      &nfenj,parameters_and_workspace_for_derivs,error_message),
+	       error_message,error_message);
+    stepstat[3] += 1;
+    stepstat[2] += nfenj;
+    Jcurrent = _TRUE_; /* True */
+  }
 
   hmin = 16.0*eps*fabs(t);
-  /*Calculate initial step */
-  rh = 0.0;
 
-  for(jj=1;jj<=neq;jj++){
-    wt[jj] = MAX(fabs(y[jj]),threshold);
-    /*printf("wt: %4.8f \n",wt[jj]);*/
-    rh = MAX(rh,1.25/sqrt(rtol)*fabs(f0[jj]/wt[jj]));
+  if (warm == _TRUE_){
+    /* Continue with the order and step size of the previous interval.
+       The differences are those of the previous step; new components
+       only get the first-order difference. */
+    k = warm_start->k;
+    abshlast = warm_start->absh;
+    for(ii=1;ii<=neq;ii++){
+      im = index_map[ii-1];
+      if (im >= 0){
+	for(jj=1;jj<=7;jj++) dif[ii][jj] = warm_start->dif[im*7+jj-1];
+      }
+      else{
+	dif[ii][1] = tdir*abshlast*f0[ii];
+      }
+    }
+    absh = MIN(MIN(hmax, htspan), warm_start->absh_next);
+    absh = MAX(absh, hmin);
+    adjust_stepsize(dif,(absh/abshlast),neq,k);
+    h = tdir * absh;
   }
+  else{
+    /*Calculate initial step */
+    rh = 0.0;
 
-  absh = MIN(hmax, htspan);
-  if (absh * rh > 1.0) absh = 1.0 / rh;
+    for(jj=1;jj<=neq;jj++){
+      wt[jj] = MAX(fabs(y[jj]),threshold);
+      /*printf("wt: %4.8f \n",wt[jj]);*/
+      rh = MAX(rh,1.25/sqrt(rtol)*fabs(f0[jj]/wt[jj]));
+    }
 
-  absh = MAX(absh, hmin);
-  h = tdir * absh;
-  tdel = (t + tdir*MIN(sqrt(eps)*MAX(fabs(t),fabs(t+h)),absh)) - t;
+    absh = MIN(hmax, htspan);
+    if (absh * rh > 1.0) absh = 1.0 / rh;
 
-  class_call((*derivs)(t+tdel,y+1,tempvec1+1,parameters_and_workspace_for_derivs,error_message),
-	     error_message,error_message);
-  stepstat[2] += 1;
+    absh = MAX(absh, hmin);
+    h = tdir * absh;
+    tdel = (t + tdir*MIN(sqrt(eps)*MAX(fabs(t),fabs(t+h)),absh)) - t;
 
-  /*I assume that a full jacobi matrix is always calculated in the beginning...*/
-  for(ii=1;ii<=neq;ii++){
-    ddfddt[ii]=0.0;
-    for(jj=1;jj<=neq;jj++){
-      ddfddt[ii]+=(jac.dfdy[ii][jj])*f0[jj];
+    class_call((*derivs)(t+tdel,y+1,tempvec1+1,parameters_and_workspace_for_derivs,error_message),
+	       error_message,error_message);
+    stepstat[2] += 1;
+
+    /*I assume that a full jacobi matrix is always calculated in the beginning...*/
+    for(ii=1;ii<=neq;ii++){
+      ddfddt[ii]=0.0;
+      for(jj=1;jj<=neq;jj++){
+	ddfddt[ii]+=(jac.dfdy[ii][jj])*f0[jj];
+      }
     }
-  }
 
-  rh = 0.0;
-  for(ii=1;ii<=neq;ii++){
-    ddfddt[ii] += (tempvec1[ii] - f0[ii]) / tdel;
-    rh = MAX(rh,1.25*sqrt(0.5*fabs(ddfddt[ii]/wt[ii])/rtol));
+    rh = 0.0;
+    for(ii=1;ii<=neq;ii++){
+      ddfddt[ii] += (tempvec1[ii] - f0[ii]) / tdel;
+      rh = MAX(rh,1.25*sqrt(0.5*fabs(ddfddt[ii]/wt[ii])/rtol));
+    }
+    absh = MIN(hmax, htspan);
+    if (absh * rh > 1.0) absh = 1.0 / rh;
+
+    absh = MAX(absh, hmin);
+    h = tdir * absh;
+    /* Done calculating initial step
+       Get ready to do the loop:*/
+    k = 1;			/*start at order 1 with BDF1	*/
+
+    for(ii=1;ii<=neq;ii++) dif[ii][1] = h*f0[ii];
   }
-  absh = MIN(hmax, htspan);
-  if (absh * rh > 1.0) absh = 1.0 / rh;
-
-  absh = MAX(absh, hmin);
-  h = tdir * absh;
-  /* Done calculating initial step
-     Get ready to do the loop:*/
-  k = 1;			/*start at order 1 with BDF1	*/
   klast = k;
   abshlast = absh;
-
-  for(ii=1;ii<=neq;ii++) dif[ii][1] = h*f0[ii];
+  abshnext = absh;
 
   hinvGak = h*invGa[k-1];
   nconhk = 0; 	/*steps taken with current h and k*/
@@ -317,6 +438,7 @@ int evolver_ndf15(
       at_hmin = _FALSE_;
     }
     h = tdir * absh;
+    abshnext = absh;
     /* Stretch the step if within 10% of tfinal-t. */
     if (1.1*absh >= fabs(tfinal - t)){
       h = tfinal - t;
@@ -465,6 +587,7 @@ int evolver_ndf15(
 	  else{
 	    abshlast = absh;
 	    absh = MAX(0.3 * absh, hmin);
+	    abshnext = MIN(abshnext, absh);
 	    h = tdir * absh;
 	    done = _FALSE_;
 	    adjust_stepsize(dif,(absh/abshlast),neq,k);
@@ -514,6 +637,7 @@ int evolver_ndf15(
 	else{
 	  absh = MAX(hmin, 0.5 * absh);
 	}
+	abshnext = MIN(abshnext, absh);
 	h = tdir * absh;
 	if (absh < abshlast){
 	  done = _FALSE_;
@@ -544,6 +668,28 @@ int evolver_ndf15(
       }
     }
     /** Output **/
+    /* With output_block, all sampling points inside the step are interpolated
+       together and passed as one block (at most NDF15_OUTPUT_BLOCK at a time). */
+    while ((output_block!=NULL)&&(next<tres)&&(tdir * (tnew - t_vec[next]) >= 0.0)){
+      nblock = 0;
+      while ((next+nblock<tres)&&(nblock<NDF15_OUTPUT_BLOCK)&&
+	     (tdir * (tnew - t_vec[next+nblock]) >= 0.0)&&(t_vec[next+nblock]!=tnew)){
+	nblock++;
+      }
+      if (nblock > 0){
+	interp_from_dif_block(t_vec+next,nblock,tnew,ynew,h,dif,k,yblock,dyblock,interpidx,neq);
+      }
+      else {
+	/* Sample value at the end of the step: no need to interpolate */
+	memcpy(yblock,ynew+1,neq*sizeof(double));
+	memcpy(dyblock,f0+1,neq*sizeof(double));
+	nblock = 1;
+      }
+      class_call((*output_block)(t_vec+next,yblock,dyblock,next,nblock,neq,
+				 parameters_and_workspace_for_derivs,error_message),
+		 error_message,error_message);
+      next += nblock;
+    }
     while ((next<tres)&&(tdir * (tnew - t_vec[next]) >= 0.0)){
       /* Do we need to write output? */
       if (tnew==t_vec[next]){
@@ -668,6 +814,39 @@ int evolver_ndf15(
 	       error_message,error_message);
   }
 
+  if (warm_start != NULL){
+    /* Store the state needed to continue on the next interval. */
+    if (neq > warm_start->neq_max){
+      class_realloc(warm_start->dif,warm_start->dif,sizeof(double)*7*neq,error_message);
+      class_realloc(warm_start->dfdy,warm_start->dfdy,sizeof(double)*neq*neq,error_message);
+      class_realloc(warm_start->jacvec,warm_start->jacvec,sizeof(double)*neq,error_message);
+      warm_start->neq_max = neq;
+    }
+    warm_start->neq = neq;
+    warm_start->k = k;
+    warm_start->absh = absh;
+    warm_start->absh_next = abshnext;
+    for(ii=1;ii<=neq;ii++){
+      for(jj=1;jj<=7;jj++) warm_start->dif[(ii-1)*7+jj-1] = dif[ii][jj];
+      warm_start->jacvec[ii-1] = jac.jacvec[ii];
+    }
+    if ((jac.use_sparse)&&(jac.repeated_pattern >= jac.trust_sparse)){
+      /* numjac only updated the sparse representation */
+      for(ii=0;ii<neq*neq;ii++) warm_start->dfdy[ii] = 0.0;
+      for(jj=0;jj<neq;jj++){
+	for(ii=jac.spJ->Ap[jj];ii<jac.spJ->Ap[jj+1];ii++){
+	  warm_start->dfdy[jac.spJ->Ai[ii]*neq+jj] = jac.xjac[ii];
+	}
+      }
+    }
+    else{
+      for(ii=1;ii<=neq;ii++){
+	for(jj=1;jj<=neq;jj++) warm_start->dfdy[(ii-1)*neq+jj-1] = jac.dfdy[ii][jj];
+      }
+    }
+    warm_start->has_state = _TRUE_;
+  }
+
   if (verbose > 0){
     printf("\n End of evolver. Next=%d, t=%e and tnew=%e.",next,t,tnew);
     printf("\n Statistics: [%d %d %d %d %d %d] \n",stepstat[0],stepstat[1],
@@ -695,6 +874,7 @@ int evolver_ndf15(
   /* 	free(tempvec2); */
 
   free(interpidx);
+  if (output_block != NULL) free(yblock);
   /* 	free(dif[1]); */
   /* 	free(dif); */
 
@@ -904,6 +1084,58 @@ int interp_from_dif(double tinterp,
   return _SUCCESS_;
 }
 
+/* Same as interp_from_dif() with output=2, for tinterp_size <= NDF15_OUTPUT_BLOCK
+   points at once: each row of dif is read once for all points. The result for
+   point i is stored from 0 in yinterp[i*neq] and ypinterp[i*neq]. */
+int interp_from_dif_block(double *tinterp,
+                          int tinterp_size,
+                          double tnew,
+                          double *ynew,
+                          double h,
+                          double **dif,
+                          int k,
+                          double *yinterp,
+                          double *ypinterp,
+                          int *mask,
+                          int neq){
+  double fact,prod,sumfrac;
+  double vecy[NDF15_OUTPUT_BLOCK][5];
+  double vecdy[NDF15_OUTPUT_BLOCK][5];
+  int i, j, index_x;
+  double s, sumtmp, sumtmp2;
+
+  for (i=0; i<tinterp_size; i++){
+    s = (tinterp[i] - tnew)/h;
+
+    prod = 1.0;
+    sumfrac = 0.;
+    fact = 1.0;
+    for (j=0; j<k; j++){
+      prod *= (s+j);
+      fact *= (j+1);
+      sumfrac += 1.0/(s+j);
+      vecy[i][j] = prod/fact;
+      vecdy[i][j] = prod*sumfrac/(h*fact);
+    }
+  }
+
+  for (index_x=1; index_x<=neq; index_x++){
+    if (mask[index_x]==_TRUE_){
+      for (i=0; i<tinterp_size; i++){
+        sumtmp = 0;
+        sumtmp2 = 0;
+        for (j=0; j<k; j++){
+          sumtmp += vecy[i][j]*dif[index_x][j+1];
+          sumtmp2 += vecdy[i][j]*dif[index_x][j+1];
+        }
+        yinterp[i*neq+index_x-1] = ynew[index_x] + sumtmp;
+        ypinterp[i*neq+index_x-1] = sumtmp2;
+      }
+    }
+  }
+  return _SUCCESS_;
+}
+
 int adjust_stepsize(double **dif, double abshdivabshlast, int neq,int k){
   double mydifU[5][5]={{-1,-2,-3,-4,-5},{0,1,3,6,10},{0,0,-1,-4,-10},{0,0,0,1,5},{0,0,0,0,-1}};
   double tempvec[5];
@@ -1197,11 +1429,11 @@ int numjac(
   */
   double eps=1e-16, br=pow(eps,0.875),bl=pow(eps,0.75),bu=pow(eps,0.25);
   double facmin=pow(eps,0.78),facmax=0.1;
-  int logjpos, pattern_broken;
+  int logjpos;
   double tmpfac,difmax2=0.,del2,ffscale;
   int i,j,rowmax2;
   double maxval1,maxval2;
-  int colmax,group,row,nz,nz2;
+  int colmax,group,row;
   double Fdiff_absrm,Fdiff_new;
   double **dFdy,*fac;
   int *Ap=NULL, *Ai=NULL;
@@ -1438,79 +1670,108 @@ int numjac(
      If I do this cleverly, I only have to walk through the jacobian once, and I don't need any local storage.*/
 
   if ((jac->use_sparse)&&(jac->repeated_pattern < jac->trust_sparse)){
-    nz=0; /*Number of non-zeros */
-    Ap[0]=0; /*<-Always is.. */
-    pattern_broken = _FALSE_;
-    for(j=1;j<=neq;j++){
-      for(i=1;i<=neq;i++){
-	if ((i==j)||(fabs(dFdy[i][j])!=0.0)){
-	  /* Diagonal or non-zero index found. */
-	  if (nz>=jac->max_nonzero){
-	    /* Too many non-zero points to take advantage of sparsity.*/
-	    jac->use_sparse = 0;
-	    break;
-	  }
-	  /* Test pattern if it is still unbroken: */
-	  /* Two conditions must be met if the pattern is intact: Ap[j-1]<=nz<Ap[j],
-	     so that we are in the right column, and (i-1) must exist in column. Ai[nz]*/
-	  /* We should first test if nz is in the column, otherwise pattern is dead:*/
-	  if ((pattern_broken==_FALSE_)&&(jac->has_pattern==_TRUE_)){
-	    if ((nz<Ap[j-1])||(nz>=Ap[j])){
-	      /* If we are no longer in the right column, pattern is broken for sure. */
-	      pattern_broken = _TRUE_;
-	    }
+    numjac_sparse_pattern(jac,neq);
+  }
+  return _SUCCESS_;
+} /* End of numjac */
+
+/* Deduce the sparsity pattern from the dense Jacobian jac->dfdy, compare
+   it with the previous pattern, and write the sparse Jacobian. */
+static int numjac_sparse_pattern(struct jacobian *jac, int neq){
+  double **dFdy = jac->dfdy;
+  int *Ap = jac->spJ->Ap;
+  int *Ai = jac->spJ->Ai;
+  int i,j,nz,nz2,pattern_broken;
+
+  nz=0; /*Number of non-zeros */
+  Ap[0]=0; /*<-Always is.. */
+  pattern_broken = _FALSE_;
+  for(j=1;j<=neq;j++){
+    for(i=1;i<=neq;i++){
+      if ((i==j)||(fabs(dFdy[i][j])!=0.0)){
+	/* Diagonal or non-zero index found. */
+	if (nz>=jac->max_nonzero){
+	  /* Too many non-zero points to take advantage of sparsity.*/
+	  jac->use_sparse = 0;
+	  break;
+	}
+	/* Test pattern if it is still unbroken: */
+	/* Two conditions must be met if the pattern is intact: Ap[j-1]<=nz<Ap[j],
+	   so that we are in the right column, and (i-1) must exist in column. Ai[nz]*/
+	/* We should first test if nz is in the column, otherwise pattern is dead:*/
+	if ((pattern_broken==_FALSE_)&&(jac->has_pattern==_TRUE_)){
+	  if ((nz<Ap[j-1])||(nz>=Ap[j])){
+	    /* If we are no longer in the right column, pattern is broken for sure. */
+	    pattern_broken = _TRUE_;
 	  }
-	  if ((pattern_broken==_FALSE_)&&(jac->has_pattern==_TRUE_)){
-	    /* Up to this point, the new jacobian has managed to fit in the old
-	       sparsity pattern..*/
-	    if (Ai[nz]!=(i-1)){
-	      /* The current non-zero rownumber does not fit the current entry in the
-		 sparse matrix. Pattern MIGHT be broken. Scan ahead in the sparse matrix
-		 to search for the row entry: (Remember: the indices are sorted..)*/
-	      pattern_broken = _TRUE_;
-	      for(nz2=nz; (nz2<Ap[j])&&(Ai[nz2]<=(i-1)); nz2++){
-		/* Go through the rest of the column with the added constraint that
-		   the row index in the sparse matrix should be smaller than the current
-		   row index i-1:*/
-		if (Ai[nz2]==(i-1)){
-		  /* sparsity pattern recovered.. */
-		  pattern_broken = _FALSE_;
-		  nz = nz2;
-		  break;
-		}
-		/* Write a zero entry in the sparse matrix, in case we recover pattern. */
-		jac->xjac[nz2] = 0.0;
+	}
+	if ((pattern_broken==_FALSE_)&&(jac->has_pattern==_TRUE_)){
+	  /* Up to this point, the new jacobian has managed to fit in the old
+	     sparsity pattern..*/
+	  if (Ai[nz]!=(i-1)){
+	    /* The current non-zero rownumber does not fit the current entry in the
+	       sparse matrix. Pattern MIGHT be broken. Scan ahead in the sparse matrix
+	       to search for the row entry: (Remember: the indices are sorted..)*/
+	    pattern_broken = _TRUE_;
+	    for(nz2=nz; (nz2<Ap[j])&&(Ai[nz2]<=(i-1)); nz2++){
+	      /* Go through the rest of the column with the added constraint that
+		 the row index in the sparse matrix should be smaller than the current
+		 row index i-1:*/
+	      if (Ai[nz2]==(i-1)){
+		/* sparsity pattern recovered.. */
+		pattern_broken = _FALSE_;
+		nz = nz2;
+		break;
 	      }
+	      /* Write a zero entry in the sparse matrix, in case we recover pattern. */
+	      jac->xjac[nz2] = 0.0;
 	    }
 	  }
-	  /* The following works no matter the status of the pattern: */
-	  /* Write row_number: */
-	  Ai[nz] = i-1;
-	  /* Write value: */
-	  jac->xjac[nz] = dFdy[i][j];
-	  nz++;
 	}
+	/* The following works no matter the status of the pattern: */
+	/* Write row_number: */
+	Ai[nz] = i-1;
+	/* Write value: */
+	jac->xjac[nz] = dFdy[i][j];
+	nz++;
       }
-      /* Break this loop too if I have hit max non-zero points: */
-      if (jac->use_sparse==_FALSE_) break;
-      Ap[j]=nz;
-    }
-    if (jac->use_sparse==_TRUE_){
-      if ((jac->has_pattern==_TRUE_)&&(pattern_broken==_FALSE_)){
-	/*New jacobian fitted into the current sparsity pattern:*/
-	jac->repeated_pattern++;
-	/* printf("\n Found repeated pattern. nz=%d/%d and
-	   rep.pat=%d.",nz,neq*neq,jac->repeated_pattern); */
-      }
-      else{
-	/*Something has changed (or first run), better still do the full calculation..*/
-	jac->repeated_pattern = 0;
-      }
-      jac->has_pattern = 1;
     }
+    /* Break this loop too if I have hit max non-zero points: */
+    if (jac->use_sparse==_FALSE_) break;
+    Ap[j]=nz;
+  }
+  if (jac->use_sparse==_TRUE_){
+    if ((jac->has_pattern==_TRUE_)&&(pattern_broken==_FALSE_)){
+      /*New jacobian fitted into the current sparsity pattern:*/
+      jac->repeated_pattern++;
+      /* printf("\n Found repeated pattern. nz=%d/%d and
+	 rep.pat=%d.",nz,neq*neq,jac->repeated_pattern); */
+    }
+    else{
+      /*Something has changed (or first run), better still do the full calculation..*/
+      jac->repeated_pattern = 0;
+    }
+    jac->has_pattern = 1;
   }
   return _SUCCESS_;
-} /* End of numjac */
+}
+
+int ndf15_warm_start_init(struct ndf15_warm_start *warm_start){
+  warm_start->has_state = _FALSE_;
+  warm_start->neq = 0;
+  warm_start->neq_max = 0;
+  warm_start->dif = NULL;
+  warm_start->dfdy = NULL;
+  warm_start->jacvec = NULL;
+  return _SUCCESS_;
+}
+
+int ndf15_warm_start_free(struct ndf15_warm_start *warm_start){
+  free(warm_start->dif);
+  free(warm_start->dfdy);
+  free(warm_start->jacvec);
+  return ndf15_warm_start_init(warm_start);
+}
 
 int initialize_jacobian(struct jacobian *jac, int neq, ErrorMsg error_message){
   int i;
@@ -0,0 +1,84 @@
+#include "grid_service.h"
+#include "common.h"
+#include <algorithm>
+
+namespace Tools {
+
+Grid::Grid(const double* nodes, int size)
+: nodes_(new double[size > 0 ? size : 1])
+, size_(size) {
+  std::copy(nodes, nodes + size, nodes_.get());
+}
+
+bool Grid::HasNodes(const double* nodes, int size) const {
+  return (size == size_) && std::equal(nodes, nodes + size, nodes_.get());
+}
+
+/**
+ * Register the nodes of a grid under a name, and return the grid holding
+ * them. If a grid with exactly the same nodes already exists, under any
+ * name, that grid is returned and the name becomes an alias for it.
+ * Publishing different nodes under a name already in use is an error, and
+ * returns nullptr.
+ */
+const Grid* GridService::Publish(const std::string& name, const double* nodes, int size) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto named = grid_names_.find(name);
+  if (named != grid_names_.end()) {
+    return named->second->HasNodes(nodes, size) ? named->second : nullptr;
+  }
+  for (const auto& grid : grids_) {
+    if (grid->HasNodes(nodes, size)) {
+      grid_names_[name] = grid.get();
+      return grid.get();
+    }
+  }
+  grids_.emplace_back(new Grid(nodes, size));
+  grid_names_[name] = grids_.back().get();
+  return grids_.back().get();
+}
+
+/**
+ * Grid published under this name, or nullptr if there is none.
+ */
+const Grid* GridService::Find(const std::string& name) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto named = grid_names_.find(name);
+  return (named != grid_names_.end()) ? named->second : nullptr;
+}
+
+/**
+ * Get the table table[index_node*columns + index_column] of a quantity on
+ * the nodes of a grid. The first call allocates the table and fills it
+ * with fill(); later calls return the same table without calling fill.
+ * The status of fill() is returned, and a table that could not be filled
+ * is discarded (*table is then NULL).
+ */
+int GridService::Tabulate(const Grid* grid, const std::string& quantity, int columns, const std::function<int(double* table)>& fill, double** table) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto key = std::make_pair(grid, quantity);
+  auto found = tables_.find(key);
+  if (found != tables_.end()) {
+    *table = found->second.get();
+    return _SUCCESS_;
+  }
+  std::unique_ptr<double[]> values(new double[std::max(grid->Size()*columns, 1)]);
+  *table = NULL;
+  if (fill(values.get()) == _FAILURE_) {
+    return _FAILURE_;
+  }
+  *table = values.get();
+  tables_[key] = std::move(values);
+  return _SUCCESS_;
+}
+
+/**
+ * Table of a quantity already tabulated on a grid, or nullptr.
+ */
+double* GridService::FindTable(const Grid* grid, const std::string& quantity) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto found = tables_.find(std::make_pair(grid, quantity));
+  return (found != tables_.end()) ? found->second.get() : nullptr;
+}
+
+}
@@ -0,0 +1,73 @@
+#ifndef GRID_SERVICE_H
+#define GRID_SERVICE_H
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Tools {
+
+/**
+ * Immutable list of sampling nodes (wavenumbers, conformal times, ...)
+ * registered in a GridService. The nodes are exposed as a plain array so
+ * that they can be passed to the array_*() routines; they must not be
+ * modified.
+ */
+class Grid {
+public:
+  Grid(const double* nodes, int size);
+  Grid(const Grid&) = delete;
+  Grid& operator=(const Grid&) = delete;
+
+  double* Nodes() const { return nodes_.get(); }
+  int Size() const { return size_; }
+  bool HasNodes(const double* nodes, int size) const;
+
+private:
+  std::unique_ptr<double[]> nodes_;
+  const int size_;
+};
+
+/**
+ * Sampling grids of one cosmology, shared by all its modules.
+ *
+ * The module that defines a grid publishes it under a name, and the
+ * modules working on the same nodes look it up instead of copying or
+ * rebuilding it. Publishing nodes identical to those of an existing grid
+ * returns that grid, so two stages sample on the same nodes exactly when
+ * they hold the same Grid, and can then skip any resampling between them.
+ *
+ * Tabulate() computes a table of values on the nodes of a grid once, and
+ * returns the same table to every later caller asking for the same
+ * quantity on that grid. Grids and tables live as long as the service,
+ * i.e. as long as the input module owning it and all the modules sharing
+ * this input.
+ *
+ * All functions may be called from several threads at once. The fill
+ * function of Tabulate() is called with the service locked and must not
+ * call the service itself.
+ */
+class GridService {
+public:
+  GridService() = default;
+  GridService(const GridService&) = delete;
+  GridService& operator=(const GridService&) = delete;
+
+  const Grid* Publish(const std::string& name, const double* nodes, int size);
+  const Grid* Find(const std::string& name) const;
+
+  int Tabulate(const Grid* grid, const std::string& quantity, int columns, const std::function<int(double* table)>& fill, double** table);
+  double* FindTable(const Grid* grid, const std::string& quantity) const;
+
+private:
+  std::vector<std::unique_ptr<Grid>> grids_;
+  std::map<std::string, const Grid*> grid_names_;
+  std::map<std::pair<const Grid*, std::string>, std::unique_ptr<double[]>> tables_;
+  mutable std::mutex mutex_;
+};
+
+}
+#endif //GRID_SERVICE_H
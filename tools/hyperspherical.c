@@ -772,11 +772,12 @@ int CF1_from_Gegenbauer(int l,
                             double beta,
                             double * __restrict__ sinK_vec,
                             int size_sinK_vec,
-                            double * __restrict__ Phi){
+                            double * __restrict__ Phi,
+                            ErrorMsg error_message){
   double e, w, w2, alpha, alpha2, t;
-  double S, Q, C, argu, Ai;
-  int airy_sign = 1, phisign = 1;
-  int index_sinK;
+  double S, C;
+  int phisign = 1;
+  int index_sinK, index_chunk, chunk_size;
   double one_over_alpha;
   double one_over_alpha2;
   double one_over_sqrt_one_plus_alpha2;
@@ -784,7 +785,12 @@ int CF1_from_Gegenbauer(int l,
   double one_over_e;
   double one_over_beta;
   double cscK;
-  double pow_argu_onesixth;
+  /* per-chunk buffers, so that the powers can be taken by the vector math layer */
+  double argu[_HYPER_CHUNK_];
+  double absQ[_HYPER_CHUNK_];
+  double pow_argu_onesixth[_HYPER_CHUNK_];
+  double pow_absQ[_HYPER_CHUNK_];
+  int airy_sign[_HYPER_CHUNK_];
 
   one_over_e = sqrt(l*(l+1.0));
   e = 1.0/one_over_e;
@@ -795,27 +801,48 @@ int CF1_from_Gegenbauer(int l,
   one_over_sqrt_one_plus_alpha2 = 1.0/sqrt(1.0+alpha2);
   sqrt_alpha=sqrt(alpha);
   one_over_beta = 1.0/beta;
-
-  for (index_sinK=0; index_sinK<size_sinK_vec; index_sinK++){
-    cscK=1.0/sinK_vec[index_sinK];
-    w = alpha*sinK_vec[index_sinK];
-    w2 = w*w;
-    if (alpha > cscK){
-      S = alpha*log((sqrt(w2-1.0)+sqrt(w2+alpha2))*one_over_sqrt_one_plus_alpha2)+
-        atan(one_over_alpha*sqrt((w2+alpha2)/(w2-1.0)))-M_PI_2;
-      airy_sign = -1;
+  C = 0.5*sqrt_alpha*one_over_beta;
+
+  for (index_chunk=0; index_chunk<size_sinK_vec; index_chunk+=_HYPER_CHUNK_){
+    chunk_size = MIN(_HYPER_CHUNK_, size_sinK_vec-index_chunk);
+
+    for (index_sinK=0; index_sinK<chunk_size; index_sinK++){
+      class_test(!vector_math_isfinite(sinK_vec[index_chunk+index_sinK]),
+                 error_message,
+                 "sinK=%g is not finite", sinK_vec[index_chunk+index_sinK]);
+      cscK=1.0/sinK_vec[index_chunk+index_sinK];
+      w = alpha*sinK_vec[index_chunk+index_sinK];
+      w2 = w*w;
+      if (alpha > cscK){
+        S = alpha*log((sqrt(w2-1.0)+sqrt(w2+alpha2))*one_over_sqrt_one_plus_alpha2)+
+          atan(one_over_alpha*sqrt((w2+alpha2)/(w2-1.0)))-M_PI_2;
+        airy_sign[index_sinK] = -1;
+      }
+      else{
+        t = sqrt(1.0-w2)/sqrt(1.0+w2*one_over_alpha2);
+        S = atanh(t)-alpha*atan(t*one_over_alpha);
+        airy_sign[index_sinK] = 1;
+      }
+      argu[index_sinK] = 1.5*S*one_over_e;
+      absQ[index_sinK] = fabs(cscK*cscK-alpha2);
+      class_test(!vector_math_isfinite(argu[index_sinK]) || !vector_math_isfinite(absQ[index_sinK]),
+                 error_message,
+                 "non-finite WKB argument at sinK=%g (l=%d, beta=%g)", sinK_vec[index_chunk+index_sinK], l, beta);
     }
-    else{
-      t = sqrt(1.0-w2)/sqrt(1.0+w2*one_over_alpha2);
-      S = atanh(t)-alpha*atan(t*one_over_alpha);
-      airy_sign = 1;
+
+    class_call(vector_pow(chunk_size, argu, 1.0/6.0, pow_argu_onesixth),
+               error_message,
+               error_message);
+    class_call(vector_pow(chunk_size, absQ, -0.25, pow_absQ),
+               error_message,
+               error_message);
+
+    for (index_sinK=0; index_sinK<chunk_size; index_sinK++){
+      cscK=1.0/sinK_vec[index_chunk+index_sinK];
+      t = pow_argu_onesixth[index_sinK]*pow_argu_onesixth[index_sinK];
+      Phi[index_chunk+index_sinK] = phisign*2.0*_SQRT_PI_*C*pow_argu_onesixth[index_sinK]*pow_absQ[index_sinK]*
+        airy_cheb_approx(airy_sign[index_sinK]*t*t)*cscK;
     }
-    argu = 1.5*S*one_over_e;
-    Q = cscK*cscK-alpha2;
-    C = 0.5*sqrt_alpha*one_over_beta;
-    pow_argu_onesixth = pow(argu,1.0/6.0);
-    Ai = airy_cheb_approx(airy_sign*pow(pow_argu_onesixth,4));
-    Phi[index_sinK] = phisign*2.0*_SQRT_PI_*C*pow_argu_onesixth*pow(fabs(Q),-0.25)*Ai*cscK;
   }
   return _SUCCESS_;
 }
@@ -6,12 +6,7 @@ std::shared_ptr<NonColdDarkMatter> NonColdDarkMatter::Create(FileContent* pfc, c
   ErrorMsg error_message;
   parser_read_int(pfc, "N_ncdm", &N_ncdm, &flag1, error_message);
   if ((flag1 == _TRUE_) && (N_ncdm > 0)) {
-    try {
-      return std::shared_ptr<NonColdDarkMatter>(new NonColdDarkMatter(pfc, ncdm_settings));
-    }
-    catch (...) {
-      return nullptr;
-    }
+    return std::shared_ptr<NonColdDarkMatter>(new NonColdDarkMatter(pfc, ncdm_settings));
   }
   else {
     return nullptr;
@@ -42,6 +37,9 @@ NonColdDarkMatter::~NonColdDarkMatter() {
   SafeFree(q_size_ncdm_bg_);
   SafeFree(q_size_ncdm_);
   SafeFree(ncdm_qmax_);
+  SafeFree(ncdm_quadrature_strategy_pt_);
+  SafeFree(ncdm_input_q_size_pt_);
+  SafeFree(ncdm_qmax_pt_);
   SafeFree(factor_ncdm_);
 
   SafeFree(q_ncdm_);
@@ -49,6 +47,8 @@ NonColdDarkMatter::~NonColdDarkMatter() {
   SafeFree(dlnf0_dlnq_ncdm_);
   SafeFree(q_ncdm_bg_);
   SafeFree(w_ncdm_bg_);
+  SafeFree(ncdm_of_input_);
+  SafeFree(fraction_of_input_);
 }
 
 
@@ -227,6 +227,26 @@ int NonColdDarkMatter::background_ncdm_init(FileContent* pfc, const NcdmSettings
   /* qmax, if relevant */
   class_read_list_of_doubles_or_default("Maximum q", ncdm_qmax_, 15, N_ncdm_);
 
+  /* The perturbation sampling follows the background one unless it is given separately: */
+  class_read_list_of_integers_or_default("Quadrature strategy perturbations", ncdm_quadrature_strategy_pt_, -1, N_ncdm_);
+  class_read_list_of_integers_or_default("Number of momentum bins perturbations", ncdm_input_q_size_pt_, -1, N_ncdm_);
+  class_read_list_of_doubles_or_default("Maximum q perturbations", ncdm_qmax_pt_, -1., N_ncdm_);
+  for (n = 0; n < N_ncdm_; n++) {
+    if (ncdm_quadrature_strategy_pt_[n] == -1) {
+      ncdm_quadrature_strategy_pt_[n] = ncdm_quadrature_strategy_[n];
+    }
+    if (ncdm_input_q_size_pt_[n] == -1) {
+      ncdm_input_q_size_pt_[n] = ncdm_input_q_size_[n];
+    }
+    if (ncdm_qmax_pt_[n] == -1.) {
+      ncdm_qmax_pt_[n] = ncdm_qmax_[n];
+    }
+    class_test((ncdm_quadrature_strategy_pt_[n] != qm_auto) && (ncdm_input_q_size_pt_[n] < 1),
+               errmsg,
+               "ncdm species %d uses a manual perturbation quadrature (strategy %d), please give 'Number of momentum bins perturbations'",
+               n + 1, ncdm_quadrature_strategy_pt_[n]);
+  }
+
   /* Read temperatures: */
   class_read_list_of_doubles_or_default("T_ncdm", T_ncdm_, T_ncdm_default_, N_ncdm_);
 
@@ -365,76 +385,31 @@ int NonColdDarkMatter::background_ncdm_init(FileContent* pfc, const NcdmSettings
       filenum++;
     }
 
-    /* Handle perturbation qsampling: */
-    if (ncdm_quadrature_strategy_[k] == qm_auto) {
-      /** Automatic q-sampling for this species */
-      class_alloc(q_ncdm_[k], _QUADRATURE_MAX_*sizeof(double), error_message_);
-      class_alloc(w_ncdm_[k], _QUADRATURE_MAX_*sizeof(double), error_message_);
-
-      class_call(get_qsampling(q_ncdm_[k],
-                               w_ncdm_[k],
-                               &(q_size_ncdm_[k]),
-                               _QUADRATURE_MAX_,
-                               ncdm_settings.tol_ncdm,
-                               pbadist.q,
-                               pbadist.tablesize,
-                               background_ncdm_test_function,
-                               background_ncdm_distribution,
-                               &pbadist,
-                               error_message_),
-                 error_message_,
-                 error_message_);
-      q_ncdm_[k] = (double*)realloc(q_ncdm_[k], q_size_ncdm_[k]*sizeof(double));
-      w_ncdm_[k] = (double*)realloc(w_ncdm_[k], q_size_ncdm_[k]*sizeof(double));
-
-      /* Handle background q_sampling: */
-      class_alloc(q_ncdm_bg_[k], _QUADRATURE_MAX_BG_*sizeof(double), error_message_);
-      class_alloc(w_ncdm_bg_[k], _QUADRATURE_MAX_BG_*sizeof(double), error_message_);
-
-      class_call(get_qsampling(q_ncdm_bg_[k],
-                               w_ncdm_bg_[k],
-                               &(q_size_ncdm_bg_[k]),
-                               _QUADRATURE_MAX_BG_,
-                               ncdm_settings.tol_ncdm_bg,
-                               pbadist.q,
-                               pbadist.tablesize,
-                               background_ncdm_test_function,
-                               background_ncdm_distribution,
-                               &pbadist,
-                               error_message_),
-                 error_message_,
-                 error_message_);
-
-
-      q_ncdm_bg_[k] = (double*)realloc(q_ncdm_bg_[k], q_size_ncdm_bg_[k]*sizeof(double));
-      w_ncdm_bg_[k] = (double*)realloc(w_ncdm_bg_[k], q_size_ncdm_bg_[k]*sizeof(double));
-    }
-    else{
-      /** Manual q-sampling for this species. Same sampling used for both perturbation and background sampling, since this will usually be a high precision setting anyway */
-      q_size_ncdm_bg_[k] = ncdm_input_q_size_[k];
-      q_size_ncdm_[k] = ncdm_input_q_size_[k];
-      class_alloc(q_ncdm_bg_[k], q_size_ncdm_bg_[k]*sizeof(double), error_message_);
-      class_alloc(w_ncdm_bg_[k], q_size_ncdm_bg_[k]*sizeof(double), error_message_);
-      class_alloc(q_ncdm_[k], q_size_ncdm_[k]*sizeof(double), error_message_);
-      class_alloc(w_ncdm_[k], q_size_ncdm_[k]*sizeof(double), error_message_);
-      class_call(get_qsampling_manual(q_ncdm_[k],
-                                      w_ncdm_[k],
-                                      q_size_ncdm_[k],
-                                      ncdm_qmax_[k],
-                                      (enum ncdm_quadrature_method)ncdm_quadrature_strategy_[k],
-                                      pbadist.q,
-                                      pbadist.tablesize,
-                                      background_ncdm_distribution,
-                                      &pbadist,
-                                      error_message_),
-                 error_message_,
-                 error_message_);
-      for (index_q = 0; index_q < q_size_ncdm_[k]; index_q++) {
-        q_ncdm_bg_[k][index_q] = q_ncdm_[k][index_q];
-        w_ncdm_bg_[k][index_q] = w_ncdm_[k][index_q];
-      }
-
-    }
+    /* Handle background q-sampling: */
+    class_call(background_ncdm_qsampling(&pbadist,
+                                         ncdm_quadrature_strategy_[k],
+                                         ncdm_input_q_size_[k],
+                                         ncdm_qmax_[k],
+                                         ncdm_settings.tol_ncdm_bg,
+                                         _QUADRATURE_MAX_BG_,
+                                         &q_ncdm_bg_[k],
+                                         &w_ncdm_bg_[k],
+                                         &q_size_ncdm_bg_[k]),
+               error_message_,
+               error_message_);
+
+    /* Handle perturbation q-sampling: */
+    class_call(background_ncdm_qsampling(&pbadist,
+                                         ncdm_quadrature_strategy_pt_[k],
+                                         ncdm_input_q_size_pt_[k],
+                                         ncdm_qmax_pt_[k],
+                                         ncdm_settings.tol_ncdm,
+                                         _QUADRATURE_MAX_,
+                                         &q_ncdm_[k],
+                                         &w_ncdm_[k],
+                                         &q_size_ncdm_[k]),
+               error_message_,
+               error_message_);
 
     class_alloc(dlnf0_dlnq_ncdm_[k],
                 q_size_ncdm_[k]*sizeof(double),
@@ -516,6 +491,236 @@ int NonColdDarkMatter::background_ncdm_init(FileContent* pfc, const NcdmSettings
       m_ncdm_in_eV_[n] = _k_B_/_eV_*T_ncdm_[n]*M_ncdm_[n]*ncdm_settings.T_cmb;
     }
   }
+
+  /* A manual perturbation sampling is not error-controlled by construction, so compare it to the background one: */
+  for (n = 0; n < N_ncdm_; n++) {
+    if (ncdm_quadrature_strategy_pt_[n] != qm_auto) {
+      class_call(background_ncdm_check_qsampling(n, ncdm_settings.tol_ncdm), error_message_, error_message_);
+    }
+  }
+
+  /* Map each input species to itself, then merge identical ones if requested: */
+  N_ncdm_input_ = N_ncdm_;
+  class_alloc(ncdm_of_input_, sizeof(int)*N_ncdm_input_, error_message_);
+  class_alloc(fraction_of_input_, sizeof(double)*N_ncdm_input_, error_message_);
+  for (n = 0; n < N_ncdm_input_; n++) {
+    ncdm_of_input_[n] = n;
+    fraction_of_input_[n] = 1.;
+  }
+  if (ncdm_settings.merge_identical_species == _TRUE_) {
+    class_call(background_ncdm_merge_identical(), error_message_, error_message_);
+  }
+
+  return _SUCCESS_;
+}
+
+/**
+ * Momentum sampling of one species, either automatic with relative
+ * tolerance tol on the test function, or manual with one of the fixed
+ * rules of the quadrature module.
+ *
+ * @param pbadist      Input: distribution function of the species
+ * @param strategy     Input: one of ncdm_quadrature_method
+ * @param input_q_size Input: number of points of a manual rule
+ * @param qmax         Input: maximum q of the truncated trapezoidal rule
+ * @param tol          Input: tolerance of the automatic rule
+ * @param q_size_max   Input: largest number of points of the automatic rule
+ * @param q            Output: allocated vector of momenta
+ * @param w            Output: allocated vector of weights
+ * @param q_size       Output: number of points
+ */
+
+int NonColdDarkMatter::background_ncdm_qsampling(background_parameters_for_distributions* pbadist, int strategy, int input_q_size, double qmax, double tol, int q_size_max,
+                                                 double** q, double** w, int* q_size) {
+  if (strategy == qm_auto) {
+    class_alloc(*q, q_size_max*sizeof(double), error_message_);
+    class_alloc(*w, q_size_max*sizeof(double), error_message_);
+
+    class_call(get_qsampling(*q,
+                             *w,
+                             q_size,
+                             q_size_max,
+                             tol,
+                             pbadist->q,
+                             pbadist->tablesize,
+                             background_ncdm_test_function,
+                             background_ncdm_distribution,
+                             pbadist,
+                             error_message_),
+               error_message_,
+               error_message_);
+    *q = (double*)realloc(*q, (*q_size)*sizeof(double));
+    *w = (double*)realloc(*w, (*q_size)*sizeof(double));
+  }
+  else {
+    *q_size = input_q_size;
+    class_alloc(*q, (*q_size)*sizeof(double), error_message_);
+    class_alloc(*w, (*q_size)*sizeof(double), error_message_);
+    class_call(get_qsampling_manual(*q,
+                                    *w,
+                                    *q_size,
+                                    qmax,
+                                    (enum ncdm_quadrature_method)strategy,
+                                    pbadist->q,
+                                    pbadist->tablesize,
+                                    background_ncdm_distribution,
+                                    pbadist,
+                                    error_message_),
+               error_message_,
+               error_message_);
+  }
+  return _SUCCESS_;
+}
+
+/**
+ * Check that the perturbation sampling of species n_ncdm reproduces the
+ * number density, and the energy density and pressure in the
+ * relativistic limit and today, of the background sampling to within a
+ * relative tolerance tol.
+ */
+
+int NonColdDarkMatter::background_ncdm_check_qsampling(int n_ncdm, double tol) const {
+  const char* names[4] = {"number density", "relativistic energy density", "energy density today", "pressure today"};
+  double moments_bg[4] = {0., 0., 0., 0.};
+  double moments_pt[4] = {0., 0., 0., 0.};
+  double M = M_ncdm_[n_ncdm];
+
+  for (int index_q = 0; index_q < q_size_ncdm_bg_[n_ncdm]; index_q++) {
+    double q = q_ncdm_bg_[n_ncdm][index_q];
+    double q2w = q*q*w_ncdm_bg_[n_ncdm][index_q];
+    double epsilon = sqrt(q*q + M*M);
+    moments_bg[0] += q2w;
+    moments_bg[1] += q2w*q;
+    moments_bg[2] += q2w*epsilon;
+    moments_bg[3] += q2w*q*q/epsilon;
+  }
+  for (int index_q = 0; index_q < q_size_ncdm_[n_ncdm]; index_q++) {
+    double q = q_ncdm_[n_ncdm][index_q];
+    double q2w = q*q*w_ncdm_[n_ncdm][index_q];
+    double epsilon = sqrt(q*q + M*M);
+    moments_pt[0] += q2w;
+    moments_pt[1] += q2w*q;
+    moments_pt[2] += q2w*epsilon;
+    moments_pt[3] += q2w*q*q/epsilon;
+  }
+  for (int i = 0; i < 4; i++) {
+    class_test(fabs(moments_pt[i]/moments_bg[i] - 1.) > tol,
+               error_message_,
+               "the perturbation sampling of ncdm species %d (%d points) gets the %s wrong by %e, more than tol_ncdm=%e; increase 'Number of momentum bins perturbations' or change 'Quadrature strategy perturbations'",
+               n_ncdm + 1, q_size_ncdm_[n_ncdm], names[i], moments_pt[i]/moments_bg[i] - 1., tol);
+  }
+  return _SUCCESS_;
+}
+
+/**
+ * Two species are identical if they have the same mass, temperature,
+ * chemical potential and analytic p.s.d., and were given the same
+ * momentum sampling. They may only differ by their degeneracy
+ * (i.e. by the normalisation factor_ncdm_).
+ */
+
+bool NonColdDarkMatter::background_ncdm_are_identical(int n1, int n2) const {
+  if ((got_files_[n1] == _TRUE_) || (got_files_[n2] == _TRUE_)) {
+    return false;
+  }
+  if ((M_ncdm_[n1] != M_ncdm_[n2]) || (T_ncdm_[n1] != T_ncdm_[n2]) || (ksi_ncdm_[n1] != ksi_ncdm_[n2])) {
+    return false;
+  }
+  if ((q_size_ncdm_[n1] != q_size_ncdm_[n2]) || (q_size_ncdm_bg_[n1] != q_size_ncdm_bg_[n2])) {
+    return false;
+  }
+  for (int index_q = 0; index_q < q_size_ncdm_[n1]; index_q++) {
+    if ((q_ncdm_[n1][index_q] != q_ncdm_[n2][index_q]) || (w_ncdm_[n1][index_q] != w_ncdm_[n2][index_q])) {
+      return false;
+    }
+  }
+  for (int index_q = 0; index_q < q_size_ncdm_bg_[n1]; index_q++) {
+    if ((q_ncdm_bg_[n1][index_q] != q_ncdm_bg_[n2][index_q]) || (w_ncdm_bg_[n1][index_q] != w_ncdm_bg_[n2][index_q])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Merge identical species (e.g. degenerate neutrino masses) into one
+ * species whose normalisation, degeneracy and density are the sums of
+ * those of its members. All equations are linear in the normalisation
+ * of f0, so the merged species has the same density contrast,
+ * velocity and shear as each of its members, while the background
+ * and perturbation modules integrate one momentum hierarchy instead of
+ * several. The first member of each group keeps its arrays; the
+ * arrays are compacted so that N_ncdm_ becomes the number of merged
+ * species.
+ */
+
+int NonColdDarkMatter::background_ncdm_merge_identical() {
+  int n, m;
+  int N_merged = 0;
+  int* first_of_ncdm;
+  double* factor_input;
+
+  class_alloc(first_of_ncdm, sizeof(int)*N_ncdm_input_, error_message_);
+  class_alloc(factor_input, sizeof(double)*N_ncdm_input_, error_message_);
+
+  for (n = 0; n < N_ncdm_input_; n++) {
+    factor_input[n] = factor_ncdm_[n];
+    for (m = 0; m < N_merged; m++) {
+      if (background_ncdm_are_identical(first_of_ncdm[m], n)) {
+        break;
+      }
+    }
+    if (m == N_merged) {
+      first_of_ncdm[N_merged++] = n;
+    }
+    else {
+      /* add species n to the first member of group m and release its own arrays */
+      int n1 = first_of_ncdm[m];
+      factor_ncdm_[n1] += factor_ncdm_[n];
+      deg_ncdm_[n1] += deg_ncdm_[n];
+      Omega0_ncdm_[n1] += Omega0_ncdm_[n];
+      omega0_ncdm_[n1] += omega0_ncdm_[n];
+      free(q_ncdm_[n]);
+      free(w_ncdm_[n]);
+      free(dlnf0_dlnq_ncdm_[n]);
+      free(q_ncdm_bg_[n]);
+      free(w_ncdm_bg_[n]);
+    }
+    ncdm_of_input_[n] = m;
+  }
+
+  for (n = 0; n < N_ncdm_input_; n++) {
+    fraction_of_input_[n] = factor_input[n]/factor_ncdm_[first_of_ncdm[ncdm_of_input_[n]]];
+  }
+
+  /* compact all arrays (first_of_ncdm[m] >= m, so this can be done in place) */
+  for (m = 0; m < N_merged; m++) {
+    n = first_of_ncdm[m];
+    M_ncdm_[m] = M_ncdm_[n];
+    factor_ncdm_[m] = factor_ncdm_[n];
+    deg_ncdm_[m] = deg_ncdm_[n];
+    T_ncdm_[m] = T_ncdm_[n];
+    ksi_ncdm_[m] = ksi_ncdm_[n];
+    Omega0_ncdm_[m] = Omega0_ncdm_[n];
+    omega0_ncdm_[m] = omega0_ncdm_[n];
+    m_ncdm_in_eV_[m] = m_ncdm_in_eV_[n];
+    ncdm_qmax_[m] = ncdm_qmax_[n];
+    got_files_[m] = got_files_[n];
+    ncdm_quadrature_strategy_[m] = ncdm_quadrature_strategy_[n];
+    ncdm_input_q_size_[m] = ncdm_input_q_size_[n];
+    q_size_ncdm_[m] = q_size_ncdm_[n];
+    q_size_ncdm_bg_[m] = q_size_ncdm_bg_[n];
+    q_ncdm_[m] = q_ncdm_[n];
+    w_ncdm_[m] = w_ncdm_[n];
+    dlnf0_dlnq_ncdm_[m] = dlnf0_dlnq_ncdm_[n];
+    q_ncdm_bg_[m] = q_ncdm_bg_[n];
+    w_ncdm_bg_[m] = w_ncdm_bg_[n];
+  }
+  N_ncdm_ = N_merged;
+
+  free(first_of_ncdm);
+  free(factor_input);
+
   return _SUCCESS_;
 }
 
@@ -690,6 +895,13 @@ void NonColdDarkMatter::PrintNeffInfo() const {
            q_size_ncdm_bg_[n_ncdm],
            q_size_ncdm_[n_ncdm],
            rho_ncdm_rel/rho_nu_rel_);
+    if (N_ncdm_ < N_ncdm_input_) {
+      printf("    (evolved for the identical input species");
+      for (int i = 0; i < N_ncdm_input_; i++) {
+        if (ncdm_of_input_[i] == n_ncdm) printf(" %d", i + 1);
+      }
+      printf(")\n");
+    }
   }
 }
 
@@ -9,6 +9,8 @@
 
 #include <memory>
 
+struct background_parameters_for_distributions;
+
 #define _zeta3_ 1.2020569031595942853997381615114499907649862923404988817922 /**< for quandrature test function */
 #define _zeta5_ 1.0369277551433699263313654864570341680570809195019128119741 /**< for quandrature test function */
 #define _PSD_DERIVATIVE_EXP_MIN_ -30 /**< for ncdm, for accurate computation of dlnf0/dlnq, q step is varied in range specified by these parameters */
@@ -20,6 +22,7 @@ struct NcdmSettings {
   double tol_ncdm;
   double tol_ncdm_bg;
   double tol_M_ncdm;
+  int merge_identical_species;
 };
 
 class NonColdDarkMatter {
@@ -42,6 +45,12 @@ public:
   double** w_ncdm_ = nullptr;     /**< Pointers to vectors of corresponding quadrature weights w */
   double** dlnf0_dlnq_ncdm_ = nullptr; /**< Pointers to vectors of logarithmic derivatives of p-s-d */
 
+  /* Identical input species are evolved as one species with summed degeneracy. N_ncdm_ and all
+     arrays above refer to the evolved species; the maps below allow to report per input species. */
+  int N_ncdm_input_ = 0;               /**< Number of ncdm species in the input */
+  int* ncdm_of_input_ = nullptr;       /**< ncdm_of_input_[i]: evolved species containing input species i */
+  double* fraction_of_input_ = nullptr; /**< fraction_of_input_[i]: share of input species i in the density of its evolved species */
+
   mutable ErrorMsg error_message_;
 
 private:
@@ -50,6 +59,11 @@ private:
   int background_ncdm_init(FileContent* pfc, const NcdmSettings&);
   int background_ncdm_momenta_mass(int n_ncdm, double M, double z, double* n, double* rho, double* p, double* drho_dM, double* pseudo_p) const;
   double background_ncdm_M_from_Omega(int n_ncdm, double H0, double Omega0, double tol_M_ncdm);
+  int background_ncdm_merge_identical();
+  bool background_ncdm_are_identical(int n1, int n2) const;
+  int background_ncdm_qsampling(background_parameters_for_distributions* pbadist, int strategy, int input_q_size, double qmax, double tol, int q_size_max,
+                                double** q, double** w, int* q_size);
+  int background_ncdm_check_qsampling(int n_ncdm, double tol) const;
   static int background_ncdm_distribution(void* pba, double q, double* f0);
   static int background_ncdm_test_function(void* pba, double q, double* test);
 
@@ -74,6 +88,9 @@ private:
   int* ncdm_quadrature_strategy_ = nullptr; /**< Vector of integers according to quadrature strategy. */
   int* ncdm_input_q_size_ = nullptr; /**< Vector of numbers of q bins */
   double* ncdm_qmax_ = nullptr;   /**< Vector of maximum value of q */
+  int* ncdm_quadrature_strategy_pt_ = nullptr; /**< Same as ncdm_quadrature_strategy_, for the perturbation sampling only */
+  int* ncdm_input_q_size_pt_ = nullptr;        /**< Same as ncdm_input_q_size_, for the perturbation sampling only */
+  double* ncdm_qmax_pt_ = nullptr;             /**< Same as ncdm_qmax_, for the perturbation sampling only */
   double* Omega0_ncdm_ = nullptr;
   double* omega0_ncdm_ = nullptr;
   double* m_ncdm_in_eV_ = nullptr;
@@ -0,0 +1,99 @@
+#include "thread_budget.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+namespace Tools {
+
+std::mutex ThreadBudget::mutex_;
+unsigned int ThreadBudget::limit_ = 0;
+unsigned int ThreadBudget::in_use_ = 0;
+bool ThreadBudget::limit_is_explicit_ = false;
+
+/**
+ * Number of threads available to this process: the value of the first
+ * of the environment variables SLURM_CPUS_PER_TASK and OMP_NUM_THREADS
+ * which is set to a value 0 < threads <= 8192, and
+ * std::thread::hardware_concurrency() otherwise.
+ */
+unsigned int ThreadBudget::DefaultThreadCount() {
+  for (const std::string& env_var_name : {"SLURM_CPUS_PER_TASK", "OMP_NUM_THREADS"}) {
+    if (char* s = std::getenv(env_var_name.c_str())) {
+      int threads = std::atoi(s);
+      if ((threads > 0) && (threads <= 8192)) {
+        return threads;
+      }
+    }
+  }
+  return std::max(1u, std::thread::hardware_concurrency());
+}
+
+void ThreadBudget::SetLimit(unsigned int limit) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  limit_ = std::max(1u, limit);
+  limit_is_explicit_ = true;
+}
+
+/**
+ * Raise the default limit to at least limit. A limit set with SetLimit()
+ * is left unchanged, since the embedding program knows best how many
+ * threads the process may use. The limit is never lowered.
+ */
+void ThreadBudget::RaiseLimit(unsigned int limit) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (limit_is_explicit_) {
+    return;
+  }
+  if (limit_ == 0) {
+    limit_ = DefaultThreadCount();
+  }
+  limit_ = std::max(limit_, limit);
+}
+
+unsigned int ThreadBudget::Limit() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (limit_ == 0) {
+    limit_ = DefaultThreadCount();
+  }
+  return limit_;
+}
+
+unsigned int ThreadBudget::InUse() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return in_use_;
+}
+
+/**
+ * Number of workers worth starting for a stage of task_count independent
+ * tasks, each costing about work_per_task operations: at most max_workers
+ * and task_count, and few enough that each worker gets at least
+ * min_work_per_worker operations, since starting and joining a thread is
+ * not free. A non-positive min_work_per_worker disables the cost criterion.
+ */
+unsigned int ThreadBudget::WorkersForStage(unsigned int max_workers, std::size_t task_count, double work_per_task, double min_work_per_worker) {
+  double workers = std::min<double>(max_workers, task_count);
+  if (min_work_per_worker > 0.) {
+    workers = std::min(workers, std::floor(task_count*work_per_task/min_work_per_worker));
+  }
+  return std::max(1u, static_cast<unsigned int>(workers));
+}
+
+unsigned int ThreadBudget::Acquire(unsigned int wanted) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (limit_ == 0) {
+    limit_ = DefaultThreadCount();
+  }
+  unsigned int available = (in_use_ < limit_) ? limit_ - in_use_ : 0;
+  unsigned int granted = std::max(1u, std::min(wanted, available));
+  in_use_ += granted;
+  return granted;
+}
+
+void ThreadBudget::Release(unsigned int count) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  in_use_ -= count;
+}
+
+}
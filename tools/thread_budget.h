@@ -0,0 +1,66 @@
+#ifndef THREAD_BUDGET_H
+#define THREAD_BUDGET_H
+#include <cstddef>
+#include <mutex>
+
+namespace Tools {
+
+/**
+ * Process-wide limit on the number of worker threads running at the same
+ * time in all the parallel stages that take a ThreadLease.
+ *
+ * When several cosmologies are computed concurrently in one process, each
+ * of them would otherwise start number_of_threads workers in every stage.
+ * With the budget, a stage gets what is left of the limit, but always at
+ * least one worker so that it can make progress; the limit is therefore
+ * exceeded by at most one worker per concurrent stage. Acquiring never
+ * blocks.
+ *
+ * The limit defaults to DefaultThreadCount(). An input with an explicit
+ * threads entry raises this default with RaiseLimit(), so that a run of
+ * the class executable gets the threads it asked for. Programs embedding
+ * several cosmologies should fix the limit with SetLimit(): this limit
+ * is then never changed by the inputs.
+ */
+class ThreadBudget {
+public:
+  static unsigned int DefaultThreadCount();
+  static void SetLimit(unsigned int limit);
+  static void RaiseLimit(unsigned int limit);
+  static unsigned int Limit();
+  static unsigned int InUse();
+
+  static unsigned int WorkersForStage(unsigned int max_workers, std::size_t task_count, double work_per_task, double min_work_per_worker);
+
+private:
+  friend class ThreadLease;
+  static unsigned int Acquire(unsigned int wanted);
+  static void Release(unsigned int count);
+
+  static std::mutex mutex_;
+  static unsigned int limit_;     /**< 0 until the default limit has been computed */
+  static bool limit_is_explicit_; /**< true once SetLimit() has been called */
+  static unsigned int in_use_;
+};
+
+/**
+ * Workers granted to one parallel stage by the ThreadBudget, returned
+ * when the lease goes out of scope. Declare it before the TaskSystem it
+ * sizes, so that the workers have been joined when it is released.
+ */
+class ThreadLease {
+public:
+  explicit ThreadLease(unsigned int wanted)
+  : count_(ThreadBudget::Acquire(wanted)) {}
+  ~ThreadLease() { ThreadBudget::Release(count_); }
+  ThreadLease(const ThreadLease&) = delete;
+  ThreadLease& operator=(const ThreadLease&) = delete;
+
+  unsigned int Count() const { return count_; }
+
+private:
+  const unsigned int count_;
+};
+
+}
+#endif //THREAD_BUDGET_H